@@ -41,6 +41,10 @@ public:
     {
     }
     
+    void _q_onReplyReadyRead() {
+        // Token responses are small, so they are parsed in one go in _q_onReplyFinished()
+    }
+    
     void _q_onReplyFinished() {
         if (!reply) {
             return;
@@ -66,7 +70,7 @@ public:
             emit q->finished();
             return;
         case QNetworkReply::AuthenticationRequiredError:
-            if ((authRequest == RevokeToken) && (!refreshToken.isEmpty())) {
+            if ((authRequest == RevokeToken) && (!q->refreshToken().isEmpty())) {
                 refreshAccessToken();
             }
             else {
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#include "entities.h"
+
+/*!
+    \class QDailymotion::Video
+    \brief A Dailymotion video, with the fields returned by default for the video resource.
+    
+    \ingroup resources
+    
+    Video, User, Playlist and Channel can be decoded directly from a response using QtJson::Json::parseInto() 
+    or ResourcesRequest::resultAs(), without building a QVariant hierarchy.
+    
+    \code
+    QVector<QDailymotion::Video> videos = request->resultAs<QDailymotion::Video>();
+    \endcode
+    
+    Request the fields listed in the schema for the members to be set.
+*/
+
+/*!
+    \class QDailymotion::User
+    \brief A Dailymotion user.
+    
+    \ingroup resources
+*/
+
+/*!
+    \class QDailymotion::Playlist
+    \brief A Dailymotion playlist.
+    
+    \ingroup resources
+*/
+
+/*!
+    \class QDailymotion::Channel
+    \brief A Dailymotion channel.
+    
+    \ingroup resources
+*/
+
+namespace QtJson {
+
+using QDailymotion::Video;
+using QDailymotion::User;
+using QDailymotion::Playlist;
+using QDailymotion::Channel;
+
+static const Field VIDEO_FIELDS[] = {
+    { "id", &assignField<Video, QString, &Video::id> },
+    { "title", &assignField<Video, QString, &Video::title> },
+    { "description", &assignField<Video, QString, &Video::description> },
+    { "channel", &assignField<Video, QString, &Video::channel> },
+    { "owner", &assignField<Video, QString, &Video::owner> },
+    { "duration", &assignField<Video, int, &Video::duration> },
+    { "views_total", &assignField<Video, qint64, &Video::viewsTotal> },
+    { "thumbnail_url", &assignField<Video, QString, &Video::thumbnailUrl> },
+    { "created_time", &assignField<Video, qint64, &Video::createdTime> },
+    { "url", &assignField<Video, QString, &Video::url> },
+    { "tags", &assignField<Video, QStringList, &Video::tags> }
+};
+
+static const Field USER_FIELDS[] = {
+    { "id", &assignField<User, QString, &User::id> },
+    { "screenname", &assignField<User, QString, &User::screenname> },
+    { "username", &assignField<User, QString, &User::username> },
+    { "description", &assignField<User, QString, &User::description> },
+    { "avatar_120_url", &assignField<User, QString, &User::avatarUrl> },
+    { "url", &assignField<User, QString, &User::url> },
+    { "videos_total", &assignField<User, int, &User::videosTotal> },
+    { "followers_total", &assignField<User, int, &User::followersTotal> }
+};
+
+static const Field PLAYLIST_FIELDS[] = {
+    { "id", &assignField<Playlist, QString, &Playlist::id> },
+    { "name", &assignField<Playlist, QString, &Playlist::name> },
+    { "description", &assignField<Playlist, QString, &Playlist::description> },
+    { "owner", &assignField<Playlist, QString, &Playlist::owner> },
+    { "videos_total", &assignField<Playlist, int, &Playlist::videosTotal> },
+    { "thumbnail_url", &assignField<Playlist, QString, &Playlist::thumbnailUrl> },
+    { "created_time", &assignField<Playlist, qint64, &Playlist::createdTime> }
+};
+
+static const Field CHANNEL_FIELDS[] = {
+    { "id", &assignField<Channel, QString, &Channel::id> },
+    { "name", &assignField<Channel, QString, &Channel::name> },
+    { "description", &assignField<Channel, QString, &Channel::description> },
+    { "slug", &assignField<Channel, QString, &Channel::slug> }
+};
+
+const Field* Schema<Video>::fields() {
+    return VIDEO_FIELDS;
+}
+
+int Schema<Video>::count() {
+    return int(sizeof(VIDEO_FIELDS) / sizeof(Field));
+}
+
+const Field* Schema<User>::fields() {
+    return USER_FIELDS;
+}
+
+int Schema<User>::count() {
+    return int(sizeof(USER_FIELDS) / sizeof(Field));
+}
+
+const Field* Schema<Playlist>::fields() {
+    return PLAYLIST_FIELDS;
+}
+
+int Schema<Playlist>::count() {
+    return int(sizeof(PLAYLIST_FIELDS) / sizeof(Field));
+}
+
+const Field* Schema<Channel>::fields() {
+    return CHANNEL_FIELDS;
+}
+
+int Schema<Channel>::count() {
+    return int(sizeof(CHANNEL_FIELDS) / sizeof(Field));
+}
+
+}
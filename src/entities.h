@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#ifndef QDAILYMOTION_ENTITIES_H
+#define QDAILYMOTION_ENTITIES_H
+
+#include "qdailymotion_global.h"
+#include "json.h"
+
+namespace QDailymotion {
+
+struct Video
+{
+    Video() : duration(0), viewsTotal(0), createdTime(0) {}
+    
+    QString id;
+    QString title;
+    QString description;
+    QString channel;
+    QString owner;
+    int duration;
+    qint64 viewsTotal;
+    QString thumbnailUrl;
+    qint64 createdTime;
+    QString url;
+    QStringList tags;
+};
+
+struct User
+{
+    User() : videosTotal(0), followersTotal(0) {}
+    
+    QString id;
+    QString screenname;
+    QString username;
+    QString description;
+    QString avatarUrl;
+    QString url;
+    int videosTotal;
+    int followersTotal;
+};
+
+struct Playlist
+{
+    Playlist() : videosTotal(0), createdTime(0) {}
+    
+    QString id;
+    QString name;
+    QString description;
+    QString owner;
+    int videosTotal;
+    QString thumbnailUrl;
+    qint64 createdTime;
+};
+
+struct Channel
+{
+    QString id;
+    QString name;
+    QString description;
+    QString slug;
+};
+
+}
+
+namespace QtJson {
+
+template <>
+struct QDAILYMOTIONSHARED_EXPORT Schema<QDailymotion::Video>
+{
+    static const Field* fields();
+    static int count();
+};
+
+template <>
+struct QDAILYMOTIONSHARED_EXPORT Schema<QDailymotion::User>
+{
+    static const Field* fields();
+    static int count();
+};
+
+template <>
+struct QDAILYMOTIONSHARED_EXPORT Schema<QDailymotion::Playlist>
+{
+    static const Field* fields();
+    static int count();
+};
+
+template <>
+struct QDAILYMOTIONSHARED_EXPORT Schema<QDailymotion::Channel>
+{
+    static const Field* fields();
+    static int count();
+};
+
+}
+
+#endif // QDAILYMOTION_ENTITIES_H
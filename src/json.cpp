@@ -31,558 +31,3642 @@
  */
 
 #include "json.h"
+#include "jsonscan_p.h"
+#include <QtAlgorithms>
+#include <QAtomicInt>
+#include <QIODevice>
+#include <QVector>
+#ifndef QT_NO_CONCURRENT
+#include <QThread>
+#include <QtConcurrentRun>
+#endif
+#include <cstring>
 #include <iostream>
 
 namespace QtJson
 {
 
+//Documents smaller than this are always parsed serially
+static const int PARALLEL_MIN_SIZE = 32 * 1024;
 
-static QString sanitizeString(QString str)
+//The number of elements at which arrays are decoded in parallel, set and read from any thread
+static QAtomicInt parallelElements(64);
+
+
+static inline bool isWhitespace(char c)
+{
+        return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+static inline bool isNumberChar(char c)
+{
+        return ((c >= '0') && (c <= '9')) || (c == '+') || (c == '-') || (c == '.') || (c == 'e') || (c == 'E');
+}
+
+static int hexToInt(const char *hex, int length)
+{
+        int value = 0;
+
+        for(int i = 0; i < length; i++)
+        {
+                const char c = hex[i];
+                value <<= 4;
+
+                if((c >= '0') && (c <= '9'))
+                {
+                        value |= c - '0';
+                }
+                else if((c >= 'a') && (c <= 'f'))
+                {
+                        value |= c - 'a' + 10;
+                }
+                else if((c >= 'A') && (c <= 'F'))
+                {
+                        value |= c - 'A' + 10;
+                }
+                else
+                {
+                        //Leave anything unusual to toInt(), as before
+                        return QByteArray(hex, length).toInt(0, 16);
+                }
+        }
+
+        return value;
+}
+
+static inline bool isDigit(char c)
+{
+        return (c >= '0') && (c <= '9');
+}
+
+/**
+ * Convert text that is not a valid JSON number, as QByteArray would
+ */
+static QVariant numberFallback(const QByteArray &numberStr)
+{
+        if ((numberStr.contains('.')) || (numberStr.contains('e')) || (numberStr.contains('E'))) {
+                return QVariant(numberStr.toDouble(NULL));
+        } else if (numberStr.startsWith('-')) {
+                return QVariant(numberStr.toLongLong(NULL));
+        } else {
+                return QVariant(numberStr.toULongLong(NULL));
+        }
+}
+
+/**
+ * Convert a JSON number in place
+ *
+ * Integers become qulonglong, or qlonglong if negative, and numbers with a
+ * fraction or an exponent, or that overflow 64 bits, become double. A double
+ * whose significand fits in 53 bits and whose exponent is at most 22 is
+ * exact after one multiplication or division, so only other doubles are
+ * copied and passed to QByteArray::toDouble().
+ */
+static QVariant numberValue(const char *data, int length)
+{
+        static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+        const qulonglong maximum = Q_UINT64_C(18446744073709551615);
+        const char *p = data;
+        const char *end = data + length;
+        const bool negative = (p < end) && (*p == '-');
+
+        if(negative)
+        {
+                p++;
+        }
+
+        //An integer part without redundant leading zeros is required
+        if((p == end) || (!isDigit(*p)) || ((*p == '0') && (p + 1 < end) && (isDigit(p[1]))))
+        {
+                return numberFallback(QByteArray(data, length));
+        }
+
+        qulonglong significand = 0;
+        int exponent = 0;
+        bool overflow = false;
+        bool isDouble = false;
+
+        for(; (p < end) && (isDigit(*p)); p++)
+        {
+                const int digit = *p - '0';
+
+                if(significand > (maximum - digit) / 10)
+                {
+                        overflow = true;
+                }
+                else
+                {
+                        significand = significand * 10 + digit;
+                }
+        }
+
+        if((p < end) && (*p == '.'))
+        {
+                isDouble = true;
+                p++;
+
+                if((p == end) || (!isDigit(*p)))
+                {
+                        return numberFallback(QByteArray(data, length));
+                }
+
+                for(; (p < end) && (isDigit(*p)); p++)
+                {
+                        const int digit = *p - '0';
+
+                        if(significand > (maximum - digit) / 10)
+                        {
+                                overflow = true;
+                        }
+                        else
+                        {
+                                significand = significand * 10 + digit;
+                                exponent--;
+                        }
+                }
+        }
+
+        if((p < end) && ((*p == 'e') || (*p == 'E')))
+        {
+                isDouble = true;
+                p++;
+                const bool negativeExponent = (p < end) && (*p == '-');
+
+                if((p < end) && ((*p == '-') || (*p == '+')))
+                {
+                        p++;
+                }
+
+                if((p == end) || (!isDigit(*p)))
+                {
+                        return numberFallback(QByteArray(data, length));
+                }
+
+                int e = 0;
+
+                for(; (p < end) && (isDigit(*p)); p++)
+                {
+                        if(e < 100000)
+                        {
+                                e = e * 10 + (*p - '0');
+                        }
+                }
+
+                exponent += negativeExponent ? -e : e;
+        }
+
+        if(p != end)
+        {
+                return numberFallback(QByteArray(data, length));
+        }
+
+        if((!isDouble) && (!overflow))
+        {
+                if(!negative)
+                {
+                        return QVariant(significand);
+                }
+
+                if(significand <= Q_UINT64_C(9223372036854775808))
+                {
+                        return QVariant(significand == Q_UINT64_C(9223372036854775808) ? Q_INT64_C(-9223372036854775807) - 1
+                                                                                      : -qlonglong(significand));
+                }
+        }
+
+        if(!overflow)
+        {
+                if(significand == 0)
+                {
+                        return QVariant(negative ? -0.0 : 0.0);
+                }
+
+                if((significand <= Q_UINT64_C(9007199254740992)) && (exponent >= -22) && (exponent <= 22))
+                {
+                        double value = double(significand);
+                        value = (exponent < 0) ? value / powers[-exponent] : value * powers[exponent];
+                        return QVariant(negative ? -value : value);
+                }
+        }
+
+        return QVariant(QByteArray(data, length).toDouble(NULL));
+}
+
+static inline void appendUtf8(QString &str, const char *data, int length)
+{
+        if(length <= 0)
+        {
+                return;
+        }
+
+        if(str.isEmpty())
+        {
+                str = QString::fromUtf8(data, length);
+        }
+        else
+        {
+                str.append(QString::fromUtf8(data, length));
+        }
+}
+
+/**
+ * parse
+ */
+QVariant Json::parse(const QString &json)
+{
+        bool success = true;
+        return Json::parse(json, success);
+}
+
+/**
+ * parse
+ */
+QVariant Json::parse(const QString &json, bool &success)
+{
+        //Return an empty QVariant if the JSON data is null
+        if(json.isNull())
+        {
+                success = true;
+                return QVariant();
+        }
+
+        //An empty string must still fail to parse, so never pass on a null QByteArray
+        const QByteArray utf8 = json.toUtf8();
+        return Json::parse(utf8.isNull() ? QByteArray("") : utf8, success);
+}
+
+/**
+ * parse
+ */
+QVariant Json::parse(const QByteArray &json)
+{
+        bool success = true;
+        return Json::parse(json, success);
+}
+
+/**
+ * parse
+ */
+QVariant Json::parse(const QByteArray &json, bool &success)
+{
+        success = true;
+
+        //Return an empty QVariant if the JSON data is null
+        if(!json.isNull())
+        {
+                QVariant result;
+
+                if(parseParallel(json, result))
+                {
+                        return result;
+                }
+
+                //Feed all of the data to the parser in one go
+                Parser parser;
+                parser.addData(json);
+                success = parser.finish();
+
+                //Return the parsed value
+                return parser.result();
+        }
+        else
+        {
+                //Return the empty QVariant
+                return QVariant();
+        }
+}
+
+/**
+ * setParallelThreshold
+ */
+void Json::setParallelThreshold(int elements)
+{
+#if QT_VERSION >= 0x050000
+        parallelElements.storeRelease(elements);
+#else
+        parallelElements = elements;
+#endif
+}
+
+/**
+ * parallelThreshold
+ */
+int Json::parallelThreshold()
+{
+#if QT_VERSION >= 0x050000
+        return parallelElements.loadAcquire();
+#else
+        return parallelElements;
+#endif
+}
+
+QByteArray Json::serialize(const QVariant &data)
+{
+        bool success = true;
+        return Json::serialize(data, Writer::Padded, success);
+}
+
+QByteArray Json::serialize(const QVariant &data, bool &success)
+{
+        return Json::serialize(data, Writer::Padded, success);
+}
+
+QByteArray Json::serialize(const QVariant &data, Writer::Format format)
+{
+        bool success = true;
+        return Json::serialize(data, format, success);
+}
+
+QByteArray Json::serialize(const QVariant &data, Writer::Format format, bool &success)
+{
+        QByteArray str;
+        Writer writer(&str, format);
+        success = writer.write(data);
+
+        if (success)
+        {
+                return str;
+        }
+        else
+        {
+                return QByteArray();
+        }
+}
+
+/**
+ * \class WriterPrivate
+ * \brief Serializes values into a fixed size chunk, which is appended to the
+ * buffer or written to the device when it is full
+ */
+class WriterPrivate
+{
+        public:
+                WriterPrivate(QByteArray *b, QIODevice *dev, Writer::Format f);
+
+                bool writeValue(const QVariant &data);
+
+                void writeString(const QString &str);
+
+                void writeEscape(ushort c);
+
+                void writeInteger(qlonglong n);
+
+                void writeUnsigned(qulonglong n, bool negative);
+
+                inline void put(char c)
+                {
+                        if(used == ChunkSize)
+                        {
+                                flush();
+                        }
+
+                        chunk[used++] = c;
+                }
+
+                void put(const char *data, int length);
+
+                bool flush();
+
+                enum { ChunkSize = 4096 };
+
+                QByteArray *buffer;
+
+                QIODevice *device;
+
+                Writer::Format format;
+
+                //Separators for the format
+                const char *arrayOpen;
+                const char *arrayClose;
+                const char *objectOpen;
+                const char *objectClose;
+                const char *comma;
+                const char *colon;
+
+                bool deviceError;
+
+                int used;
+
+                char chunk[ChunkSize];
+};
+
+WriterPrivate::WriterPrivate(QByteArray *b, QIODevice *dev, Writer::Format f) :
+        buffer(b),
+        device(dev),
+        format(f),
+        deviceError(false),
+        used(0)
+{
+        if(format == Writer::Compact)
+        {
+                arrayOpen = "[";
+                arrayClose = "]";
+                objectOpen = "{";
+                objectClose = "}";
+                comma = ",";
+                colon = ":";
+        }
+        else
+        {
+                arrayOpen = "[ ";
+                arrayClose = " ]";
+                objectOpen = "{ ";
+                objectClose = " }";
+                comma = ", ";
+                colon = " : ";
+        }
+}
+
+void WriterPrivate::put(const char *data, int length)
+{
+        while(length > 0)
+        {
+                if(used == ChunkSize)
+                {
+                        flush();
+                }
+
+                const int count = qMin(length, int(ChunkSize) - used);
+                memcpy(chunk + used, data, count);
+                used += count;
+                data += count;
+                length -= count;
+        }
+}
+
+/**
+ * Pass the chunk on to the buffer or device
+ */
+bool WriterPrivate::flush()
+{
+        if(used > 0)
+        {
+                if(buffer)
+                {
+                        buffer->append(chunk, used);
+                }
+                else if((device) && (device->write(chunk, used) != used))
+                {
+                        deviceError = true;
+                }
+
+                used = 0;
+        }
+
+        return !deviceError;
+}
+
+bool WriterPrivate::writeValue(const QVariant &data)
+{
+        if(!data.isValid()) // invalid or null?
+        {
+                put("null", 4);
+        }
+        else if(data.type() == QVariant::StringList) // a list of strings?
+        {
+                const QStringList list = data.toStringList();
+                put(arrayOpen, qstrlen(arrayOpen));
+
+                for(int i = 0; i < list.size(); i++)
+                {
+                        if(i > 0)
+                        {
+                                put(comma, qstrlen(comma));
+                        }
+
+                        writeString(list.at(i));
+                }
+
+                put(arrayClose, qstrlen(arrayClose));
+        }
+        else if(data.type() == QVariant::List) // variant is a list?
+        {
+                const QVariantList list = data.toList();
+                put(arrayOpen, qstrlen(arrayOpen));
+
+                for(int i = 0; i < list.size(); i++)
+                {
+                        if(i > 0)
+                        {
+                                put(comma, qstrlen(comma));
+                        }
+
+                        if(!writeValue(list.at(i)))
+                        {
+                                return false;
+                        }
+                }
+
+                put(arrayClose, qstrlen(arrayClose));
+        }
+        else if(data.type() == QVariant::Map) // variant is a map?
+        {
+                const QVariantMap map = data.toMap();
+                put(objectOpen, qstrlen(objectOpen));
+
+                for(QVariantMap::const_iterator it = map.constBegin(); it != map.constEnd(); ++it)
+                {
+                        if(it != map.constBegin())
+                        {
+                                put(comma, qstrlen(comma));
+                        }
+
+                        writeString(it.key());
+                        put(colon, qstrlen(colon));
+
+                        if(!writeValue(it.value()))
+                        {
+                                return false;
+                        }
+                }
+
+                put(objectClose, qstrlen(objectClose));
+        }
+        else if((data.type() == QVariant::String) || (data.type() == QVariant::ByteArray)) // a string or a byte array?
+        {
+                writeString(data.toString());
+        }
+        else if(data.type() == QVariant::Double) // double?
+        {
+                const QByteArray str = QByteArray::number(data.toDouble());
+                put(str.constData(), str.size());
+
+                if(!str.contains(".") && ! str.contains("e"))
+                {
+                        put(".0", 2);
+                }
+        }
+        else if (data.type() == QVariant::Bool) // boolean value?
+        {
+                if(data.toBool())
+                {
+                        put("true", 4);
+                }
+                else
+                {
+                        put("false", 5);
+                }
+        }
+        else if (data.type() == QVariant::ULongLong) // large unsigned number?
+        {
+                writeUnsigned(data.value<qulonglong>(), false);
+        }
+        else if ( data.canConvert<qlonglong>() ) // any signed number?
+        {
+                writeInteger(data.value<qlonglong>());
+        }
+        else if (data.canConvert<long>())
+        {
+                writeInteger(data.value<long>());
+        }
+        else if (data.canConvert<QString>()) // can value be converted to string?
+        {
+                // this will catch QDate, QDateTime, QUrl, ...
+                writeString(data.toString());
+        }
+        else
+        {
+                return false;
+        }
+
+        return true;
+}
+
+/**
+ * Escape and encode a string as UTF-8 in a single pass
+ */
+void WriterPrivate::writeString(const QString &str)
+{
+        const ushort *chars = str.utf16();
+        const int length = str.size();
+        put('"');
+
+        for(int i = 0; i < length; i++)
+        {
+                const ushort c = chars[i];
+
+                if(c < 0x80)
+                {
+                        if((c < 0x20) || (c == '"') || (c == '\\'))
+                        {
+                                writeEscape(c);
+                        }
+                        else
+                        {
+                                put(char(c));
+                        }
+                }
+                else if(c < 0x800)
+                {
+                        put(char(0xc0 | (c >> 6)));
+                        put(char(0x80 | (c & 0x3f)));
+                }
+                else if((c >= 0xd800) && (c < 0xdc00) && (i + 1 < length) && (chars[i + 1] >= 0xdc00) && (chars[i + 1] < 0xe000))
+                {
+                        const uint ucs4 = 0x10000 + ((uint(c) - 0xd800) << 10) + (uint(chars[++i]) - 0xdc00);
+                        put(char(0xf0 | (ucs4 >> 18)));
+                        put(char(0x80 | ((ucs4 >> 12) & 0x3f)));
+                        put(char(0x80 | ((ucs4 >> 6) & 0x3f)));
+                        put(char(0x80 | (ucs4 & 0x3f)));
+                }
+                else if((c >= 0xd800) && (c < 0xe000))
+                {
+                        //A lone surrogate is replaced with U+FFFD
+                        put("\xef\xbf\xbd", 3);
+                }
+                else
+                {
+                        put(char(0xe0 | (c >> 12)));
+                        put(char(0x80 | ((c >> 6) & 0x3f)));
+                        put(char(0x80 | (c & 0x3f)));
+                }
+        }
+
+        put('"');
+}
+
+void WriterPrivate::writeEscape(ushort c)
+{
+        static const char hex[] = "0123456789abcdef";
+        put('\\');
+
+        switch(c)
+        {
+                case '"':
+                        put('"');
+                        break;
+                case '\\':
+                        put('\\');
+                        break;
+                case '\b':
+                        put('b');
+                        break;
+                case '\f':
+                        put('f');
+                        break;
+                case '\n':
+                        put('n');
+                        break;
+                case '\r':
+                        put('r');
+                        break;
+                case '\t':
+                        put('t');
+                        break;
+                default:
+                        put("u00", 3);
+                        put(hex[c >> 4]);
+                        put(hex[c & 0xf]);
+                        break;
+        }
+}
+
+void WriterPrivate::writeInteger(qlonglong n)
+{
+        if(n < 0)
+        {
+                writeUnsigned(qulonglong(0) - qulonglong(n), true);
+        }
+        else
+        {
+                writeUnsigned(qulonglong(n), false);
+        }
+}
+
+/**
+ * Format a number without allocating
+ */
+void WriterPrivate::writeUnsigned(qulonglong n, bool negative)
+{
+        char digits[24];
+        int i = sizeof(digits);
+
+        do
+        {
+                digits[--i] = char('0' + (n % 10));
+                n /= 10;
+        }
+        while(n > 0);
+
+        if(negative)
+        {
+                digits[--i] = '-';
+        }
+
+        put(digits + i, int(sizeof(digits)) - i);
+}
+
+/**
+ * Writer
+ */
+Writer::Writer(QByteArray *buffer, Format format) :
+        d(new WriterPrivate(buffer, 0, format))
+{
+}
+
+Writer::Writer(QIODevice *device, Format format) :
+        d(new WriterPrivate(0, device, format))
+{
+}
+
+Writer::~Writer()
+{
+        d->flush();
+        delete d;
+}
+
+/**
+ * format
+ */
+Writer::Format Writer::format() const
+{
+        return d->format;
+}
+
+/**
+ * write
+ */
+bool Writer::write(const QVariant &data)
+{
+        const bool success = d->writeValue(data);
+        return d->flush() && success;
+}
+
+/**
+ * Binary snapshot format
+ *
+ * A snapshot is the bytes "QJB" and a version byte, the key table, and a
+ * single value. Sizes and integers are varints of 7 bits per byte, with
+ * the lowest bits first. Strings are UTF-8, with lone surrogates encoded
+ * as three bytes like other characters. The key table is the number of
+ * keys, followed by each key as a length-prefixed string, and object
+ * members refer to their keys by index.
+ *
+ * Each value is a tag byte followed by its data:
+ *
+ *   null, false, true       no data
+ *   unsigned                the value as a varint
+ *   negative                the value as a varint of -(value + 1)
+ *   double                  the IEEE 754 bits, little endian
+ *   string                  the length of the UTF-8 data, and the data
+ *   array                   the number of elements, and the elements
+ *   object                  the number of members, and each key index and value
+ */
+static const char BINARY_MAGIC[] = { 'Q', 'J', 'B' };
+static const uchar BINARY_VERSION = 1;
+
+//Deeper values are rejected, so that corrupt data cannot exhaust the stack
+static const int BINARY_MAX_DEPTH = 1024;
+
+enum BinaryTag
+{
+        BinaryNull = 0,
+        BinaryFalse = 1,
+        BinaryTrue = 2,
+        BinaryUnsigned = 3,
+        BinaryNegative = 4,
+        BinaryDouble = 5,
+        BinaryString = 6,
+        BinaryArray = 7,
+        BinaryObject = 8
+};
+
+/**
+ * \class BinaryWriter
+ * \brief Encodes values in the binary snapshot format, in the same way as
+ * WriterPrivate serializes them
+ */
+class BinaryWriter
+{
+        public:
+                bool writeValue(const QVariant &data, int depth);
+
+                void writeInteger(qlonglong n);
+
+                void writeSize(QByteArray &out, qulonglong n);
+
+                void writeString(QByteArray &out, const QString &str);
+
+                void writeKey(const QString &key);
+
+                QByteArray keyTable;
+
+                QByteArray body;
+
+                QHash<QString, int> keys;
+
+                //Reused for encoding each string
+                QByteArray utf8;
+};
+
+bool BinaryWriter::writeValue(const QVariant &data, int depth)
+{
+        if(depth > BINARY_MAX_DEPTH)
+        {
+                return false;
+        }
+
+        if(!data.isValid())
+        {
+                body.append(char(BinaryNull));
+        }
+        else if(data.type() == QVariant::StringList)
+        {
+                const QStringList list = data.toStringList();
+                body.append(char(BinaryArray));
+                writeSize(body, list.size());
+
+                for(int i = 0; i < list.size(); i++)
+                {
+                        body.append(char(BinaryString));
+                        writeString(body, list.at(i));
+                }
+        }
+        else if(data.type() == QVariant::List)
+        {
+                const QVariantList list = data.toList();
+                body.append(char(BinaryArray));
+                writeSize(body, list.size());
+
+                for(int i = 0; i < list.size(); i++)
+                {
+                        if(!writeValue(list.at(i), depth + 1))
+                        {
+                                return false;
+                        }
+                }
+        }
+        else if(data.type() == QVariant::Map)
+        {
+                const QVariantMap map = data.toMap();
+                body.append(char(BinaryObject));
+                writeSize(body, map.size());
+
+                for(QVariantMap::const_iterator it = map.constBegin(); it != map.constEnd(); ++it)
+                {
+                        writeKey(it.key());
+
+                        if(!writeValue(it.value(), depth + 1))
+                        {
+                                return false;
+                        }
+                }
+        }
+        else if((data.type() == QVariant::String) || (data.type() == QVariant::ByteArray))
+        {
+                body.append(char(BinaryString));
+                writeString(body, data.toString());
+        }
+        else if(data.type() == QVariant::Double)
+        {
+                const double value = data.toDouble();
+                quint64 bits;
+                memcpy(&bits, &value, sizeof(bits));
+                body.append(char(BinaryDouble));
+
+                for(int i = 0; i < 8; i++)
+                {
+                        body.append(char(bits >> (i * 8)));
+                }
+        }
+        else if(data.type() == QVariant::Bool)
+        {
+                body.append(char(data.toBool() ? BinaryTrue : BinaryFalse));
+        }
+        else if(data.type() == QVariant::ULongLong)
+        {
+                body.append(char(BinaryUnsigned));
+                writeSize(body, data.value<qulonglong>());
+        }
+        else if(data.canConvert<qlonglong>())
+        {
+                writeInteger(data.value<qlonglong>());
+        }
+        else if(data.canConvert<long>())
+        {
+                writeInteger(data.value<long>());
+        }
+        else if(data.canConvert<QString>())
+        {
+                body.append(char(BinaryString));
+                writeString(body, data.toString());
+        }
+        else
+        {
+                return false;
+        }
+
+        return true;
+}
+
+/**
+ * Parsing gives an unsigned value for every number that is not negative
+ */
+void BinaryWriter::writeInteger(qlonglong n)
+{
+        if(n < 0)
+        {
+                body.append(char(BinaryNegative));
+                writeSize(body, qulonglong(-(n + 1)));
+        }
+        else
+        {
+                body.append(char(BinaryUnsigned));
+                writeSize(body, qulonglong(n));
+        }
+}
+
+void BinaryWriter::writeSize(QByteArray &out, qulonglong n)
+{
+        char bytes[10];
+        int i = 0;
+
+        while(n >= 0x80)
+        {
+                bytes[i++] = char(0x80 | (n & 0x7f));
+                n >>= 7;
+        }
+
+        bytes[i++] = char(n);
+        out.append(bytes, i);
+}
+
+/**
+ * Encode a string as UTF-8, encoding a lone surrogate like any other
+ * character so that the string is decoded exactly
+ */
+void BinaryWriter::writeString(QByteArray &out, const QString &str)
+{
+        const ushort *chars = str.utf16();
+        const int length = str.size();
+        utf8.resize(length * 3);
+        char *data = utf8.data();
+        int used = 0;
+
+        for(int i = 0; i < length; i++)
+        {
+                const ushort c = chars[i];
+
+                if(c < 0x80)
+                {
+                        data[used++] = char(c);
+                }
+                else if(c < 0x800)
+                {
+                        data[used++] = char(0xc0 | (c >> 6));
+                        data[used++] = char(0x80 | (c & 0x3f));
+                }
+                else if((c >= 0xd800) && (c < 0xdc00) && (i + 1 < length) && (chars[i + 1] >= 0xdc00) && (chars[i + 1] < 0xe000))
+                {
+                        const uint ucs4 = 0x10000 + ((uint(c) - 0xd800) << 10) + (uint(chars[++i]) - 0xdc00);
+                        data[used++] = char(0xf0 | (ucs4 >> 18));
+                        data[used++] = char(0x80 | ((ucs4 >> 12) & 0x3f));
+                        data[used++] = char(0x80 | ((ucs4 >> 6) & 0x3f));
+                        data[used++] = char(0x80 | (ucs4 & 0x3f));
+                }
+                else
+                {
+                        data[used++] = char(0xe0 | (c >> 12));
+                        data[used++] = char(0x80 | ((c >> 6) & 0x3f));
+                        data[used++] = char(0x80 | (c & 0x3f));
+                }
+        }
+
+        writeSize(out, used);
+        out.append(data, used);
+}
+
+/**
+ * Write the index of a key, adding the key to the table when it is first used
+ */
+void BinaryWriter::writeKey(const QString &key)
+{
+        QHash<QString, int>::const_iterator it = keys.constFind(key);
+
+        if(it != keys.constEnd())
+        {
+                writeSize(body, it.value());
+        }
+        else
+        {
+                const int index = keys.size();
+                keys.insert(key, index);
+                writeString(keyTable, key);
+                writeSize(body, index);
+        }
+}
+
+/**
+ * \class BinaryReader
+ * \brief Decodes values in the binary snapshot format
+ */
+class BinaryReader
+{
+        public:
+                BinaryReader(const QByteArray &data);
+
+                bool readHeader();
+
+                bool readValue(QVariant &value, int depth);
+
+                bool readSize(qulonglong &n);
+
+                bool readCount(int &count);
+
+                bool readString(QString &str);
+
+                const char *data;
+
+                int size;
+
+                int index;
+
+                QVector<QString> keys;
+};
+
+BinaryReader::BinaryReader(const QByteArray &d) :
+        data(d.constData()),
+        size(d.size()),
+        index(0)
+{
+}
+
+bool BinaryReader::readHeader()
+{
+        if((size < 4) || (memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) || (uchar(data[3]) != BINARY_VERSION))
+        {
+                return false;
+        }
+
+        index = 4;
+        int count;
+
+        if(!readCount(count))
+        {
+                return false;
+        }
+
+        keys.resize(count);
+
+        for(int i = 0; i < count; i++)
+        {
+                if(!readString(keys[i]))
+                {
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+bool BinaryReader::readValue(QVariant &value, int depth)
+{
+        if((index >= size) || (depth > BINARY_MAX_DEPTH))
+        {
+                return false;
+        }
+
+        switch(data[index++])
+        {
+                case BinaryNull:
+                        value = QVariant();
+                        return true;
+                case BinaryFalse:
+                        value = QVariant(false);
+                        return true;
+                case BinaryTrue:
+                        value = QVariant(true);
+                        return true;
+                case BinaryUnsigned:
+                {
+                        qulonglong n;
+
+                        if(!readSize(n))
+                        {
+                                return false;
+                        }
+
+                        value = QVariant(n);
+                        return true;
+                }
+                case BinaryNegative:
+                {
+                        qulonglong n;
+
+                        if((!readSize(n)) || (n > Q_UINT64_C(0x7fffffffffffffff)))
+                        {
+                                return false;
+                        }
+
+                        value = QVariant(-qlonglong(n) - 1);
+                        return true;
+                }
+                case BinaryDouble:
+                {
+                        if(size - index < 8)
+                        {
+                                return false;
+                        }
+
+                        quint64 bits = 0;
+
+                        for(int i = 0; i < 8; i++)
+                        {
+                                bits |= quint64(uchar(data[index++])) << (i * 8);
+                        }
+
+                        double d;
+                        memcpy(&d, &bits, sizeof(d));
+                        value = QVariant(d);
+                        return true;
+                }
+                case BinaryString:
+                {
+                        QString str;
+
+                        if(!readString(str))
+                        {
+                                return false;
+                        }
+
+                        value = QVariant(str);
+                        return true;
+                }
+                case BinaryArray:
+                {
+                        int count;
+
+                        if(!readCount(count))
+                        {
+                                return false;
+                        }
+
+                        QVariantList list;
+                        list.reserve(count);
+
+                        for(int i = 0; i < count; i++)
+                        {
+                                list.append(QVariant());
+
+                                if(!readValue(list.last(), depth + 1))
+                                {
+                                        return false;
+                                }
+                        }
+
+                        value = list;
+                        return true;
+                }
+                case BinaryObject:
+                {
+                        int count;
+
+                        if(!readCount(count))
+                        {
+                                return false;
+                        }
+
+                        QVariantMap map;
+
+                        for(int i = 0; i < count; i++)
+                        {
+                                qulonglong key;
+
+                                if((!readSize(key)) || (key >= qulonglong(keys.size())))
+                                {
+                                        return false;
+                                }
+
+                                if(!readValue(map[keys.at(int(key))], depth + 1))
+                                {
+                                        return false;
+                                }
+                        }
+
+                        value = map;
+                        return true;
+                }
+                default:
+                        return false;
+        }
+}
+
+bool BinaryReader::readSize(qulonglong &n)
+{
+        n = 0;
+
+        for(int shift = 0; (shift < 64) && (index < size); shift += 7)
+        {
+                const uchar byte = uchar(data[index++]);
+                n |= qulonglong(byte & 0x7f) << shift;
+
+                if(!(byte & 0x80))
+                {
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+/**
+ * Read the size of a container or string, which cannot be more than the bytes remaining
+ */
+bool BinaryReader::readCount(int &count)
+{
+        qulonglong n;
+
+        if((!readSize(n)) || (n > qulonglong(size - index)))
+        {
+                return false;
+        }
+
+        count = int(n);
+        return true;
+}
+
+bool BinaryReader::readString(QString &str)
+{
+        int length;
+
+        if(!readCount(length))
+        {
+                return false;
+        }
+
+        str = QString();
+
+        if(length == 0)
+        {
+                return true;
+        }
+
+        const uchar *bytes = reinterpret_cast<const uchar*>(data + index);
+        int used = 0;
+        int i = 0;
+        index += length;
+
+        //There are never more characters than bytes
+        str.resize(length);
+        ushort *chars = reinterpret_cast<ushort*>(str.data());
+
+        while(i < length)
+        {
+                const uchar c = bytes[i];
+
+                if(c < 0x80)
+                {
+                        chars[used++] = c;
+                        i++;
+                }
+                else if(((c & 0xe0) == 0xc0) && (i + 1 < length))
+                {
+                        chars[used++] = ushort(((c & 0x1f) << 6) | (bytes[i + 1] & 0x3f));
+                        i += 2;
+                }
+                else if(((c & 0xf0) == 0xe0) && (i + 2 < length))
+                {
+                        chars[used++] = ushort(((c & 0x0f) << 12) | ((bytes[i + 1] & 0x3f) << 6) | (bytes[i + 2] & 0x3f));
+                        i += 3;
+                }
+                else if(((c & 0xf8) == 0xf0) && (i + 3 < length))
+                {
+                        const uint ucs4 = ((c & 0x07) << 18) | ((bytes[i + 1] & 0x3f) << 12) | ((bytes[i + 2] & 0x3f) << 6) | (bytes[i + 3] & 0x3f);
+                        chars[used++] = ushort(0xd800 + (((ucs4 - 0x10000) >> 10) & 0x3ff));
+                        chars[used++] = ushort(0xdc00 + (ucs4 & 0x3ff));
+                        i += 4;
+                }
+                else
+                {
+                        //Corrupt data
+                        return false;
+                }
+        }
+
+        str.resize(used);
+        return true;
+}
+
+/**
+ * toBinary
+ */
+QByteArray Json::toBinary(const QVariant &data)
+{
+        bool success = true;
+        return Json::toBinary(data, success);
+}
+
+QByteArray Json::toBinary(const QVariant &data, bool &success)
+{
+        BinaryWriter writer;
+        success = writer.writeValue(data, 0);
+
+        if(!success)
+        {
+                return QByteArray();
+        }
+
+        QByteArray binary;
+        binary.reserve(8 + writer.keyTable.size() + writer.body.size());
+        binary.append(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+        binary.append(char(BINARY_VERSION));
+        writer.writeSize(binary, writer.keys.size());
+        binary.append(writer.keyTable);
+        binary.append(writer.body);
+        return binary;
+}
+
+/**
+ * fromBinary
+ */
+QVariant Json::fromBinary(const QByteArray &data)
+{
+        bool success = true;
+        return Json::fromBinary(data, success);
+}
+
+QVariant Json::fromBinary(const QByteArray &data, bool &success)
+{
+        BinaryReader reader(data);
+        QVariant value;
+
+        //The value must use all of the data
+        success = (reader.readHeader()) && (reader.readValue(value, 0)) && (reader.index == reader.size);
+        return success ? value : QVariant();
+}
+
+/**
+ * \class DomBuilder
+ * \brief Builds a QVariant hierarchy from parse events
+ */
+class DomBuilder : public Handler
+{
+        public:
+                void reset();
+
+                void startObject();
+                void endObject();
+                void startArray();
+                void endArray();
+                void key(const QString &key);
+                void value(const QVariant &value);
+
+                QVariant root;
+
+        private:
+                /**
+                 * An object or array that has not been closed yet
+                 */
+                struct Frame
+                {
+                        bool object;
+                        QVariantMap map;
+                        QVariantList list;
+                        QString key;
+                };
+
+                void addValue(const QVariant &value);
+                void closeContainer();
+
+                QList<Frame> stack;
+};
+
+void DomBuilder::reset()
+{
+        stack.clear();
+        root = QVariant();
+}
+
+void DomBuilder::startObject()
+{
+        stack.append(Frame());
+        stack.last().object = true;
+}
+
+void DomBuilder::endObject()
+{
+        closeContainer();
+}
+
+void DomBuilder::startArray()
+{
+        stack.append(Frame());
+        stack.last().object = false;
+}
+
+void DomBuilder::endArray()
+{
+        closeContainer();
+}
+
+void DomBuilder::key(const QString &key)
+{
+        stack.last().key = key;
+}
+
+void DomBuilder::value(const QVariant &value)
+{
+        addValue(value);
+}
+
+/**
+ * Add a complete value to the innermost open container
+ */
+void DomBuilder::addValue(const QVariant &value)
+{
+        if(stack.isEmpty())
+        {
+                root = value;
+                return;
+        }
+
+        Frame &frame = stack.last();
+
+        if(frame.object)
+        {
+                frame.map[frame.key] = value;
+        }
+        else
+        {
+                frame.list.push_back(value);
+        }
+}
+
+/**
+ * Close the innermost open container and add it to its parent
+ */
+void DomBuilder::closeContainer()
+{
+        const QVariant value = stack.last().object ? QVariant(stack.last().map) : QVariant(stack.last().list);
+        stack.removeLast();
+        addValue(value);
+}
+
+/**
+ * A key or array element selected by a projection
+ */
+struct ProjectionNode
+{
+        ProjectionNode() :
+                all(false),
+                elements(0)
+        {
+        }
+
+        ~ProjectionNode()
+        {
+                qDeleteAll(members);
+                delete elements;
+        }
+
+        const ProjectionNode* member(const char *key, int length) const
+        {
+                Q_FOREACH(const ProjectionNode *node, members)
+                {
+                        if((node->name.size() == length) && (memcmp(node->name.constData(), key, length) == 0))
+                        {
+                                return node;
+                        }
+                }
+
+                return 0;
+        }
+
+        //The UTF-8 encoded key
+        QByteArray name;
+
+        //Whether everything below this node is selected
+        bool all;
+
+        QList<ProjectionNode*> members;
+
+        ProjectionNode *elements;
+};
+
+/**
+ * \class ParserPrivate
+ * \brief The tokenizer state of an incremental parse
+ */
+class ParserPrivate
+{
+        public:
+                enum State
+                {
+                        StateValue,
+                        StateObjectKey,
+                        StateObjectColon,
+                        StateObjectValue,
+                        StateArrayValue,
+                        StateString,
+                        StateStringEscape,
+                        StateStringUnicode,
+                        StateNumber,
+                        StateLiteral,
+                        StateSkip,
+                        StateDone,
+                        StateError
+                };
+
+                ParserPrivate(Handler *h);
+                ~ParserPrivate();
+
+                void reset();
+
+                void setProjection(const QStringList &paths);
+
+                bool selectElement();
+
+                void beginSkip();
+
+                bool parse(const char *data, int size);
+
+                bool beginValue(char c, int &index);
+
+                void valueDone();
+
+                void closeContainer();
+
+                void finishKey(const char *bytes, int length);
+
+                QString decodeKey(const char *bytes, int length);
+
+                void fail();
+
+                Handler *handler;
+
+                //The fastest scanning kernels supported by the CPU
+                const Scan::Kernels *scan;
+
+                DomBuilder dom;
+
+                //The open containers, as '{' or '['
+                QByteArray containers;
+
+                State state;
+
+                char rootToken;
+
+                bool empty;
+
+                bool stringIsKey;
+
+                //Undecoded UTF-8 bytes of the current string
+                QByteArray raw;
+
+                //Decoded part of the current string
+                QString decoded;
+
+                //Partial number or unicode escape
+                QByteArray token;
+
+                const char *literal;
+
+                int literalIndex;
+
+                QVariant literalValue;
+
+                QStringList projectionPaths;
+
+                ProjectionNode *projection;
+
+                //The projection node of each open container, or 0 if all of it is selected
+                QList<const ProjectionNode*> nodes;
+
+                //The projection node of the next value
+                const ProjectionNode *valueNode;
+
+                bool skipValue;
+
+                int skipDepth;
+
+                bool skipInString;
+
+                bool skipEscape;
+
+                bool skipStarted;
+
+                //The pool used when no pool is set, cleared on reset
+                KeyPool ownKeys;
+
+                KeyPool *keys;
+};
+
+ParserPrivate::ParserPrivate(Handler *h) :
+        handler(h ? h : &dom),
+        scan(&Scan::kernels()),
+        projection(0),
+        keys(&ownKeys)
+{
+        reset();
+}
+
+ParserPrivate::~ParserPrivate()
+{
+        delete projection;
+}
+
+void ParserPrivate::reset()
+{
+        dom.reset();
+        containers.clear();
+        state = StateValue;
+        rootToken = 0;
+        empty = true;
+        stringIsKey = false;
+        raw.clear();
+        decoded.clear();
+        token.clear();
+        literal = 0;
+        literalIndex = 0;
+        literalValue = QVariant();
+        nodes.clear();
+        valueNode = projection;
+        skipValue = false;
+        ownKeys.clear();
+}
+
+/**
+ * Build the projection tree from a list of key paths
+ */
+void ParserPrivate::setProjection(const QStringList &paths)
+{
+        delete projection;
+        projection = 0;
+        projectionPaths = paths;
+
+        if(!paths.isEmpty())
+        {
+                projection = new ProjectionNode;
+
+                Q_FOREACH(const QString &path, paths)
+                {
+                        ProjectionNode *node = projection;
+
+                        Q_FOREACH(QString key, path.split('.'))
+                        {
+                                int elements = 0;
+
+                                while(key.endsWith("[*]"))
+                                {
+                                        key.chop(3);
+                                        elements++;
+                                }
+
+                                if(!key.isEmpty())
+                                {
+                                        const QByteArray name = key.toUtf8();
+                                        ProjectionNode *child = const_cast<ProjectionNode*>(node->member(name.constData(), name.size()));
+
+                                        if(!child)
+                                        {
+                                                child = new ProjectionNode;
+                                                child->name = name;
+                                                node->members.append(child);
+                                        }
+
+                                        node = child;
+                                }
+
+                                while(elements > 0)
+                                {
+                                        if(!node->elements)
+                                        {
+                                                node->elements = new ProjectionNode;
+                                        }
+
+                                        node = node->elements;
+                                        elements--;
+                                }
+                        }
+
+                        node->all = true;
+                }
+        }
+
+        reset();
+}
+
+/**
+ * Select the projection node of the next array element
+ *
+ * \return bool false if the element is to be skipped
+ */
+bool ParserPrivate::selectElement()
+{
+        const ProjectionNode *parent = nodes.last();
+
+        if(!parent)
+        {
+                valueNode = 0;
+                return true;
+        }
+
+        if(!parent->elements)
+        {
+                return false;
+        }
+
+        valueNode = parent->elements->all ? 0 : parent->elements;
+        return true;
+}
+
+/**
+ * Start skipping a value that is not in the projection
+ */
+void ParserPrivate::beginSkip()
+{
+        skipDepth = 0;
+        skipInString = false;
+        skipEscape = false;
+        skipStarted = false;
+        state = StateSkip;
+}
+
+/**
+ * Start parsing the value beginning with c
+ */
+bool ParserPrivate::beginValue(char c, int &index)
+{
+        if(containers.isEmpty())
+        {
+                rootToken = c;
+        }
+
+        switch(c)
+        {
+                case '{':
+                        containers.append('{');
+                        nodes.append(valueNode);
+                        handler->startObject();
+                        state = StateObjectKey;
+                        index++;
+                        return true;
+                case '[':
+                        containers.append('[');
+                        nodes.append(valueNode);
+                        handler->startArray();
+                        state = StateArrayValue;
+                        index++;
+                        return true;
+                case '"':
+                        stringIsKey = false;
+                        state = StateString;
+                        index++;
+                        return true;
+                case '0': case '1': case '2': case '3': case '4':
+                case '5': case '6': case '7': case '8': case '9':
+                case '-':
+                        //The first character is consumed in StateNumber
+                        token.clear();
+                        state = StateNumber;
+                        return true;
+                case 't':
+                        literal = "true";
+                        literalValue = QVariant(true);
+                        break;
+                case 'f':
+                        literal = "false";
+                        literalValue = QVariant(false);
+                        break;
+                case 'n':
+                        literal = "null";
+                        literalValue = QVariant();
+                        break;
+                default:
+                        return false;
+        }
+
+        literalIndex = 0;
+        state = StateLiteral;
+        return true;
+}
+
+/**
+ * Move on to whatever may follow a complete value
+ */
+void ParserPrivate::valueDone()
+{
+        if(containers.isEmpty())
+        {
+                state = StateDone;
+        }
+        else if(containers.at(containers.size() - 1) == '{')
+        {
+                state = StateObjectKey;
+        }
+        else
+        {
+                state = StateArrayValue;
+        }
+}
+
+/**
+ * Close the innermost open container
+ */
+void ParserPrivate::closeContainer()
+{
+        if(containers.at(containers.size() - 1) == '{')
+        {
+                handler->endObject();
+        }
+        else
+        {
+                handler->endArray();
+        }
+
+        containers.chop(1);
+        nodes.removeLast();
+        valueDone();
+}
+
+/**
+ * Match a complete key against the projection and report it if selected
+ *
+ * The undecoded tail of the key is given by bytes.
+ */
+void ParserPrivate::finishKey(const char *bytes, int length)
+{
+        const ProjectionNode *parent = nodes.last();
+        state = StateObjectColon;
+        skipValue = false;
+        valueNode = 0;
+
+        if(parent)
+        {
+                const ProjectionNode *node;
+
+                if(decoded.isEmpty())
+                {
+                        //Match the raw bytes, so that keys which are not selected are never decoded
+                        node = parent->member(bytes, length);
+                }
+                else
+                {
+                        const QByteArray utf8 = decodeKey(bytes, length).toUtf8();
+                        node = parent->member(utf8.constData(), utf8.size());
+                }
+
+                if(!node)
+                {
+                        skipValue = true;
+                        return;
+                }
+
+                if(!node->all)
+                {
+                        valueNode = node;
+                }
+        }
+
+        handler->key(decodeKey(bytes, length));
+}
+
+/**
+ * Decode a complete key. The undecoded tail of the key is given by bytes.
+ */
+QString ParserPrivate::decodeKey(const char *bytes, int length)
+{
+        if(decoded.isEmpty())
+        {
+                //Keys without escapes are shared through the pool
+                return keys->key(bytes, length);
+        }
+
+        QString key = decoded;
+        appendUtf8(key, bytes, length);
+        return key;
+}
+
+void ParserPrivate::fail()
+{
+        containers.clear();
+        state = StateError;
+}
+
+/**
+ * Parse a chunk of data, continuing from the current state
+ */
+bool ParserPrivate::parse(const char *data, int size)
+{
+        int index = 0;
+
+        while(index < size)
+        {
+                const char c = data[index];
+
+                switch(state)
+                {
+                        case StateValue:
+                        case StateObjectValue:
+                                if(isWhitespace(c))
+                                {
+                                        index = scan->skipWhitespace(data, index + 1, size);
+                                }
+                                else if(!beginValue(c, index))
+                                {
+                                        fail();
+                                        return false;
+                                }
+
+                                break;
+                        case StateArrayValue:
+                                if(isWhitespace(c))
+                                {
+                                        index = scan->skipWhitespace(data, index + 1, size);
+                                }
+                                else if(c == ',')
+                                {
+                                        index++;
+                                }
+                                else if(c == ']')
+                                {
+                                        index++;
+                                        closeContainer();
+                                }
+                                else if(!selectElement())
+                                {
+                                        beginSkip();
+                                }
+                                else if(!beginValue(c, index))
+                                {
+                                        fail();
+                                        return false;
+                                }
+
+                                break;
+                        case StateObjectKey:
+                                if(isWhitespace(c))
+                                {
+                                        index = scan->skipWhitespace(data, index + 1, size);
+                                }
+                                else if(c == ',')
+                                {
+                                        index++;
+                                }
+                                else if(c == '}')
+                                {
+                                        index++;
+                                        closeContainer();
+                                }
+                                else if(c == '"')
+                                {
+                                        index++;
+                                        stringIsKey = true;
+                                        state = StateString;
+                                }
+                                else
+                                {
+                                        fail();
+                                        return false;
+                                }
+
+                                break;
+                        case StateObjectColon:
+                                if(isWhitespace(c))
+                                {
+                                        index = scan->skipWhitespace(data, index + 1, size);
+                                }
+                                else if(c == ':')
+                                {
+                                        index++;
+
+                                        if(skipValue)
+                                        {
+                                                beginSkip();
+                                        }
+                                        else
+                                        {
+                                                state = StateObjectValue;
+                                        }
+                                }
+                                else
+                                {
+                                        fail();
+                                        return false;
+                                }
+
+                                break;
+                        case StateString:
+                        {
+                                //Find the end of the current run of unescaped bytes
+                                const int end = scan->findQuoteOrBackslash(data, index, size);
+
+                                if(end == size)
+                                {
+                                        //The string continues in the next chunk
+                                        raw.append(data + index, size - index);
+                                        index = size;
+                                }
+                                else if(data[end] == '"')
+                                {
+                                        const char *bytes = data + index;
+                                        int length = end - index;
+                                        index = end + 1;
+
+                                        if(!raw.isEmpty())
+                                        {
+                                                raw.append(bytes, length);
+                                                bytes = raw.constData();
+                                                length = raw.size();
+                                        }
+
+                                        if(stringIsKey)
+                                        {
+                                                finishKey(bytes, length);
+                                        }
+                                        else
+                                        {
+                                                QString str = decoded;
+                                                appendUtf8(str, bytes, length);
+                                                handler->value(QVariant(str));
+                                                valueDone();
+                                        }
+
+                                        raw.clear();
+                                        decoded.clear();
+                                }
+                                else
+                                {
+                                        //An escape always begins on a character boundary
+                                        raw.append(data + index, end - index);
+                                        appendUtf8(decoded, raw.constData(), raw.size());
+                                        raw.clear();
+                                        index = end + 1;
+                                        state = StateStringEscape;
+                                }
+
+                                break;
+                        }
+                        case StateStringEscape:
+                                index++;
+                                state = StateString;
+
+                                switch(c)
+                                {
+                                        case '"':
+                                        case '\\':
+                                        case '/':
+                                                decoded.append(QChar(c));
+                                                break;
+                                        case 'b':
+                                                decoded.append(QChar('\b'));
+                                                break;
+                                        case 'f':
+                                                decoded.append(QChar('\f'));
+                                                break;
+                                        case 'n':
+                                                decoded.append(QChar('\n'));
+                                                break;
+                                        case 'r':
+                                                decoded.append(QChar('\r'));
+                                                break;
+                                        case 't':
+                                                decoded.append(QChar('\t'));
+                                                break;
+                                        case 'u':
+                                                token.clear();
+                                                state = StateStringUnicode;
+                                                break;
+                                        default:
+                                                //Unknown escapes are dropped, as in Json::parse()
+                                                break;
+                                }
+
+                                break;
+                        case StateStringUnicode:
+                                token.append(c);
+                                index++;
+
+                                if(token.size() == 4)
+                                {
+                                        decoded.append(QChar(hexToInt(token.constData(), 4)));
+                                        token.clear();
+                                        state = StateString;
+                                }
+
+                                break;
+                        case StateNumber:
+                        {
+                                int end = index;
+
+                                while((end < size) && (isNumberChar(data[end])))
+                                {
+                                        end++;
+                                }
+
+                                if((end < size) && (token.isEmpty()))
+                                {
+                                        //The whole number is in this chunk, so it is converted in place
+                                        handler->value(numberValue(data + index, end - index));
+                                        index = end;
+                                        valueDone();
+                                        break;
+                                }
+
+                                token.append(data + index, end - index);
+                                index = end;
+
+                                if(end < size)
+                                {
+                                        handler->value(numberValue(token.constData(), token.size()));
+                                        token.clear();
+                                        valueDone();
+                                }
+
+                                break;
+                        }
+                        case StateLiteral:
+                                if(c != literal[literalIndex])
+                                {
+                                        fail();
+                                        return false;
+                                }
+
+                                index++;
+                                literalIndex++;
+
+                                if(literal[literalIndex] == 0)
+                                {
+                                        handler->value(literalValue);
+                                        valueDone();
+                                }
+
+                                break;
+                        case StateSkip:
+                        {
+                                //Find the end of the skipped value without decoding anything
+                                int end = index;
+                                bool done = false;
+
+                                while((end < size) && (!done))
+                                {
+                                        const char s = data[end];
+
+                                        if(skipInString)
+                                        {
+                                                if(skipEscape)
+                                                {
+                                                        skipEscape = false;
+                                                        end++;
+                                                        continue;
+                                                }
+
+                                                end = scan->findQuoteOrBackslash(data, end, size);
+
+                                                if(end == size)
+                                                {
+                                                        break;
+                                                }
+
+                                                if(data[end] == '\\')
+                                                {
+                                                        skipEscape = true;
+                                                }
+                                                else
+                                                {
+                                                        skipInString = false;
+                                                        done = (skipDepth == 0);
+                                                }
+
+                                                end++;
+                                        }
+                                        else if((s == '{') || (s == '['))
+                                        {
+                                                skipDepth++;
+                                                skipStarted = true;
+                                                end++;
+                                        }
+                                        else if((s == '}') || (s == ']'))
+                                        {
+                                                if(skipDepth == 0)
+                                                {
+                                                        //The end of the enclosing container
+                                                        done = true;
+                                                }
+                                                else
+                                                {
+                                                        skipDepth--;
+                                                        done = (skipDepth == 0);
+                                                        end++;
+                                                }
+                                        }
+                                        else if(s == '"')
+                                        {
+                                                skipInString = true;
+                                                skipStarted = true;
+                                                end++;
+                                        }
+                                        else if((skipDepth == 0) && ((s == ',') || (isWhitespace(s))))
+                                        {
+                                                //Whitespace before the value, or the end of a scalar
+                                                done = skipStarted;
+
+                                                if(!done)
+                                                {
+                                                        end++;
+                                                }
+                                        }
+                                        else
+                                        {
+                                                //Anything up to the next structural character belongs to a skipped value
+                                                skipStarted = true;
+                                                end = scan->findStructural(data, end + 1, size);
+                                        }
+                                }
+
+                                index = end;
+
+                                if(done)
+                                {
+                                        skipValue = false;
+                                        valueDone();
+                                }
+
+                                break;
+                        }
+                        case StateDone:
+                                return true;
+                        case StateError:
+                                return false;
+                }
+        }
+
+        return state != StateError;
+}
+
+/**
+ * KeyPool
+ */
+KeyPool::KeyPool(int maximumSize) :
+        maximum(maximumSize)
+{
+}
+
+/**
+ * key
+ */
+QString KeyPool::key(const char *utf8, int length)
+{
+        if(length <= 0)
+        {
+                return QString();
+        }
+
+        //Look the key up without copying it
+        const QHash<QByteArray, QString>::const_iterator iterator = keys.constFind(QByteArray::fromRawData(utf8, length));
+
+        if(iterator != keys.constEnd())
+        {
+                return iterator.value();
+        }
+
+        const QString key = QString::fromUtf8(utf8, length);
+
+        if(keys.size() < maximum)
+        {
+                keys.insert(QByteArray(utf8, length), key);
+        }
+
+        return key;
+}
+
+/**
+ * count
+ */
+int KeyPool::count() const
+{
+        return keys.size();
+}
+
+/**
+ * maximumSize
+ */
+int KeyPool::maximumSize() const
+{
+        return maximum;
+}
+
+/**
+ * setMaximumSize
+ */
+void KeyPool::setMaximumSize(int maximumSize)
+{
+        maximum = maximumSize;
+}
+
+/**
+ * clear
+ */
+void KeyPool::clear()
+{
+        keys.clear();
+}
+
+/**
+ * Parser
+ */
+Parser::Parser(Handler *handler) :
+        d(new ParserPrivate(handler))
+{
+}
+
+Parser::~Parser()
+{
+        delete d;
+}
+
+/**
+ * reset
+ */
+void Parser::reset()
+{
+        d->reset();
+}
+
+/**
+ * setProjection
+ */
+void Parser::setProjection(const QStringList &paths)
+{
+        d->setProjection(paths);
+}
+
+/**
+ * projection
+ */
+QStringList Parser::projection() const
+{
+        return d->projectionPaths;
+}
+
+/**
+ * setKeyPool
+ */
+void Parser::setKeyPool(KeyPool *pool)
+{
+        d->keys = pool ? pool : &d->ownKeys;
+}
+
+/**
+ * keyPool
+ */
+KeyPool *Parser::keyPool() const
+{
+        return d->keys == &d->ownKeys ? 0 : d->keys;
+}
+
+/**
+ * addData
+ */
+bool Parser::addData(const QByteArray &data)
+{
+        if(!data.isEmpty())
+        {
+                d->empty = false;
+        }
+
+        return d->parse(data.constData(), data.size());
+}
+
+/**
+ * finish
+ */
+bool Parser::finish()
+{
+        //A number can only be terminated by the end of the data
+        if((d->state == ParserPrivate::StateNumber) && (d->containers.isEmpty()))
+        {
+                d->handler->value(numberValue(d->token.constData(), d->token.size()));
+                d->token.clear();
+                d->valueDone();
+        }
+
+        if(d->state != ParserPrivate::StateDone)
+        {
+                d->fail();
+                return false;
+        }
+
+        return true;
+}
+
+/**
+ * isEmpty
+ */
+bool Parser::isEmpty() const
+{
+        return d->empty;
+}
+
+/**
+ * result
+ */
+QVariant Parser::result() const
+{
+        if(d->state == ParserPrivate::StateError)
+        {
+                //Mirror the value returned by Json::parse() on failure
+                switch(d->rootToken)
+                {
+                        case '{':
+                                return QVariantMap();
+                        case '[':
+                                return QVariantList();
+                        default:
+                                return QVariant();
+                }
+        }
+
+        return d->dom.root;
+}
+
+/**
+ * An entry in the structural index of a Document
+ */
+struct DocumentNode
+{
+        //'{', '[', '"', '0' for a number, or the first letter of a literal
+        char type;
+
+        //Whether a string contains escapes
+        bool escaped;
+
+        //The byte range of the value, excluding the quotes of a string
+        int begin;
+        int end;
+
+        //The index of the entry following this value and its descendants
+        int next;
+
+        //The number of members or elements of a container
+        int count;
+};
+
+/**
+ * \class DocumentData
+ * \brief The data and structural index shared by Document values
+ */
+class DocumentData : public QSharedData
+{
+        public:
+                bool build();
+
+                QVariant decode(int index) const;
+
+                QVariant decode(int index, KeyPool &pool) const;
+
+                QString decodeString(int index) const;
+
+                QString decodeKey(int index) const;
+
+                QString decodeKey(int index, KeyPool &pool) const;
+
+                bool keyEquals(int index, const QByteArray &key) const;
+
+                QByteArray json;
+
+                QVector<DocumentNode> nodes;
+
+                //Keys are shared by every object in the document
+                mutable KeyPool keys;
+};
+
+/**
+ * Find the closing quote of a string starting at index
+ */
+static int findStringEnd(const Scan::Kernels &scan, const char *data, int size, int index, bool &escaped)
+{
+        escaped = false;
+
+        while(true)
+        {
+                index = scan.findQuoteOrBackslash(data, index, size);
+
+                if(index >= size)
+                {
+                        return -1;
+                }
+
+                if(data[index] == '"')
+                {
+                        return index;
+                }
+
+                //An escape consumes the next character, and a unicode escape four more
+                escaped = true;
+                index += ((index + 1 < size) && (data[index + 1] == 'u')) ? 6 : 2;
+        }
+}
+
+/**
+ * Build the structural index, accepting the same data as Parser
+ */
+bool DocumentData::build()
+{
+        enum Expect
+        {
+                ExpectValue,
+                ExpectKey,
+                ExpectColon,
+                ExpectElement
+        };
+
+        const Scan::Kernels &scan = Scan::kernels();
+        const char *data = json.constData();
+        const int size = json.size();
+        QVector<int> open;
+        Expect expect = ExpectValue;
+        int index = 0;
+
+        nodes.clear();
+
+        while(true)
+        {
+                //Repeated or missing commas are skipped, as in Parser
+                while(index < size)
+                {
+                        if(isWhitespace(data[index]))
+                        {
+                                index = scan.skipWhitespace(data, index + 1, size);
+                        }
+                        else if((data[index] == ',') && ((expect == ExpectKey) || (expect == ExpectElement)))
+                        {
+                                index++;
+                        }
+                        else
+                        {
+                                break;
+                        }
+                }
+
+                if(index == size)
+                {
+                        return false;
+                }
+
+                const char c = data[index];
+                DocumentNode node;
+                node.type = c;
+                node.escaped = false;
+                node.begin = index;
+                node.end = index + 1;
+                node.next = nodes.size() + 1;
+                node.count = 0;
+
+                if(expect == ExpectColon)
+                {
+                        if(c != ':')
+                        {
+                                return false;
+                        }
+
+                        index++;
+                        expect = ExpectValue;
+                        continue;
+                }
+
+                if(((expect == ExpectKey) && (c == '}')) || ((expect == ExpectElement) && (c == ']')))
+                {
+                        DocumentNode &container = nodes[open.last()];
+                        container.end = index + 1;
+                        container.next = nodes.size();
+                        open.remove(open.size() - 1);
+                        index++;
+                }
+                else if(expect == ExpectKey)
+                {
+                        if(c != '"')
+                        {
+                                return false;
+                        }
+
+                        node.begin = index + 1;
+                        node.end = findStringEnd(scan, data, size, node.begin, node.escaped);
+
+                        if(node.end == -1)
+                        {
+                                return false;
+                        }
+
+                        nodes.append(node);
+                        index = node.end + 1;
+                        expect = ExpectColon;
+                        continue;
+                }
+                else
+                {
+                        if(!open.isEmpty())
+                        {
+                                nodes[open.last()].count++;
+                        }
+
+                        switch(c)
+                        {
+                                case '{':
+                                case '[':
+                                        open.append(nodes.size());
+                                        nodes.append(node);
+                                        expect = (c == '{') ? ExpectKey : ExpectElement;
+                                        index++;
+                                        continue;
+                                case '"':
+                                        node.begin = index + 1;
+                                        node.end = findStringEnd(scan, data, size, node.begin, node.escaped);
+
+                                        if(node.end == -1)
+                                        {
+                                                return false;
+                                        }
+
+                                        index = node.end + 1;
+                                        break;
+                                case '0': case '1': case '2': case '3': case '4':
+                                case '5': case '6': case '7': case '8': case '9':
+                                case '-':
+                                        node.type = '0';
+
+                                        while((node.end < size) && (isNumberChar(data[node.end])))
+                                        {
+                                                node.end++;
+                                        }
+
+                                        index = node.end;
+                                        break;
+                                case 't':
+                                case 'f':
+                                case 'n':
+                                {
+                                        const char *literal = (c == 't') ? "true" : (c == 'f') ? "false" : "null";
+                                        const int length = qstrlen(literal);
+
+                                        if((size - index < length) || (memcmp(data + index, literal, length) != 0))
+                                        {
+                                                return false;
+                                        }
+
+                                        node.end = index + length;
+                                        index = node.end;
+                                        break;
+                                }
+                                default:
+                                        return false;
+                        }
+
+                        nodes.append(node);
+                }
+
+                //A complete value. Any data following the root value is ignored.
+                if(open.isEmpty())
+                {
+                        return true;
+                }
+
+                expect = (nodes.at(open.last()).type == '{') ? ExpectKey : ExpectElement;
+        }
+}
+
+/**
+ * Decode the value at index and its descendants
+ */
+QVariant DocumentData::decode(int index) const
+{
+        return decode(index, keys);
+}
+
+/**
+ * Decode the value at index, sharing keys through pool. Only the pool is
+ * modified, so values can be decoded in several threads with a pool each.
+ */
+QVariant DocumentData::decode(int index, KeyPool &pool) const
+{
+        const DocumentNode &node = nodes.at(index);
+
+        switch(node.type)
+        {
+                case '{':
+                {
+                        QVariantMap map;
+                        int key = index + 1;
+
+                        while(key < node.next)
+                        {
+                                const int value = nodes.at(key).next;
+                                map[decodeKey(key, pool)] = decode(value, pool);
+                                key = nodes.at(value).next;
+                        }
+
+                        return map;
+                }
+                case '[':
+                {
+                        QVariantList list;
+
+                        for(int element = index + 1; element < node.next; element = nodes.at(element).next)
+                        {
+                                list.push_back(decode(element, pool));
+                        }
+
+                        return list;
+                }
+                case '"':
+                        return QVariant(decodeString(index));
+                case '0':
+                        return numberValue(json.constData() + node.begin, node.end - node.begin);
+                case 't':
+                        return QVariant(true);
+                case 'f':
+                        return QVariant(false);
+                default:
+                        return QVariant();
+        }
+}
+
+/**
+ * Decode the string at index, handling escapes in the same way as Parser
+ */
+QString DocumentData::decodeString(int index) const
+{
+        const DocumentNode &node = nodes.at(index);
+        const char *data = json.constData() + node.begin;
+        const int length = node.end - node.begin;
+        QString str;
+
+        if(!node.escaped)
+        {
+                appendUtf8(str, data, length);
+                return str;
+        }
+
+        int start = 0;
+        int i = 0;
+
+        while(i < length)
+        {
+                if(data[i] != '\\')
+                {
+                        i++;
+                        continue;
+                }
+
+                appendUtf8(str, data + start, i - start);
+                i++;
+
+                switch(data[i])
+                {
+                        case '"':
+                        case '\\':
+                        case '/':
+                                str.append(QChar(data[i]));
+                                break;
+                        case 'b':
+                                str.append(QChar('\b'));
+                                break;
+                        case 'f':
+                                str.append(QChar('\f'));
+                                break;
+                        case 'n':
+                                str.append(QChar('\n'));
+                                break;
+                        case 'r':
+                                str.append(QChar('\r'));
+                                break;
+                        case 't':
+                                str.append(QChar('\t'));
+                                break;
+                        case 'u':
+                                str.append(QChar(hexToInt(data + i + 1, 4)));
+                                i += 4;
+                                break;
+                        default:
+                                //Unknown escapes are dropped, as in Parser
+                                break;
+                }
+
+                i++;
+                start = i;
+        }
+
+        appendUtf8(str, data + start, length - start);
+        return str;
+}
+
+/**
+ * Decode the key at index, sharing it through the pool if it has no escapes
+ */
+QString DocumentData::decodeKey(int index) const
+{
+        return decodeKey(index, keys);
+}
+
+QString DocumentData::decodeKey(int index, KeyPool &pool) const
+{
+        const DocumentNode &node = nodes.at(index);
+
+        if(node.escaped)
+        {
+                return decodeString(index);
+        }
+
+        return pool.key(json.constData() + node.begin, node.end - node.begin);
+}
+
+/**
+ * Compare the key at index with a UTF-8 encoded key, without decoding it if possible
+ */
+bool DocumentData::keyEquals(int index, const QByteArray &key) const
+{
+        const DocumentNode &node = nodes.at(index);
+
+        if(node.escaped)
+        {
+                return decodeString(index) == QString::fromUtf8(key.constData(), key.size());
+        }
+
+        return (node.end - node.begin == key.size())
+                && (memcmp(json.constData() + node.begin, key.constData(), key.size()) == 0);
+}
+
+/**
+ * Document
+ */
+Document::Document() :
+        index(0)
+{
+}
+
+Document::Document(const QByteArray &json) :
+        d(new DocumentData),
+        index(0)
+{
+        d->json = json;
+
+        if(!d->build())
+        {
+                d = 0;
+        }
+}
+
+Document::Document(DocumentData *data, int i) :
+        d(data),
+        index(i)
+{
+}
+
+Document::Document(const Document &other) :
+        d(other.d),
+        index(other.index)
+{
+}
+
+Document::~Document()
+{
+}
+
+Document &Document::operator=(const Document &other)
+{
+        d = other.d;
+        index = other.index;
+        return *this;
+}
+
+/**
+ * isValid
+ */
+bool Document::isValid() const
+{
+        return d.constData() != 0;
+}
+
+/**
+ * isObject
+ */
+bool Document::isObject() const
+{
+        return (isValid()) && (d->nodes.at(index).type == '{');
+}
+
+/**
+ * isArray
+ */
+bool Document::isArray() const
+{
+        return (isValid()) && (d->nodes.at(index).type == '[');
+}
+
+/**
+ * count
+ */
+int Document::count() const
+{
+        return (isObject()) || (isArray()) ? d->nodes.at(index).count : 0;
+}
+
+/**
+ * at
+ */
+Document Document::at(int i) const
+{
+        if((!isArray()) || (i < 0) || (i >= count()))
+        {
+                return Document();
+        }
+
+        int element = index + 1;
+
+        while(i > 0)
+        {
+                element = d->nodes.at(element).next;
+                i--;
+        }
+
+        return Document(d.data(), element);
+}
+
+/**
+ * elements
+ */
+QList<Document> Document::elements() const
 {
-        str.replace(QLatin1String("\\"), QLatin1String("\\\\"));
-        str.replace(QLatin1String("\""), QLatin1String("\\\""));
-        str.replace(QLatin1String("\b"), QLatin1String("\\b"));
-        str.replace(QLatin1String("\f"), QLatin1String("\\f"));
-        str.replace(QLatin1String("\n"), QLatin1String("\\n"));
-        str.replace(QLatin1String("\r"), QLatin1String("\\r"));
-        str.replace(QLatin1String("\t"), QLatin1String("\\t"));
-        return QString(QLatin1String("\"%1\"")).arg(str);
+        QList<Document> list;
+
+        if(isArray())
+        {
+                const int end = d->nodes.at(index).next;
+
+                for(int element = index + 1; element < end; element = d->nodes.at(element).next)
+                {
+                        list.append(Document(d.data(), element));
+                }
+        }
+        else if(isObject())
+        {
+                const int end = d->nodes.at(index).next;
+
+                for(int key = index + 1; key < end; key = d->nodes.at(d->nodes.at(key).next).next)
+                {
+                        list.append(Document(d.data(), d->nodes.at(key).next));
+                }
+        }
+
+        return list;
+}
+
+/**
+ * value
+ */
+Document Document::value(const QString &key) const
+{
+        if(!isObject())
+        {
+                return Document();
+        }
+
+        const QByteArray utf8 = key.toUtf8();
+        const int end = d->nodes.at(index).next;
+        int found = -1;
+
+        for(int member = index + 1; member < end; member = d->nodes.at(d->nodes.at(member).next).next)
+        {
+                if(d->keyEquals(member, utf8))
+                {
+                        found = d->nodes.at(member).next;
+                }
+        }
+
+        return found == -1 ? Document() : Document(d.data(), found);
+}
+
+/**
+ * contains
+ */
+bool Document::contains(const QString &key) const
+{
+        return value(key).isValid();
+}
+
+/**
+ * keys
+ */
+QStringList Document::keys() const
+{
+        QStringList list;
+
+        if(isObject())
+        {
+                const int end = d->nodes.at(index).next;
+
+                for(int member = index + 1; member < end; member = d->nodes.at(d->nodes.at(member).next).next)
+                {
+                        list.append(d->decodeKey(member));
+                }
+        }
+
+        return list;
+}
+
+/**
+ * toVariant
+ */
+QVariant Document::toVariant() const
+{
+        return isValid() ? d->decode(index) : QVariant();
+}
+
+
+
+#ifndef QT_NO_CONCURRENT
+/**
+ * \struct ElementRange
+ * \brief A run of consecutive elements of an indexed array
+ */
+struct ElementRange
+{
+        const DocumentData *data;
+
+        //The index of the first element
+        int first;
+
+        //The number of elements
+        int count;
+};
+
+/**
+ * Decode a run of elements, with a key pool of its own so that runs can be
+ * decoded in parallel
+ */
+static QVariantList decodeElements(const ElementRange &range)
+{
+        KeyPool keys;
+        QVariantList list;
+        int element = range.first;
+
+        for(int i = 0; i < range.count; i++)
+        {
+                list.append(range.data->decode(element, keys));
+                element = range.data->nodes.at(element).next;
+        }
+
+        return list;
+}
+
+/**
+ * Decode the value at index, splitting a large array at the top level, or
+ * in a member of a top-level object, into runs that are decoded in parallel
+ */
+static QVariant decodeParallel(const DocumentData &data, int index, int depth)
+{
+        const DocumentNode &node = data.nodes.at(index);
+
+        if((node.type == '{') && (depth == 0))
+        {
+                QVariantMap map;
+
+                for(int key = index + 1; key < node.next; key = data.nodes.at(data.nodes.at(key).next).next)
+                {
+                        map[data.decodeKey(key)] = decodeParallel(data, data.nodes.at(key).next, depth + 1);
+                }
+
+                return map;
+        }
+
+        if((node.type != '[') || (node.count < Json::parallelThreshold()) || (depth > 1))
+        {
+                return data.decode(index);
+        }
+
+        //Split the elements into one run for each thread, and decode the first run in this thread
+        const int runs = qMax(1, qMin(QThread::idealThreadCount(), node.count / 16));
+        QList<ElementRange> ranges;
+        int element = index + 1;
+
+        for(int i = 0; i < runs; i++)
+        {
+                const ElementRange range = { &data, element, (node.count * (i + 1)) / runs - (node.count * i) / runs };
+                ranges.append(range);
+
+                for(int j = 0; j < range.count; j++)
+                {
+                        element = data.nodes.at(element).next;
+                }
+        }
+
+        QList<QFuture<QVariantList> > futures;
+
+        for(int i = 1; i < runs; i++)
+        {
+                futures.append(QtConcurrent::run(decodeElements, ranges.at(i)));
+        }
+
+        //The runs are assembled in document order
+        QVariantList list = decodeElements(ranges.first());
+
+        for(int i = 0; i < futures.size(); i++)
+        {
+                list += futures[i].result();
+        }
+
+        return list;
+}
+
+/**
+ * Check, without indexing the document, whether it has an array that would
+ * be decoded in parallel: a top-level array, or an array member of a
+ * top-level object, with at least the given number of elements
+ */
+static bool hasParallelArray(const QByteArray &json, int elements)
+{
+        const char *data = json.constData();
+        const int size = json.size();
+        int i = 0;
+
+        while((i < size) && (isWhitespace(data[i])))
+        {
+                i++;
+        }
+
+        if((i == size) || ((data[i] != '[') && (data[i] != '{')))
+        {
+                return false;
+        }
+
+        const char topLevel = data[i];
+        int depth = 0;
+        int arrayDepth = 0;
+        int commas = 0;
+
+        for(; i < size; i++)
+        {
+                switch(data[i])
+                {
+                        case '"':
+                                //Strings are skipped, along with any escaped quotes they contain
+                                for(i++; (i < size) && (data[i] != '"'); i++)
+                                {
+                                        if(data[i] == '\\')
+                                        {
+                                                i++;
+                                        }
+                                }
+
+                                break;
+                        case '[':
+                        case '{':
+                                depth++;
+
+                                if((data[i] == '[') && ((depth == 1) || ((depth == 2) && (topLevel == '{'))))
+                                {
+                                        arrayDepth = depth;
+                                        commas = 0;
+
+                                        if(elements <= 1)
+                                        {
+                                                return true;
+                                        }
+                                }
+
+                                break;
+                        case ']':
+                        case '}':
+                                if(depth == arrayDepth)
+                                {
+                                        arrayDepth = 0;
+                                }
+
+                                depth--;
+                                break;
+                        case ',':
+                                //The array has one more element than it has separators
+                                if((depth == arrayDepth) && (++commas + 1 >= elements))
+                                {
+                                        return true;
+                                }
+
+                                break;
+                        default:
+                                break;
+                }
+        }
+
+        return false;
 }
+#endif
 
-static QByteArray join(const QList<QByteArray> &list, const QByteArray &sep)
+/**
+ * Parse a large document by indexing it, and decoding its large arrays in parallel
+ *
+ * \return bool false if the document should be parsed serially instead
+ */
+bool Json::parseParallel(const QByteArray &json, QVariant &result)
 {
-        QByteArray res;
-        Q_FOREACH(const QByteArray &i, list)
+#ifndef QT_NO_CONCURRENT
+        const int elements = parallelThreshold();
+
+        if((json.size() < PARALLEL_MIN_SIZE) || (elements <= 0) || (QThread::idealThreadCount() < 2))
         {
-                if(!res.isEmpty())
-                {
-                        res += sep;
-                }
-                res += i;
+                return false;
+        }
+
+        //The document is only indexed if it has an array that is large enough
+        if(!hasParallelArray(json, elements))
+        {
+                return false;
+        }
+
+        //Invalid documents are left to the serial parser, so that they fail in the same way
+        const Document document(json);
+
+        if(!document.isValid())
+        {
+                return false;
         }
-        return res;
+
+        result = decodeParallel(*document.d, document.index, 0);
+        return true;
+#else
+        Q_UNUSED(json);
+        Q_UNUSED(result);
+        return false;
+#endif
 }
 
 /**
- * parse
+ * \class ObjectDecoder
+ * \brief Decodes parse events directly into the objects of a list
+ *
+ * The members of each target object are matched against the fields of the
+ * object type. Values of known fields that are objects or arrays are built
+ * with a DomBuilder, and all other nested values are ignored.
  */
-QVariant Json::parse(const QString &json)
+class ObjectDecoder : public Handler
+{
+        public:
+                ObjectDecoder(const ObjectType &t, void *l);
+
+                void startObject();
+                void endObject();
+                void startArray();
+                void endArray();
+                void key(const QString &key);
+                void value(const QVariant &value);
+
+        private:
+                bool startContainer(bool object);
+                bool endContainer(bool object);
+
+                const ObjectType &type;
+
+                void *list;
+
+                //The number of open containers
+                int depth;
+
+                //The object being decoded, whose members are at objectDepth
+                void *object;
+                int objectDepth;
+
+                //The depth of the elements of the array of target objects, or 0
+                int elementsDepth;
+
+                //The field to which the next value is assigned
+                const Field *field;
+
+                //Whether the next value is the "list" member of the top-level object
+                bool listKey;
+
+                //Builds an object or array value of a field
+                DomBuilder builder;
+                int builderDepth;
+};
+
+ObjectDecoder::ObjectDecoder(const ObjectType &t, void *l) :
+        type(t),
+        list(l),
+        depth(0),
+        object(0),
+        objectDepth(0),
+        elementsDepth(0),
+        field(0),
+        listKey(false),
+        builderDepth(0)
 {
-        bool success = true;
-        return Json::parse(json, success);
 }
 
 /**
- * parse
+ * Pass the start of a container to the builder if it belongs to a field value
  */
-QVariant Json::parse(const QString &json, bool &success)
+bool ObjectDecoder::startContainer(bool isObject)
 {
-        success = true;
-
-        //Return an empty QVariant if the JSON data is either null or empty
-        if(!json.isNull() || !json.isEmpty())
+        if((builderDepth == 0) && (field) && (object) && (depth == objectDepth))
         {
-                QString data = json;
-                //We'll start from index 0
-                int index = 0;
-
-                //Parse the first value
-                QVariant value = Json::parseValue(data, index, success);
+                builder.reset();
+        }
+        else if(builderDepth == 0)
+        {
+                return false;
+        }
 
-                //Return the parsed value
-                return value;
+        if(isObject)
+        {
+                builder.startObject();
         }
         else
         {
-                //Return the empty QVariant
-                return QVariant();
+                builder.startArray();
         }
-}
 
-QByteArray Json::serialize(const QVariant &data)
-{
-        bool success = true;
-        return Json::serialize(data, success);
+        builderDepth++;
+        depth++;
+        return true;
 }
 
-QByteArray Json::serialize(const QVariant &data, bool &success)
+/**
+ * Pass the end of a container to the builder, and assign the value once it is complete
+ */
+bool ObjectDecoder::endContainer(bool isObject)
 {
-        QByteArray str;
-        success = true;
-
-        if(!data.isValid()) // invalid or null?
+        if(builderDepth == 0)
         {
-                str = "null";
+                return false;
         }
-        else if((data.type() == QVariant::List) || (data.type() == QVariant::StringList)) // variant is a list?
-        {
-                QList<QByteArray> values;
-                const QVariantList list = data.toList();
-                Q_FOREACH(const QVariant& v, list)
-                {
-                        QByteArray serializedValue = serialize(v);
-                        if(serializedValue.isNull())
-                        {
-                                success = false;
-                                break;
-                        }
-                        values << serializedValue;
-                }
 
-                str = "[ " + join( values, ", " ) + " ]";
+        if(isObject)
+        {
+                builder.endObject();
         }
-        else if(data.type() == QVariant::Map) // variant is a map?
+        else
         {
-                const QVariantMap vmap = data.toMap();
-                QMapIterator<QString, QVariant> it( vmap );
-                str = "{ ";
-                QList<QByteArray> pairs;
-                while(it.hasNext())
-                {
-                        it.next();
-                        QByteArray serializedValue = serialize(it.value());
-                        if(serializedValue.isNull())
-                        {
-                                success = false;
-                                break;
-                        }
-                        pairs << sanitizeString(it.key()).toUtf8() + " : " + serializedValue;
-                }
-                str += join(pairs, ", ");
-                str += " }";
+                builder.endArray();
         }
-        else if((data.type() == QVariant::String) || (data.type() == QVariant::ByteArray)) // a string or a byte array?
+
+        builderDepth--;
+        depth--;
+
+        if(builderDepth == 0)
         {
-                str = sanitizeString(data.toString()).toUtf8();
+                field->assign(object, builder.root);
+                field = 0;
         }
-        else if(data.type() == QVariant::Double) // double?
+
+        return true;
+}
+
+void ObjectDecoder::startObject()
+{
+        if(startContainer(true))
         {
-                str = QByteArray::number(data.toDouble());
-                if(!str.contains(".") && ! str.contains("e"))
-                {
-                        str += ".0";
-                }
+                return;
         }
-        else if (data.type() == QVariant::Bool) // boolean value?
+
+        if((depth == 0) || (depth == elementsDepth))
         {
-                str = data.toBool() ? "true" : "false";
+                object = type.append(list);
+                objectDepth = depth + 1;
         }
-        else if (data.type() == QVariant::ULongLong) // large unsigned number?
+
+        listKey = false;
+        field = 0;
+        depth++;
+}
+
+void ObjectDecoder::endObject()
+{
+        if(endContainer(true))
         {
-                str = QByteArray::number(data.value<qulonglong>());
+                return;
         }
-        else if ( data.canConvert<qlonglong>() ) // any signed number?
+
+        depth--;
+
+        if((object) && (depth + 1 == objectDepth))
         {
-                str = QByteArray::number(data.value<qlonglong>());
+                object = 0;
         }
-        else if (data.canConvert<long>())
+}
+
+void ObjectDecoder::startArray()
+{
+        if(startContainer(false))
         {
-                str = QString::number(data.value<long>()).toUtf8();
+                return;
         }
-        else if (data.canConvert<QString>()) // can value be converted to string?
+
+        if(depth == 0)
         {
-                // this will catch QDate, QDateTime, QUrl, ...
-                str = sanitizeString(data.toString()).toUtf8();
+                elementsDepth = 1;
         }
-        else
+        else if(listKey)
         {
-                success = false;
+                //A list response, so the top-level object is not decoded
+                type.clear(list);
+                object = 0;
+                elementsDepth = 2;
         }
-        if (success)
+
+        listKey = false;
+        field = 0;
+        depth++;
+}
+
+void ObjectDecoder::endArray()
+{
+        if(endContainer(false))
         {
-                return str;
+                return;
         }
-        else
+
+        depth--;
+
+        if(depth + 1 == elementsDepth)
         {
-                return QByteArray();
+                elementsDepth = 0;
         }
 }
 
-/**
- * parseValue
- */
-QVariant Json::parseValue(const QString &json, int &index, bool &success)
+void ObjectDecoder::key(const QString &key)
 {
-        //Determine what kind of data we should parse by
-        //checking out the upcoming token
-        switch(Json::lookAhead(json, index))
+        if(builderDepth > 0)
         {
-                case JsonTokenString:
-                        return Json::parseString(json, index, success);
-                case JsonTokenNumber:
-                        return Json::parseNumber(json, index);
-                case JsonTokenCurlyOpen:
-                        return Json::parseObject(json, index, success);
-                case JsonTokenSquaredOpen:
-                        return Json::parseArray(json, index, success);
-                case JsonTokenTrue:
-                        Json::nextToken(json, index);
-                        return QVariant(true);
-                case JsonTokenFalse:
-                        Json::nextToken(json, index);
-                        return QVariant(false);
-                case JsonTokenNull:
-                        Json::nextToken(json, index);
-                        return QVariant();
-                case JsonTokenNone:
-                        break;
+                builder.key(key);
+                return;
         }
 
-        //If there were no tokens, flag the failure and return an empty QVariant
-        success = false;
-        return QVariant();
-}
+        field = 0;
+        listKey = false;
 
-/**
- * parseObject
- */
-QVariant Json::parseObject(const QString &json, int &index, bool &success)
-{
-        QVariantMap map;
-        int token;
+        if((!object) || (depth != objectDepth))
+        {
+                return;
+        }
 
-        //Get rid of the whitespace and increment index
-        Json::nextToken(json, index);
+        //The "list" member of the top-level object is never a field, as it may hold the target objects
+        listKey = (depth == 1) && (key == QLatin1String("list"));
 
-        //Loop through all of the key/value pairs of the object
-        bool done = false;
-        while(!done)
+        if(listKey)
         {
-                //Get the upcoming token
-                token = Json::lookAhead(json, index);
+                return;
+        }
 
-                if(token == JsonTokenNone)
-                {
-                         success = false;
-                         return QVariantMap();
-                }
-                else if(token == JsonTokenComma)
-                {
-                        Json::nextToken(json, index);
-                }
-                else if(token == JsonTokenCurlyClose)
+        for(int i = 0; i < type.count; i++)
+        {
+                if(key == QLatin1String(type.fields[i].name))
                 {
-                        Json::nextToken(json, index);
-                        return map;
+                        field = type.fields + i;
                 }
-                else
-                {
-                        //Parse the key/value pair's name
-                        QString name = Json::parseString(json, index, success).toString();
-
-                        if(!success)
-                        {
-                                return QVariantMap();
-                        }
-
-                        //Get the next token
-                        token = Json::nextToken(json, index);
-
-                        //If the next token is not a colon, flag the failure
-                        //return an empty QVariant
-                        if(token != JsonTokenColon)
-                        {
-                                success = false;
-                                return QVariant(QVariantMap());
-                        }
-
-                        //Parse the key/value pair's value
-                        QVariant value = Json::parseValue(json, index, success);
+        }
+}
 
-                        if(!success)
-                        {
-                                return QVariantMap();
-                        }
+void ObjectDecoder::value(const QVariant &value)
+{
+        if(builderDepth > 0)
+        {
+                builder.value(value);
+                return;
+        }
 
-                        //Assign the value to the key in the map
-                        map[name] = value;
-                }
+        if((field) && (object) && (depth == objectDepth))
+        {
+                field->assign(object, value);
         }
 
-        //Return the map successfully
-        return QVariant(map);
+        field = 0;
+        listKey = false;
 }
 
 /**
- * parseArray
+ * parseObjects
  */
-QVariant Json::parseArray(const QString &json, int &index, bool &success)
+bool Json::parseObjects(const QByteArray &json, const ObjectType &type, void *list)
 {
-        QVariantList list;
+        ObjectDecoder decoder(type, list);
+        Parser parser(&decoder);
+        parser.addData(json.isNull() ? QByteArray("") : json);
 
-        Json::nextToken(json, index);
-
-        bool done = false;
-        while(!done)
+        if(!parser.finish())
         {
-                int token = Json::lookAhead(json, index);
-
-                if(token == JsonTokenNone)
-                {
-                        success = false;
-                        return QVariantList();
-                }
-                else if(token == JsonTokenComma)
-                {
-                        Json::nextToken(json, index);
-                }
-                else if(token == JsonTokenSquaredClose)
-                {
-                        Json::nextToken(json, index);
-                        break;
-                }
-                else
-                {
-                        QVariant value = Json::parseValue(json, index, success);
-
-                        if(!success)
-                        {
-                                return QVariantList();
-                        }
-
-                        list.push_back(value);
-                }
+                type.clear(list);
+                return false;
         }
 
-        return QVariant(list);
+        return true;
 }
 
 /**
- * parseString
+ * Assign the members of an indexed object with known keys
  */
-QVariant Json::parseString(const QString &json, int &index, bool &success)
+static void decodeObject(const DocumentData &data, int index, const ObjectType &type, const QList<QByteArray> &names,
+                         void *list)
 {
-        QString s;
-        QChar c;
-
-        Json::eatWhitespace(json, index);
+        void *object = type.append(list);
+        const int end = data.nodes.at(index).next;
 
-        c = json[index++];
-
-        bool complete = false;
-        while(!complete)
+        for(int member = index + 1; member < end; member = data.nodes.at(data.nodes.at(member).next).next)
         {
-                if(index == json.size())
-                {
-                        break;
-                }
-
-                c = json[index++];
-
-                if(c == '\"')
+                for(int i = 0; i < type.count; i++)
                 {
-                        complete = true;
-                        break;
-                }
-                else if(c == '\\')
-                {
-                        if(index == json.size())
+                        if(data.keyEquals(member, names.at(i)))
                         {
+                                type.fields[i].assign(object, data.decode(data.nodes.at(member).next));
                                 break;
                         }
-
-                        c = json[index++];
-
-                        if(c == '\"')
-                        {
-                                s.append('\"');
-                        }
-                        else if(c == '\\')
-                        {
-                                s.append('\\');
-                        }
-                        else if(c == '/')
-                        {
-                                s.append('/');
-                        }
-                        else if(c == 'b')
-                        {
-                                s.append('\b');
-                        }
-                        else if(c == 'f')
-                        {
-                                s.append('\f');
-                        }
-                        else if(c == 'n')
-                        {
-                                s.append('\n');
-                        }
-                        else if(c == 'r')
-                        {
-                                s.append('\r');
-                        }
-                        else if(c == 't')
-                        {
-                                s.append('\t');
-                        }
-                        else if(c == 'u')
-                        {
-                                int remainingLength = json.size() - index;
-
-                                if(remainingLength >= 4)
-                                {
-                                        QString unicodeStr = json.mid(index, 4);
-
-                                        int symbol = unicodeStr.toInt(0, 16);
-
-                                        s.append(QChar(symbol));
-
-                                        index += 4;
-                                }
-                                else
-                                {
-                                        break;
-                                }
-                        }
-                }
-                else
-                {
-                        s.append(c);
                 }
         }
-
-        if(!complete)
-        {
-                success = false;
-                return QVariant();
-        }
-
-        return QVariant(s);
 }
 
 /**
- * parseNumber
+ * decodeObjects
  */
-QVariant Json::parseNumber(const QString &json, int &index)
+void Json::decodeObjects(const Document &document, const ObjectType &type, void *list)
 {
-        Json::eatWhitespace(json, index);
+        Document objects = document;
 
-        int lastIndex = Json::lastIndexOfNumber(json, index);
-        int charLength = (lastIndex - index) + 1;
-        QString numberStr;
+        if(document.isObject())
+        {
+                const Document elements = document.value(QLatin1String("list"));
 
-        numberStr = json.mid(index, charLength);
+                if(elements.isArray())
+                {
+                        objects = elements;
+                }
+        }
 
-        index = lastIndex + 1;
+        QList<QByteArray> names;
 
-        if (numberStr.contains('.')) {
-                return QVariant(numberStr.toDouble(NULL));
-        } else if (numberStr.startsWith('-')) {
-                return QVariant(numberStr.toLongLong(NULL));
-        } else {
-                return QVariant(numberStr.toULongLong(NULL));
+        for(int i = 0; i < type.count; i++)
+        {
+                names.append(QByteArray::fromRawData(type.fields[i].name, qstrlen(type.fields[i].name)));
         }
-}
-
-/**
- * lastIndexOfNumber
- */
-int Json::lastIndexOfNumber(const QString &json, int index)
-{
-        int lastIndex;
 
-        for(lastIndex = index; lastIndex < json.size(); lastIndex++)
+        if(objects.isObject())
         {
-                if(QString("0123456789+-.eE").indexOf(json[lastIndex]) == -1)
+                decodeObject(*objects.d, objects.index, type, names, list);
+        }
+        else if(objects.isArray())
+        {
+                const DocumentData &data = *objects.d;
+                const int end = data.nodes.at(objects.index).next;
+
+                for(int element = objects.index + 1; element < end; element = data.nodes.at(element).next)
                 {
-                        break;
+                        if(data.nodes.at(element).type == '{')
+                        {
+                                decodeObject(data, element, type, names, list);
+                        }
                 }
         }
-
-        return lastIndex -1;
 }
 
 /**
- * eatWhitespace
+ * Assign the members of a map with known keys
  */
-void Json::eatWhitespace(const QString &json, int &index)
+static void decodeObject(const QVariantMap &map, const ObjectType &type, void *list)
 {
-        for(; index < json.size(); index++)
+        void *object = type.append(list);
+
+        for(int i = 0; i < type.count; i++)
         {
-                if(QString(" \t\n\r").indexOf(json[index]) == -1)
+                const QVariantMap::const_iterator iterator = map.constFind(QLatin1String(type.fields[i].name));
+
+                if(iterator != map.constEnd())
                 {
-                        break;
+                        type.fields[i].assign(object, iterator.value());
                 }
         }
 }
 
 /**
- * lookAhead
- */
-int Json::lookAhead(const QString &json, int index)
-{
-        int saveIndex = index;
-        return Json::nextToken(json, saveIndex);
-}
-
-/**
- * nextToken
+ * decodeObjects
  */
-int Json::nextToken(const QString &json, int &index)
+void Json::decodeObjects(const QVariant &data, const ObjectType &type, void *list)
 {
-        Json::eatWhitespace(json, index);
-
-        if(index == json.size())
-        {
-                return JsonTokenNone;
-        }
+        QVariant objects = data;
 
-        QChar c = json[index];
-        index++;
-        switch(c.toLatin1())
+        if(data.type() == QVariant::Map)
         {
-                case '{': return JsonTokenCurlyOpen;
-                case '}': return JsonTokenCurlyClose;
-                case '[': return JsonTokenSquaredOpen;
-                case ']': return JsonTokenSquaredClose;
-                case ',': return JsonTokenComma;
-                case '"': return JsonTokenString;
-                case '0': case '1': case '2': case '3': case '4':
-                case '5': case '6': case '7': case '8': case '9':
-                case '-': return JsonTokenNumber;
-                case ':': return JsonTokenColon;
-        }
-
-        index--;
+                const QVariant elements = data.toMap().value(QLatin1String("list"));
 
-        int remainingLength = json.size() - index;
-
-        //True
-        if(remainingLength >= 4)
-        {
-                if (json[index] == 't' && json[index + 1] == 'r' &&
-                        json[index + 2] == 'u' && json[index + 3] == 'e')
+                if(elements.type() == QVariant::List)
                 {
-                        index += 4;
-                        return JsonTokenTrue;
+                        objects = elements;
                 }
         }
 
-        //False
-        if (remainingLength >= 5)
+        if(objects.type() == QVariant::Map)
         {
-                if (json[index] == 'f' && json[index + 1] == 'a' &&
-                        json[index + 2] == 'l' && json[index + 3] == 's' &&
-                        json[index + 4] == 'e')
-                {
-                        index += 5;
-                        return JsonTokenFalse;
-                }
+                decodeObject(objects.toMap(), type, list);
         }
-
-        //Null
-        if (remainingLength >= 4)
+        else if(objects.type() == QVariant::List)
         {
-                if (json[index] == 'n' && json[index + 1] == 'u' &&
-                        json[index + 2] == 'l' && json[index + 3] == 'l')
+                const QVariantList elements = objects.toList();
+
+                for(int i = 0; i < elements.size(); i++)
                 {
-                        index += 4;
-                        return JsonTokenNull;
+                        if(elements.at(i).type() == QVariant::Map)
+                        {
+                                decodeObject(elements.at(i).toMap(), type, list);
+                        }
                 }
         }
-
-        return JsonTokenNone;
 }
 
-
 } //end namespace
@@ -35,6 +35,13 @@
 
 #include <QVariant>
 #include <QString>
+#include <QByteArray>
+#include <QStringList>
+#include <QSharedData>
+#include <QHash>
+#include <QVector>
+
+class QIODevice;
 
 namespace QtJson
 {
@@ -58,6 +65,164 @@ enum JsonToken
         JsonTokenNull = 11
 };
 
+class WriterPrivate;
+
+/**
+ * \class Writer
+ * \brief A streaming JSON serializer
+ *
+ * Writer serializes a QVariant hierarchy in a single pass, appending
+ * directly to a QByteArray or writing to a QIODevice. Strings are escaped
+ * and encoded as UTF-8 as they are written, without intermediate copies.
+ */
+class Writer
+{
+        public:
+                /**
+                 * \enum Format
+                 */
+                enum Format
+                {
+                        Padded = 0, //Spaces around separators, as in "{ \"a\" : [ 1, 2 ] }"
+                        Compact = 1 //No whitespace, as in "{\"a\":[1,2]}"
+                };
+
+                /**
+                 * Constructs a writer that appends to a byte array
+                 *
+                 * \param buffer The byte array, which must outlive the writer
+                 * \param format The output format
+                 */
+                explicit Writer(QByteArray *buffer, Format format = Padded);
+
+                /**
+                 * Constructs a writer that writes to a device
+                 *
+                 * Output is buffered in chunks of 4KB. Each chunk is
+                 * written to the device as soon as it is full, which can
+                 * be in the middle of a value or token, and the rest of
+                 * the output is written before write() returns. A reader
+                 * of the device may therefore see a partial value until
+                 * write() has returned.
+                 *
+                 * \param device The open device, which must outlive the writer
+                 * \param format The output format
+                 */
+                explicit Writer(QIODevice *device, Format format = Padded);
+
+                ~Writer();
+
+                /**
+                 * \return Format The output format
+                 */
+                Format format() const;
+
+                /**
+                 * Write a complete JSON value
+                 *
+                 * If the value cannot be serialized, the output written
+                 * so far is left in place.
+                 *
+                 * \param data The value
+                 *
+                 * \return bool true if the value was serialized and written
+                 */
+                bool write(const QVariant &data);
+
+        private:
+                Writer(const Writer &);
+                Writer &operator=(const Writer &);
+
+                WriterPrivate *d;
+};
+
+/**
+ * \struct Field
+ * \brief Maps the key of a JSON object member to a member of a struct
+ *
+ * Fields are usually declared in a table, using assignField() to
+ * generate the assignment at compile time:
+ *
+ * \code
+ * { "title", &QtJson::assignField<Video, QString, &Video::title> }
+ * \endcode
+ */
+struct Field
+{
+        //The key of the JSON object member
+        const char *name;
+
+        //Assigns a decoded value to the struct member
+        void (*assign)(void *object, const QVariant &value);
+};
+
+/**
+ * Assign a decoded value to a member of an object of type T
+ */
+template <typename T, typename M, M T::*member>
+void assignField(void *object, const QVariant &value)
+{
+        static_cast<T*>(object)->*member = value.value<M>();
+}
+
+/**
+ * \struct Schema
+ * \brief Describes how JSON objects are decoded into a struct T
+ *
+ * Schema is specialized for each type used with Json::parseInto():
+ *
+ * \code
+ * template <> struct Schema<Video>
+ * {
+ *         static const Field *fields();
+ *         static int count();
+ * };
+ * \endcode
+ */
+template <typename T> struct Schema;
+
+/**
+ * \struct ObjectType
+ * \brief The operations used by Json::parseInto() to decode objects into a QVector<T>
+ */
+struct ObjectType
+{
+        //The fields of T
+        const Field *fields;
+
+        //The number of fields
+        int count;
+
+        //Append a default constructed T to the list, and return it
+        void *(*append)(void *list);
+
+        //Remove all objects from the list
+        void (*clear)(void *list);
+};
+
+template <typename T>
+void *appendObject(void *list)
+{
+        QVector<T> *vector = static_cast<QVector<T>*>(list);
+        vector->append(T());
+        return &vector->last();
+}
+
+template <typename T>
+void clearObjects(void *list)
+{
+        static_cast<QVector<T>*>(list)->clear();
+}
+
+template <typename T>
+ObjectType objectType()
+{
+        const ObjectType type = { Schema<T>::fields(), Schema<T>::count(), &appendObject<T>, &clearObjects<T> };
+        return type;
+}
+
+class Document;
+
 /**
  * \class Json
  * \brief A JSON data parser
@@ -82,6 +247,49 @@ class Json
                  */
                 static QVariant parse(const QString &json, bool &success);
 
+                /**
+                 * Parse UTF-8 encoded JSON data
+                 *
+                 * The data is scanned byte by byte, and string values
+                 * are decoded only when they are materialized.
+                 *
+                 * \param json The UTF-8 encoded JSON data
+                 */
+                static QVariant parse(const QByteArray &json);
+
+                /**
+                 * Parse UTF-8 encoded JSON data
+                 *
+                 * \param json The UTF-8 encoded JSON data
+                 * \param success The success of the parsing
+                 */
+                static QVariant parse(const QByteArray &json, bool &success);
+
+                /**
+                 * Set the number of elements at which arrays are decoded in parallel
+                 *
+                 * Large documents whose top level is an array, or an object
+                 * with an array member, of at least this many elements are
+                 * first indexed in a single pass. That is checked by a scan
+                 * that does not build the index. The elements of the array
+                 * are then decoded across the threads of the global
+                 * QThreadPool. The result is the same as a serial parse.
+                 *
+                 * Requests reach this path when they parse a response in
+                 * the background without a projection. Responses parsed as
+                 * they are received, or lazily, are not decoded in parallel.
+                 *
+                 * This should be set before parsing in several threads.
+                 *
+                 * \param elements The number of elements, or 0 to always parse serially
+                 */
+                static void setParallelThreshold(int elements);
+
+                /**
+                 * \return int The number of elements at which arrays are decoded in parallel
+                 */
+                static int parallelThreshold();
+
                 /**
                 * This method generates a textual JSON representation
                 *
@@ -100,104 +308,523 @@ class Json
                 */
                 static QByteArray serialize(const QVariant &data, bool &success);
 
+                /**
+                * This method generates a textual JSON representation
+                *
+                * \param data The JSON data generated by the parser.
+                * \param format The output format
+                *
+                * \return QByteArray Textual JSON representation
+                */
+                static QByteArray serialize(const QVariant &data, Writer::Format format);
+
+                /**
+                * This method generates a textual JSON representation
+                *
+                * \param data The JSON data generated by the parser.
+                * \param format The output format
+                * \param success The success of the serialization
+                *
+                * \return QByteArray Textual JSON representation
+                */
+                static QByteArray serialize(const QVariant &data, Writer::Format format, bool &success);
+
+                /**
+                 * Encode a value in the binary snapshot format
+                 *
+                 * Snapshots store strings with a length prefix, object
+                 * keys once in a key table, and numbers with their types,
+                 * so they can be decoded without scanning or converting
+                 * text. The data begins with a version header. The same
+                 * values are accepted as by serialize(). Decoding gives
+                 * back the value with the types that parsing the
+                 * serialized JSON would give, but strings and doubles are
+                 * kept exactly.
+                 *
+                 * \param data The JSON data generated by the parser.
+                 *
+                 * \return QByteArray The encoded data
+                 */
+                static QByteArray toBinary(const QVariant &data);
+
+                /**
+                 * Encode a value in the binary snapshot format
+                 *
+                 * \param data The JSON data generated by the parser.
+                 * \param success The success of the encoding
+                 *
+                 * \return QByteArray The encoded data
+                 */
+                static QByteArray toBinary(const QVariant &data, bool &success);
+
+                /**
+                 * Decode data in the binary snapshot format
+                 *
+                 * \param data The encoded data
+                 */
+                static QVariant fromBinary(const QByteArray &data);
+
+                /**
+                 * Decode data in the binary snapshot format
+                 *
+                 * Decoding fails if the data is truncated or corrupt, or
+                 * was encoded with another version of the format.
+                 *
+                 * \param data The encoded data
+                 * \param success The success of the decoding
+                 */
+                static QVariant fromBinary(const QByteArray &data, bool &success);
+
+                /**
+                 * Decode UTF-8 encoded JSON data directly into structs
+                 *
+                 * The decoded objects are the elements of a top-level
+                 * array, the elements of the "list" array of a top-level
+                 * object, as in a list response, or else the top-level
+                 * object itself. Members are assigned as they are parsed,
+                 * using the fields of Schema<T>, and no QVariant hierarchy
+                 * is built. Members with unknown keys are skipped.
+                 *
+                 * \param json The UTF-8 encoded JSON data
+                 *
+                 * \return QVector<T> The decoded objects
+                 */
+                template <typename T>
+                static QVector<T> parseInto(const QByteArray &json);
+
+                /**
+                 * Decode UTF-8 encoded JSON data directly into structs
+                 *
+                 * \param json The UTF-8 encoded JSON data
+                 * \param success The success of the parsing
+                 *
+                 * \return QVector<T> The decoded objects, or an empty vector if parsing fails
+                 */
+                template <typename T>
+                static QVector<T> parseInto(const QByteArray &json, bool &success);
+
+                /**
+                 * Decode the objects of a document into structs
+                 *
+                 * Only the members with known keys are decoded.
+                 *
+                 * \param document The document
+                 *
+                 * \return QVector<T> The decoded objects
+                 */
+                template <typename T>
+                static QVector<T> parseInto(const Document &document);
+
+                /**
+                 * Decode the objects of a QVariant hierarchy into structs
+                 *
+                 * \param data The JSON data generated by the parser.
+                 *
+                 * \return QVector<T> The decoded objects
+                 */
+                template <typename T>
+                static QVector<T> parseInto(const QVariant &data);
+
+        private:
+                static bool parseParallel(const QByteArray &json, QVariant &result);
+
+                static bool parseObjects(const QByteArray &json, const ObjectType &type, void *list);
+
+                static void decodeObjects(const Document &document, const ObjectType &type, void *list);
+
+                static void decodeObjects(const QVariant &data, const ObjectType &type, void *list);
+};
+
+/**
+ * \class Handler
+ * \brief An interface for receiving JSON parse events
+ *
+ * A Handler can be passed to Parser in order to process JSON data
+ * as it is tokenized, without building a QVariant hierarchy. Events are
+ * delivered in document order. The default implementations do nothing,
+ * so only the events of interest need to be reimplemented.
+ */
+class Handler
+{
+        public:
+                virtual ~Handler() {}
+
+                /**
+                 * Called when an object is opened
+                 */
+                virtual void startObject() {}
+
+                /**
+                 * Called when the innermost open object is closed
+                 */
+                virtual void endObject() {}
+
+                /**
+                 * Called when an array is opened
+                 */
+                virtual void startArray() {}
+
+                /**
+                 * Called when the innermost open array is closed
+                 */
+                virtual void endArray() {}
+
+                /**
+                 * Called with the key of the next member of the innermost open object
+                 *
+                 * \param key The member key
+                 */
+                virtual void key(const QString &key) { Q_UNUSED(key); }
+
+                /**
+                 * Called with each string, number, boolean or null value
+                 *
+                 * \param value The value, which is invalid for null
+                 */
+                virtual void value(const QVariant &value) { Q_UNUSED(value); }
+};
+
+/**
+ * \class KeyPool
+ * \brief A pool of decoded object keys
+ *
+ * The objects in a JSON array usually repeat the same keys. KeyPool maps
+ * the UTF-8 encoding of each key to a single decoded QString, so that
+ * every occurrence of the key shares the same implicitly shared string
+ * instead of allocating its own.
+ *
+ * A pool may be shared by several parsers, as long as they are used from
+ * the same thread.
+ */
+class KeyPool
+{
+        public:
+                /**
+                 * Constructs an empty pool
+                 *
+                 * \param maximumSize The maximum number of keys held by the pool
+                 */
+                explicit KeyPool(int maximumSize = 4096);
+
+                /**
+                 * Get the decoded key for UTF-8 encoded data
+                 *
+                 * The key is added to the pool if it is not already
+                 * there, unless the pool is full.
+                 *
+                 * \param utf8 The UTF-8 encoded key
+                 * \param length The length of the encoded key
+                 *
+                 * \return QString The decoded key
+                 */
+                QString key(const char *utf8, int length);
+
+                /**
+                 * \return int The number of keys in the pool
+                 */
+                int count() const;
+
+                /**
+                 * \return int The maximum number of keys held by the pool
+                 */
+                int maximumSize() const;
+
+                /**
+                 * Set the maximum number of keys held by the pool
+                 *
+                 * Keys already in the pool are kept.
+                 *
+                 * \param maximumSize The maximum number of keys
+                 */
+                void setMaximumSize(int maximumSize);
+
+                /**
+                 * Remove all keys from the pool
+                 */
+                void clear();
+
         private:
+                KeyPool(const KeyPool &);
+                KeyPool &operator=(const KeyPool &);
+
+                QHash<QByteArray, QString> keys;
+
+                int maximum;
+};
+
+class ParserPrivate;
+
+/**
+ * \class Parser
+ * \brief An incremental JSON data parser
+ *
+ * Parser is the tokenizer used for all JSON parsing. It accepts UTF-8
+ * encoded JSON data in chunks of any size and keeps
+ * its state across chunk boundaries, including partial strings, escapes
+ * and numbers. This allows the data to be parsed while it is still being
+ * received. Once all of the data has been added, result() returns the
+ * same QVariant hierarchy as Json::parse().
+ */
+class Parser
+{
+        public:
                 /**
-                 * Parses a value starting from index
+                 * Constructs a parser
                  *
-                 * \param json The JSON data
-                 * \param index The start index
-                 * \param success The success of the parse process
+                 * \param handler The handler that receives the parse events.
+                 * If no handler is given, the events are used to build the
+                 * QVariant hierarchy returned by result().
+                 */
+                explicit Parser(Handler *handler = 0);
+                ~Parser();
+
+                /**
+                 * Discard any parsed data and prepare to parse a new document
+                 */
+                void reset();
+
+                /**
+                 * Set the key paths to be parsed
+                 *
+                 * Each path is a list of object keys separated by '.', where
+                 * a key may be followed by "[*]" to select every element of
+                 * an array (e.g. "list[*].id"). A path beginning with "[*]"
+                 * applies to a root array. Values that are not on a
+                 * path, and not below the end of one, are skipped without
+                 * being decoded or validated. An empty list selects the
+                 * whole document.
+                 *
+                 * The projection is kept when the parser is reset, but any
+                 * parse in progress is discarded.
                  *
-                 * \return QVariant The parsed value
+                 * \param paths The key paths to be parsed
                  */
-                static QVariant parseValue(const QString &json, int &index,
-                                                                   bool &success);
+                void setProjection(const QStringList &paths);
 
                 /**
-                 * Parses an object starting from index
+                 * Get the key paths to be parsed
                  *
-                 * \param json The JSON data
-                 * \param index The start index
-                 * \param success The success of the object parse
+                 * \return QStringList The key paths set by setProjection()
+                 */
+                QStringList projection() const;
+
+                /**
+                 * Set the pool used to share decoded object keys
+                 *
+                 * By default, each parse uses its own pool, which is
+                 * cleared when the parser is reset. Setting a pool that
+                 * outlives the parser allows keys to be shared across
+                 * parses. The parser does not take ownership of the pool.
                  *
-                 * \return QVariant The parsed object map
+                 * \param pool The pool, or 0 to use a pool for each parse
                  */
-                static QVariant parseObject(const QString &json, int &index,
-                                                                           bool &success);
+                void setKeyPool(KeyPool *pool);
 
                 /**
-                 * Parses an array starting from index
+                 * Get the pool used to share decoded object keys
                  *
-                 * \param json The JSON data
-                 * \param index The starting index
-                 * \param success The success of the array parse
+                 * \return KeyPool The pool set by setKeyPool(), or 0
+                 */
+                KeyPool *keyPool() const;
+
+                /**
+                 * Parse the next chunk of JSON data
+                 *
+                 * Any data following the end of the first JSON value is ignored.
                  *
-                 * \return QVariant The parsed variant array
+                 * \param data The next chunk of UTF-8 encoded JSON data
+                 *
+                 * \return bool false if the data added so far is invalid
                  */
-                static QVariant parseArray(const QString &json, int &index,
-                                                                           bool &success);
+                bool addData(const QByteArray &data);
 
                 /**
-                 * Parses a string starting from index
+                 * Signal that all of the JSON data has been added
                  *
-                 * \param json The JSON data
-                 * \param index The starting index
-                 * \param success The success of the string parse
+                 * \return bool The success of the parsing
+                 */
+                bool finish();
+
+                /**
+                 * Check whether any data has been added since the last reset
                  *
-                 * \return QVariant The parsed string
+                 * \return bool true if no data has been added
                  */
-                static QVariant parseString(const QString &json, int &index,
-                                                                        bool &success);
+                bool isEmpty() const;
 
                 /**
-                 * Parses a number starting from index
+                 * Get the parsed value
                  *
-                 * \param json The JSON data
-                 * \param index The starting index
+                 * \return QVariant The parsed value. This is empty if a handler
+                 * was given or parsing has not finished successfully.
+                 */
+                QVariant result() const;
+
+        private:
+                Parser(const Parser &);
+                Parser &operator=(const Parser &);
+
+                ParserPrivate *d;
+};
+
+class DocumentData;
+
+/**
+ * \class Document
+ * \brief A lazily decoded JSON value
+ *
+ * Document keeps the UTF-8 encoded JSON data it was created from, along
+ * with a structural index of the offsets at which each value begins and
+ * ends. Nothing is decoded when the index is built. A string, number or
+ * container is only converted to a QVariant when it is read, so values
+ * that are never read cost no more than their index entry.
+ *
+ * Document is implicitly shared. The values returned by value(), at() and
+ * elements() share the data and index of the document they belong to.
+ */
+class Document
+{
+        public:
+                /**
+                 * Constructs an invalid document
+                 */
+                Document();
+
+                /**
+                 * Constructs a document by indexing JSON data
+                 *
+                 * The document is invalid if the data would not be accepted
+                 * by Json::parse().
                  *
-                 * \return QVariant The parsed number
+                 * \param json The UTF-8 encoded JSON data
                  */
-                static QVariant parseNumber(const QString &json, int &index);
+                explicit Document(const QByteArray &json);
+
+                Document(const Document &other);
+                ~Document();
+
+                Document &operator=(const Document &other);
 
                 /**
-                 * Get the last index of a number starting from index
+                 * Check whether this is a valid value
                  *
-                 * \param json The JSON data
-                 * \param index The starting index
+                 * \return bool false if the document could not be indexed, or
+                 * the value does not exist
+                 */
+                bool isValid() const;
+
+                /**
+                 * \return bool true if the value is a JSON object
+                 */
+                bool isObject() const;
+
+                /**
+                 * \return bool true if the value is a JSON array
+                 */
+                bool isArray() const;
+
+                /**
+                 * Get the number of members or elements of a container
                  *
-                 * \return The last index of the number
+                 * \return int The number of members of an object or elements
+                 * of an array, or 0 for any other value
                  */
-                static int lastIndexOfNumber(const QString &json, int index);
+                int count() const;
 
                 /**
-                 * Skip unwanted whitespace symbols starting from index
+                 * Get an element of an array
                  *
-                 * \param json The JSON data
-                 * \param index The start index
+                 * \param i The index of the element
+                 *
+                 * \return Document The element, or an invalid value if there is
+                 * no such element
                  */
-                static void eatWhitespace(const QString &json, int &index);
+                Document at(int i) const;
 
                 /**
-                 * Check what token lies ahead
+                 * Get all of the elements of an array, or the member values of
+                 * an object, in document order
                  *
-                 * \param json The JSON data
-                 * \param index The starting index
+                 * This is cheaper than calling at() for each element in turn.
                  *
-                 * \return int The upcoming token
+                 * \return QList<Document> The elements
                  */
-                static int lookAhead(const QString &json, int index);
+                QList<Document> elements() const;
 
                 /**
-                 * Get the next JSON token
+                 * Get a member of an object
                  *
-                 * \param json The JSON data
-                 * \param index The starting index
+                 * \param key The key of the member
                  *
-                 * \return int The next JSON token
+                 * \return Document The value of the last member with the key, or
+                 * an invalid value if there is no such member
                  */
-                static int nextToken(const QString &json, int &index);
+                Document value(const QString &key) const;
+
+                /**
+                 * Check whether an object has a member
+                 *
+                 * \param key The key of the member
+                 *
+                 * \return bool true if the object has a member with the key
+                 */
+                bool contains(const QString &key) const;
+
+                /**
+                 * Get the keys of an object
+                 *
+                 * \return QStringList The keys of the object, in document order
+                 */
+                QStringList keys() const;
+
+                /**
+                 * Decode the value
+                 *
+                 * \return QVariant The same value as Json::parse() would
+                 * return for it, or an empty QVariant if the value is invalid
+                 */
+                QVariant toVariant() const;
+
+        private:
+                Document(DocumentData *data, int i);
+
+                friend class Json;
+
+                QExplicitlySharedDataPointer<DocumentData> d;
+
+                int index;
 };
 
+template <typename T>
+QVector<T> Json::parseInto(const QByteArray &json)
+{
+        bool success = true;
+        return Json::parseInto<T>(json, success);
+}
+
+template <typename T>
+QVector<T> Json::parseInto(const QByteArray &json, bool &success)
+{
+        QVector<T> list;
+        success = parseObjects(json, objectType<T>(), &list);
+        return list;
+}
+
+template <typename T>
+QVector<T> Json::parseInto(const Document &document)
+{
+        QVector<T> list;
+        decodeObjects(document, objectType<T>(), &list);
+        return list;
+}
+
+template <typename T>
+QVector<T> Json::parseInto(const QVariant &data)
+{
+        QVector<T> list;
+        decodeObjects(data, objectType<T>(), &list);
+        return list;
+}
 
 } //end namespace
 
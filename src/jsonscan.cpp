@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "jsonscan_p.h"
+
+#ifdef QTJSON_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef QTJSON_HAVE_AVX2
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER) && defined(QTJSON_HAVE_SSE2)
+#include <intrin.h>
+#endif
+
+namespace QtJson
+{
+
+namespace Scan
+{
+
+static inline bool isWhitespace(char c)
+{
+        return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+static inline bool isStructural(char c)
+{
+        switch(c)
+        {
+                case '{':
+                case '}':
+                case '[':
+                case ']':
+                case '"':
+                case ',':
+                case ' ':
+                case '\t':
+                case '\n':
+                case '\r':
+                        return true;
+                default:
+                        return false;
+        }
+}
+
+/**
+ * Scalar kernels
+ */
+static int findQuoteOrBackslashScalar(const char *data, int index, int size)
+{
+        while((index < size) && (data[index] != '"') && (data[index] != '\\'))
+        {
+                index++;
+        }
+
+        return index;
+}
+
+static int skipWhitespaceScalar(const char *data, int index, int size)
+{
+        while((index < size) && (isWhitespace(data[index])))
+        {
+                index++;
+        }
+
+        return index;
+}
+
+static int findStructuralScalar(const char *data, int index, int size)
+{
+        while((index < size) && (!isStructural(data[index])))
+        {
+                index++;
+        }
+
+        return index;
+}
+
+const Kernels &scalarKernels()
+{
+        static const Kernels k = { "scalar", findQuoteOrBackslashScalar, skipWhitespaceScalar, findStructuralScalar };
+        return k;
+}
+
+#ifdef QTJSON_HAVE_SSE2
+/**
+ * The index of the lowest set bit of a non-zero mask
+ */
+static inline int firstBit(unsigned int mask)
+{
+#ifdef _MSC_VER
+        unsigned long bit;
+        _BitScanForward(&bit, mask);
+        return int(bit);
+#else
+        return __builtin_ctz(mask);
+#endif
+}
+
+/**
+ * SSE2 kernels. Each block of 16 bytes is reduced to a bit mask of
+ * matching bytes, and the tail is left to the scalar kernel.
+ */
+static int findQuoteOrBackslashSse2(const char *data, int index, int size)
+{
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+
+        while(index + 16 <= size)
+        {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+                const unsigned int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, quote),
+                                                                         _mm_cmpeq_epi8(block, backslash)));
+
+                if(mask)
+                {
+                        return index + firstBit(mask);
+                }
+
+                index += 16;
+        }
+
+        return findQuoteOrBackslashScalar(data, index, size);
+}
+
+static inline __m128i whitespaceSse2(__m128i block)
+{
+        return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')),
+                                         _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))),
+                            _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')),
+                                         _mm_cmpeq_epi8(block, _mm_set1_epi8('\r'))));
+}
+
+static int skipWhitespaceSse2(const char *data, int index, int size)
+{
+        while(index + 16 <= size)
+        {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+                const unsigned int mask = ~_mm_movemask_epi8(whitespaceSse2(block)) & 0xffff;
+
+                if(mask)
+                {
+                        return index + firstBit(mask);
+                }
+
+                index += 16;
+        }
+
+        return skipWhitespaceScalar(data, index, size);
+}
+
+static int findStructuralSse2(const char *data, int index, int size)
+{
+        while(index + 16 <= size)
+        {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+                const __m128i brackets = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('{')),
+                                                                   _mm_cmpeq_epi8(block, _mm_set1_epi8('}'))),
+                                                      _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('[')),
+                                                                   _mm_cmpeq_epi8(block, _mm_set1_epi8(']'))));
+                const __m128i separators = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('"')),
+                                                        _mm_cmpeq_epi8(block, _mm_set1_epi8(',')));
+                const unsigned int mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(brackets, separators),
+                                                                         whitespaceSse2(block)));
+
+                if(mask)
+                {
+                        return index + firstBit(mask);
+                }
+
+                index += 16;
+        }
+
+        return findStructuralScalar(data, index, size);
+}
+
+const Kernels &sse2Kernels()
+{
+        static const Kernels k = { "sse2", findQuoteOrBackslashSse2, skipWhitespaceSse2, findStructuralSse2 };
+        return k;
+}
+#endif
+
+#ifdef QTJSON_HAVE_AVX2
+/**
+ * AVX2 kernels. These are compiled for AVX2 regardless of the compiler
+ * flags, and are only selected at runtime if the CPU supports them.
+ */
+#define QTJSON_AVX2_FUNCTION __attribute__((target("avx2")))
+
+QTJSON_AVX2_FUNCTION static int findQuoteOrBackslashAvx2(const char *data, int index, int size)
+{
+        const __m256i quote = _mm256_set1_epi8('"');
+        const __m256i backslash = _mm256_set1_epi8('\\');
+
+        while(index + 32 <= size)
+        {
+                const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + index));
+                const unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, quote),
+                                                                               _mm256_cmpeq_epi8(block, backslash)));
+
+                if(mask)
+                {
+                        return index + firstBit(mask);
+                }
+
+                index += 32;
+        }
+
+        return findQuoteOrBackslashSse2(data, index, size);
+}
+
+QTJSON_AVX2_FUNCTION static inline __m256i whitespaceAvx2(__m256i block)
+{
+        return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')),
+                                               _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\t'))),
+                               _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')),
+                                               _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\r'))));
+}
+
+QTJSON_AVX2_FUNCTION static int skipWhitespaceAvx2(const char *data, int index, int size)
+{
+        while(index + 32 <= size)
+        {
+                const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + index));
+                const unsigned int mask = ~static_cast<unsigned int>(_mm256_movemask_epi8(whitespaceAvx2(block)));
+
+                if(mask)
+                {
+                        return index + firstBit(mask);
+                }
+
+                index += 32;
+        }
+
+        return skipWhitespaceSse2(data, index, size);
+}
+
+QTJSON_AVX2_FUNCTION static int findStructuralAvx2(const char *data, int index, int size)
+{
+        while(index + 32 <= size)
+        {
+                const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + index));
+                const __m256i brackets = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('{')),
+                                                                         _mm256_cmpeq_epi8(block, _mm256_set1_epi8('}'))),
+                                                         _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('[')),
+                                                                         _mm256_cmpeq_epi8(block, _mm256_set1_epi8(']'))));
+                const __m256i separators = _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('"')),
+                                                           _mm256_cmpeq_epi8(block, _mm256_set1_epi8(',')));
+                const unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(brackets, separators),
+                                                                               whitespaceAvx2(block)));
+
+                if(mask)
+                {
+                        return index + firstBit(mask);
+                }
+
+                index += 32;
+        }
+
+        return findStructuralSse2(data, index, size);
+}
+
+const Kernels &avx2Kernels()
+{
+        static const Kernels k = { "avx2", findQuoteOrBackslashAvx2, skipWhitespaceAvx2, findStructuralAvx2 };
+        return k;
+}
+
+bool hasAvx2()
+{
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+}
+#endif
+
+const Kernels &kernels()
+{
+#if defined(QTJSON_HAVE_AVX2)
+        static const Kernels &k = hasAvx2() ? avx2Kernels() : sse2Kernels();
+#elif defined(QTJSON_HAVE_SSE2)
+        static const Kernels &k = sse2Kernels();
+#else
+        static const Kernels &k = scalarKernels();
+#endif
+        return k;
+}
+
+} //end namespace
+
+} //end namespace
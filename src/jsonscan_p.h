@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file jsonscan_p.h
+ */
+
+#ifndef JSONSCAN_P_H
+#define JSONSCAN_P_H
+
+#if !defined(QTJSON_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define QTJSON_HAVE_SSE2
+#if defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9))))
+#define QTJSON_HAVE_AVX2
+#endif
+#endif
+
+namespace QtJson
+{
+
+namespace Scan
+{
+
+/**
+ * A scanning kernel
+ *
+ * \param data The data to be scanned
+ * \param index The index at which to start scanning
+ * \param size The size of the data
+ *
+ * \return int The index of the first matching byte, or size if there is none
+ */
+typedef int (*Kernel)(const char *data, int index, int size);
+
+/**
+ * \struct Kernels
+ * \brief A set of scanning kernels using the same instruction set
+ *
+ * Every set returns exactly the same results as the scalar set.
+ */
+struct Kernels
+{
+        //The name of the instruction set
+        const char *name;
+
+        //Find the next '"' or '\\'
+        Kernel findQuoteOrBackslash;
+
+        //Find the next byte that is not JSON whitespace
+        Kernel skipWhitespace;
+
+        //Find the next '{', '}', '[', ']', '"', ',' or whitespace byte
+        Kernel findStructural;
+};
+
+/**
+ * \return Kernels The portable kernels
+ */
+const Kernels &scalarKernels();
+
+#ifdef QTJSON_HAVE_SSE2
+/**
+ * \return Kernels The SSE2 kernels
+ */
+const Kernels &sse2Kernels();
+#endif
+
+#ifdef QTJSON_HAVE_AVX2
+/**
+ * \return Kernels The AVX2 kernels. These may only be used if hasAvx2() is true.
+ */
+const Kernels &avx2Kernels();
+
+/**
+ * \return bool true if the CPU supports AVX2
+ */
+bool hasAvx2();
+#endif
+
+/**
+ * Get the fastest kernels supported by the CPU
+ *
+ * The kernels are selected once, when this is first called.
+ *
+ * \return Kernels The kernels to be used for parsing
+ */
+const Kernels &kernels();
+
+} //end namespace
+
+} //end namespace
+
+#endif //JSONSCAN_P_H
@@ -76,7 +76,11 @@ int Model::rowCount(const QModelIndex &) const {
 QVariant Model::data(const QModelIndex &index, int role) const {
     Q_D(const Model);
     
-    return get(index.row()).value(d->roles.value(role));
+    if ((index.row() < 0) || (index.row() >= d->items.size())) {
+        return QVariant();
+    }
+    
+    return d->items.at(index.row()).value(d->roles.value(role));
 }
 
 /*!
@@ -86,7 +90,12 @@ QMap<int, QVariant> Model::itemData(const QModelIndex &index) const {
     Q_D(const Model);
     
     QMap<int, QVariant> map;
-    QVariantMap item = get(index.row());
+    
+    if ((index.row() < 0) || (index.row() >= d->items.size())) {
+        return map;
+    }
+    
+    const ModelItem &item = d->items.at(index.row());
     
     if (!item.isEmpty()) {
         QHashIterator<int, QByteArray> iterator(d->roles);
@@ -110,7 +119,7 @@ bool Model::setData(const QModelIndex &index, const QVariant &value, int role) {
     
     Q_D(Model);
     
-    d->items[index.row()][d->roles.value(role)] = value;
+    d->items[index.row()].setValue(d->roles.value(role), value);
     emit dataChanged(index, index);
     
     return true;
@@ -130,7 +139,7 @@ bool Model::setItemData(const QModelIndex &index, const QMap<int, QVariant> &rol
     
     while (iterator.hasNext()) {
         iterator.next();
-        d->items[index.row()][d->roles.value(iterator.key())] = iterator.value();
+        d->items[index.row()].setValue(d->roles.value(iterator.key()), iterator.value());
     }
     
     emit dataChanged(index, index);
@@ -211,7 +220,7 @@ bool Model::remove(const QModelIndex &index) {
 QVariantMap Model::get(int row) const {
     Q_D(const Model);
     
-    return (row >= 0) && (row < d->items.size()) ? d->items.at(row) : QVariantMap();
+    return (row >= 0) && (row < d->items.size()) ? d->items.at(row).toMap() : QVariantMap();
 }
 
 /*!
@@ -226,7 +235,7 @@ bool Model::setProperty(int row, const QString &property, const QVariant &value)
         return false;
     }
     
-    d->items[row][property] = value;
+    d->items[row].setValue(property, value);
     QModelIndex i = index(row);
     emit dataChanged(i, i);
     
@@ -249,7 +258,7 @@ bool Model::set(int row, const QVariantMap &properties) {
     
     while (iterator.hasNext()) {
         iterator.next();
-        d->items[row][iterator.key()] = iterator.value();
+        d->items[row].setValue(iterator.key(), iterator.value());
     }
     
     QModelIndex i = index(row);
@@ -343,10 +352,20 @@ ModelPrivate::~ModelPrivate() {}
     \brief Set the role names of the model using the unique keys of \a item.
 */
 void ModelPrivate::setRoleNames(const QVariantMap &item) {    
+    setRoleNames(QStringList(item.uniqueKeys()));
+}
+
+/*!
+    \internal
+    \brief Set the role names of the model using \a keys, in alphabetical order.
+*/
+void ModelPrivate::setRoleNames(QStringList keys) {
+    keys.removeDuplicates();
+    keys.sort();
     roles.clear();
     int role = Qt::UserRole + 1;
     
-    foreach (QString key, item.uniqueKeys()) {
+    foreach (QString key, keys) {
         roles[role] = key.toUtf8();
         role++;
     }
@@ -18,9 +18,80 @@
 #define QDAILYMOTION_MODEL_P_H
 
 #include "model.h"
+#include "json.h"
+#include <QStringList>
 
 namespace QDailymotion {
 
+/*!
+    \internal
+    \class ModelItem
+    \brief An item of a Model, whose values may be decoded on demand from a QtJson::Document.
+    
+    Values that have been set, or decoded from the document, are cached in a QVariantMap.
+*/
+class ModelItem
+{
+
+public:
+    ModelItem(const QVariantMap &map = QVariantMap()) :
+        values(map)
+    {
+    }
+    
+    ModelItem(const QtJson::Document &doc) :
+        document(doc)
+    {
+    }
+    
+    bool isEmpty() const {
+        return (values.isEmpty()) && (document.count() == 0);
+    }
+    
+    QStringList keys() const {
+        QStringList list = document.keys();
+        list << values.keys();
+        return list;
+    }
+    
+    QVariant value(const QString &key) const {
+        if ((document.isValid()) && (!values.contains(key))) {
+            const QtJson::Document v = document.value(key);
+            
+            if (v.isValid()) {
+                values[key] = v.toVariant();
+            }
+        }
+        
+        return values.value(key);
+    }
+    
+    void setValue(const QString &key, const QVariant &value) {
+        values[key] = value;
+    }
+    
+    QVariantMap toMap() const {
+        if (document.isValid()) {
+            QVariantMap map = document.toVariant().toMap();
+            QMapIterator<QString, QVariant> iterator(values);
+            
+            while (iterator.hasNext()) {
+                iterator.next();
+                map[iterator.key()] = iterator.value();
+            }
+            
+            values = map;
+            document = QtJson::Document();
+        }
+        
+        return values;
+    }
+    
+private:
+    mutable QtJson::Document document;
+    mutable QVariantMap values;
+};
+
 class ModelPrivate
 {
 
@@ -29,12 +100,13 @@ public:
     virtual ~ModelPrivate();
     
     void setRoleNames(const QVariantMap &item);
+    void setRoleNames(QStringList keys);
         
     Model *q_ptr;
     
     QHash<int, QByteArray> roles;
     
-    QList<QVariantMap> items;
+    QList<ModelItem> items;
     
     Q_DECLARE_PUBLIC(Model)
 };
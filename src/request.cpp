@@ -15,13 +15,164 @@
  */
 
 #include "request_p.h"
+#include "requestscheduler.h"
+#include "responsecache.h"
+#include "resultcache.h"
+#include "tokenmanager.h"
 #include "urls.h"
+#include <QCryptographicHash>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QThreadStorage>
+#include <algorithm>
+#if QT_VERSION >= 0x050a00
+#include <QRandomGenerator>
+#else
+#include <QCoreApplication>
+#include <QThread>
+#include <stdlib.h>
+#endif
+#ifndef QT_NO_CONCURRENT
+#include <QtConcurrentRun>
+#endif
 #include <QDebug>
 
 namespace QDailymotion {
 
+// Object keys are shared by all requests in the same thread, since the API returns the same keys in each response
+static QThreadStorage<QtJson::KeyPool*> keyPools;
+
+static QtJson::KeyPool* sharedKeyPool() {
+    if (!keyPools.hasLocalData()) {
+        keyPools.setLocalData(new QtJson::KeyPool);
+    }
+    
+    return keyPools.localData();
+}
+
+// GETs in flight in each thread, by the key of the requests that can share them
+typedef QHash<QByteArray, QPointer<Request> > SharedGets;
+
+static QThreadStorage<SharedGets*> sharedGets;
+
+// The QNetworkAccessManager of shared GETs made for requests that have no QNetworkAccessManager set, so that 
+// identical GETs can be shared by requests that would otherwise each create their own
+static QThreadStorage<QNetworkAccessManager*> sharedGetManagers;
+
+static QNetworkAccessManager* sharedGetManagerInThread() {
+    if (!sharedGetManagers.hasLocalData()) {
+        sharedGetManagers.setLocalData(new QNetworkAccessManager);
+    }
+    
+    return sharedGetManagers.localData();
+}
+
+static SharedGets* sharedGetsInThread() {
+    if (!sharedGets.hasLocalData()) {
+        sharedGets.setLocalData(new SharedGets);
+    }
+    
+    return sharedGets.localData();
+}
+
+static const int LATENCY_SAMPLES = 100;
+
+static const int MIN_LATENCY_SAMPLES = 20;
+
+// The latencies of recent GETs in each thread, from which the delay before a hedged GET is taken
+struct Latencies
+{
+    Latencies() : next(0) {}
+    
+    QList<qint64> samples;
+    int next;
+};
+
+static QThreadStorage<Latencies*> latencies;
+
+static Latencies* latenciesInThread() {
+    if (!latencies.hasLocalData()) {
+        latencies.setLocalData(new Latencies);
+    }
+    
+    return latencies.localData();
+}
+
+static void addLatency(qint64 msecs) {
+    Latencies *l = latenciesInThread();
+    
+    if (l->samples.size() < LATENCY_SAMPLES) {
+        l->samples.append(msecs);
+    }
+    else {
+        l->samples[l->next] = msecs;
+        l->next = (l->next + 1) % LATENCY_SAMPLES;
+    }
+}
+
+// Returns the 95th percentile of the recent latencies, or -1 if too few GETs have been made
+static qint64 latencyPercentile() {
+    QList<qint64> samples = latenciesInThread()->samples;
+    
+    if (samples.size() < MIN_LATENCY_SAMPLES) {
+        return -1;
+    }
+    
+    std::sort(samples.begin(), samples.end());
+    return samples.at(samples.size() * 95 / 100);
+}
+
+#if QT_VERSION < 0x050a00
+// Whether qrand() has been seeded in each thread
+static QThreadStorage<bool*> randomSeeded;
+#endif
+
+// Returns a random number in [0, 1). The generator is seeded differently in each process and thread, so that 
+// clients that fail at the same time do not retry in lockstep.
+static qreal randomFraction() {
+#if QT_VERSION >= 0x050a00
+    return QRandomGenerator::global()->generateDouble();
+#else
+    if (!randomSeeded.hasLocalData()) {
+        randomSeeded.setLocalData(new bool(true));
+        qsrand(uint(QDateTime::currentMSecsSinceEpoch()) ^ uint(QCoreApplication::applicationPid())
+               ^ uint(quintptr(QThread::currentThreadId())));
+    }
+    
+    return qreal(qrand()) / (qreal(RAND_MAX) + 1);
+#endif
+}
+
+// Parse a complete response. This is thread-safe, so that it can be run in a worker thread.
+static ParseResult parseResponse(const QByteArray &response, bool lazy, const QStringList &projection) {
+    ParseResult res;
+    
+    if (response.isEmpty()) {
+        res.result = QString();
+    }
+    else if (lazy) {
+        res.document = QtJson::Document(response);
+        
+        // Values are decoded from the document when they are read
+        if (!res.document.isValid()) {
+            res.result = QtJson::Json::parse(response, res.ok);
+        }
+    }
+    else if (projection.isEmpty()) {
+        // Large arrays are decoded in parallel
+        res.result = QtJson::Json::parse(response, res.ok);
+    }
+    else {
+        QtJson::Parser parser;
+        parser.setProjection(projection);
+        parser.addData(response);
+        res.ok = parser.finish();
+        res.result = parser.result();
+    }
+    
+    return res;
+}
+
 /*!
     \class Request
     \brief The base class for making requests to the Dailymotion Data API.
@@ -46,6 +197,11 @@ Request::Request(RequestPrivate &dd, QObject *parent) :
 Request::~Request() {
     Q_D(Request);
     
+    d->leaveSharedGet();
+    d->leaveScheduler();
+    d->leaveTokenManager();
+    d->cancelHedge();
+    
     if (d->reply) {
         delete d->reply;
         d->reply = 0;
@@ -64,13 +220,24 @@ Request::~Request() {
 QString Request::clientId() const {
     Q_D(const Request);
     
-    return d->clientId;
+    if (d->session) {
+        return d->session->clientId();
+    }
+    
+    return d->tokenManager ? d->tokenManager->clientId() : d->clientId;
 }
 
 void Request::setClientId(const QString &id) {
     Q_D(Request);
     
-    if (id != d->clientId) {
+    if (d->session) {
+        // The change is emitted by the session
+        d->session->setClientId(id);
+    }
+    else if (d->tokenManager) {
+        d->tokenManager->setClientId(id);
+    }
+    else if (id != d->clientId) {
         d->clientId = id;
         emit clientIdChanged();
     }
@@ -91,13 +258,23 @@ void Request::setClientId(const QString &id) {
 QString Request::clientSecret() const {
     Q_D(const Request);
     
-    return d->clientSecret;
+    if (d->session) {
+        return d->session->clientSecret();
+    }
+    
+    return d->tokenManager ? d->tokenManager->clientSecret() : d->clientSecret;
 }
 
 void Request::setClientSecret(const QString &secret) {
     Q_D(Request);
     
-    if (secret != d->clientSecret) {
+    if (d->session) {
+        d->session->setClientSecret(secret);
+    }
+    else if (d->tokenManager) {
+        d->tokenManager->setClientSecret(secret);
+    }
+    else if (secret != d->clientSecret) {
         d->clientSecret = secret;
         emit clientSecretChanged();
     }
@@ -118,13 +295,23 @@ void Request::setClientSecret(const QString &secret) {
 QString Request::accessToken() const {
     Q_D(const Request);
     
-    return d->accessToken;
+    if (d->session) {
+        return d->session->accessToken();
+    }
+    
+    return d->tokenManager ? d->tokenManager->accessToken() : d->accessToken;
 }
 
 void Request::setAccessToken(const QString &token) {
     Q_D(Request);
     
-    if (token != d->accessToken) {
+    if (d->session) {
+        d->session->setAccessToken(token);
+    }
+    else if (d->tokenManager) {
+        d->tokenManager->setAccessToken(token);
+    }
+    else if (token != d->accessToken) {
         d->accessToken = token;
         emit accessTokenChanged(token);
     }
@@ -145,13 +332,23 @@ void Request::setAccessToken(const QString &token) {
 QString Request::refreshToken() const {
     Q_D(const Request);
     
-    return d->refreshToken;
+    if (d->session) {
+        return d->session->refreshToken();
+    }
+    
+    return d->tokenManager ? d->tokenManager->refreshToken() : d->refreshToken;
 }
 
 void Request::setRefreshToken(const QString &token) {
     Q_D(Request);
     
-    if (token != d->refreshToken) {
+    if (d->session) {
+        d->session->setRefreshToken(token);
+    }
+    else if (d->tokenManager) {
+        d->tokenManager->setRefreshToken(token);
+    }
+    else if (token != d->refreshToken) {
         d->refreshToken = token;
         emit refreshTokenChanged(token);
     }
@@ -161,89 +358,118 @@ void Request::setRefreshToken(const QString &token) {
 }
 
 /*!
-    \property QUrl Request::url
-    \brief The url used when making requests to the Dailymotion Data API.
+    \property bool Request::lazyParsing
+    \brief Whether responses are parsed lazily.
+    
+    When lazy parsing is enabled, the response is only indexed when it is received, and its values are 
+    decoded when they are read. This makes requests for large results cheaper when only some of the 
+    values are used. The result is available via resultDocument(), and result() decodes the whole of 
+    it on demand.
+    
+    Any projection set via setProjection() has no effect when lazy parsing is enabled.
+    
+    The default value is false.
+    
+    \sa resultDocument()
 */
 
 /*!
-    \fn void Request::urlChanged()
-    \brief Emitted when the url changes.
+    \fn void Request::lazyParsingChanged()
+    \brief Emitted when lazyParsing changes.
 */
-QUrl Request::url() const {
+bool Request::lazyParsing() const {
     Q_D(const Request);
     
-    return d->url;
+    return d->lazyParsing;
 }
 
-void Request::setUrl(const QUrl &url) {
+void Request::setLazyParsing(bool enabled) {
     Q_D(Request);
     
-    if (url != d->url) {
-        d->url = url;
-        emit urlChanged();
+    if (enabled != d->lazyParsing) {
+        d->lazyParsing = enabled;
+        emit lazyParsingChanged();
     }
 #ifdef QDAILYMOTION_DEBUG
-    qDebug() << "QDailymotion::Request::setUrl" << url;
+    qDebug() << "QDailymotion::Request::setLazyParsing" << enabled;
 #endif
 }
 
 /*!
-    \property QVariantMap Request::headers
-    \brief The headers used when making requests to the Dailymotion Data API.
+    \property bool Request::backgroundParsing
+    \brief Whether large responses are parsed in a worker thread.
+    
+    When background parsing is enabled, responses of at least backgroundParsingThreshold bytes are parsed 
+    in a thread from the global QThreadPool, so that a large response does not block the thread that owns 
+    the request. The result is passed back to the owning thread before finished() is emitted, and the 
+    status remains Request::Loading until then. Smaller responses are parsed in the owning thread.
+    
+    Responses are received into a buffer when background parsing is enabled, rather than being parsed 
+    as they arrive.
+    
+    The default value is false.
+    
+    \sa backgroundParsingThreshold
 */
 
 /*!
-    \fn void Request::headersChanged()
-    \brief Emitted when the headers change.
+    \fn void Request::backgroundParsingChanged()
+    \brief Emitted when backgroundParsing changes.
 */
-QVariantMap Request::headers() const {
+bool Request::backgroundParsing() const {
     Q_D(const Request);
     
-    return d->headers;
+    return d->backgroundParsing;
 }
 
-void Request::setHeaders(const QVariantMap &headers) {
+void Request::setBackgroundParsing(bool enabled) {
     Q_D(Request);
     
-    d->headers = headers;
-    emit headersChanged();
+    if (enabled != d->backgroundParsing) {
+        d->backgroundParsing = enabled;
+        emit backgroundParsingChanged();
+    }
 #ifdef QDAILYMOTION_DEBUG
-    qDebug() << "QDailymotion::Request::setHeaders" << headers;
+    qDebug() << "QDailymotion::Request::setBackgroundParsing" << enabled;
 #endif
 }
 
 /*!
-    \property QVariant Request::data
-    \brief The data used when making HTTP PUT/POST requests to the Dailymotion Data API.
+    \property int Request::backgroundParsingThreshold
+    \brief The minimum size in bytes of a response that is parsed in a worker thread.
+    
+    The default value is 65536.
+    
+    \sa backgroundParsing
 */
 
 /*!
-    \fn void Request::dataChanged()
-    \brief Emitted when the data changes.
+    \fn void Request::backgroundParsingThresholdChanged()
+    \brief Emitted when backgroundParsingThreshold changes.
 */
-QVariant Request::data() const {
+int Request::backgroundParsingThreshold() const {
     Q_D(const Request);
     
-    return d->data;
+    return d->backgroundParsingThreshold;
 }
 
-void Request::setData(const QVariant &data) {
+void Request::setBackgroundParsingThreshold(int bytes) {
     Q_D(Request);
     
-    if (data != d->data) {
-        d->data = data;
-        emit dataChanged();
+    if (bytes != d->backgroundParsingThreshold) {
+        d->backgroundParsingThreshold = bytes;
+        emit backgroundParsingThresholdChanged();
     }
 #ifdef QDAILYMOTION_DEBUG
-    qDebug() << "QDailymotion::Request::setData" << data;
+    qDebug() << "QDailymotion::Request::setBackgroundParsingThreshold" << bytes;
 #endif
 }
 
 /*!
-    \enum Request::Operation
-    \brief The operation type of the last HTTP request.
+    \property CachePolicy Request::cachePolicy
+    \brief How the ResponseCache is used by GET requests.
     
-    Can be one of the following:
+    The policy has no effect unless a ResponseCache is set on the request, or on its Session.
     
     <table>
         <tr>
@@ -251,46 +477,63 @@ void Request::setData(const QVariant &data) {
             <th>Description</th>
         </tr>
         <tr>
-            <td>HeadOperation</td>
-            <td>Retrieve headers(created with head()).</td>
+            <td>UseCacheControl</td>
+            <td>A cached response is used while it is fresh according to its Cache-Control or Expires 
+            headers, and is revalidated with a conditional request once it is stale (default).</td>
         </tr>
         <tr>
-            <td>GetOperation</td>
-            <td>Retrieve headers and download contents (created with get()).</td>
+            <td>NetworkOnly</td>
+            <td>The cache is not read. The response is still stored in the cache.</td>
         </tr>
         <tr>
-            <td>PutOperation</td>
-            <td>Upload contents operation (created with put()).
+            <td>PreferCache</td>
+            <td>A cached response is used regardless of its freshness. The request is only made if there is 
+            no cached response.</td>
         </tr>
         <tr>
-            <td>PostOperation</td>
-            <td>Send the contents of an HTML form for processing via HTTP POST (created with post()).
+            <td>CacheOnly</td>
+            <td>A cached response is used regardless of its freshness, and the request fails with 
+            ContentNotFoundError if there is none. No request is made.</td>
         </tr>
         <tr>
-            <td>DeleteOperation</td>
-            <td>Send the contents of an HTML form for processing via HTTP POST (created with post()).
+            <td>Revalidate</td>
+            <td>A cached response is always revalidated with a conditional request.</td>
         </tr>
     </table>
+    
+    When a conditional request is answered with 304 Not Modified, the cached result is used without the 
+    response being downloaded or parsed again.
+    
+    The NetworkOnly and Revalidate policies also bypass the ResultCache, though the result is still stored in it.
+    
+    \sa ResponseCache, ResultCache
 */
 
 /*!
-    \property Operation Request::operation
-    \brief The last HTTP operation type.
-*/
-
-/*!
-    \fn void Request::operationChanged()
-    \brief Emitted when the operation changes.
+    \fn void Request::cachePolicyChanged()
+    \brief Emitted when the cachePolicy changes.
 */
-Request::Operation Request::operation() const {
+Request::CachePolicy Request::cachePolicy() const {
     Q_D(const Request);
     
-    return d->operation;
+    return d->cachePolicy;
+}
+
+void Request::setCachePolicy(CachePolicy policy) {
+    Q_D(Request);
+    
+    if (policy != d->cachePolicy) {
+        d->cachePolicy = policy;
+        emit cachePolicyChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Request::setCachePolicy" << policy;
+#endif
 }
 
 /*!
-    \enum Request::Status
-    \brief The status of the last HTTP request.
+    \property Priority Request::priority
+    \brief The priority of the request in its RequestScheduler.
     
     Can be one of the following:
     
@@ -300,101 +543,521 @@ Request::Operation Request::operation() const {
             <th>Description</th>
         </tr>
         <tr>
-            <td>Null</td>
-            <td>No request has been made.</td>
-        </tr>
-        <tr>
-            <td>Loading</td>
-            <td>A request is in progress.</td>
-        </tr>
-        <tr>
-            <td>Canceled</td>
-            <td>The last request was canceled.</td>
+            <td>InteractivePriority</td>
+            <td>The request is needed to show something that the user is waiting for (default).</td>
         </tr>
         <tr>
-            <td>Failed</td>
-            <td>The last request failed.</td>
+            <td>PrefetchPriority</td>
+            <td>The request retrieves something that the user is likely to need soon.</td>
         </tr>
         <tr>
-            <td>Ready</td>
-            <td>The last request was successful.</td>
+            <td>BackgroundPriority</td>
+            <td>The request is not needed by the user.</td>
         </tr>
     </table>
+    
+    The priority has no effect unless a RequestScheduler is set on the request, or on its Session. A change of 
+    priority applies to the next HTTP request.
+    
+    \sa RequestScheduler
 */
 
 /*!
-    \property Status Request::status
-    \brief The status of the last request.
+    \fn void Request::priorityChanged()
+    \brief Emitted when the priority changes.
+*/
+Request::Priority Request::priority() const {
+    Q_D(const Request);
+    
+    return d->priority;
+}
+
+void Request::setPriority(Priority priority) {
+    Q_D(Request);
+    
+    if (priority != d->priority) {
+        d->priority = priority;
+        emit priorityChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Request::setPriority" << priority;
+#endif
+}
+
+/*!
+    \property int Request::maximumAttempts
+    \brief The maximum number of times that each HTTP request is attempted.
+    
+    A request that fails with a transient error is attempted again, until it has been attempted 
+    maximumAttempts times. Transient errors are RemoteHostClosedError, TimeoutError, 
+    TemporaryNetworkFailureError, and responses with status 429 Too Many Requests or 5xx.
+    
+    Before each further attempt, the request waits for a random delay of up to retryDelay milliseconds, doubled 
+    for each attempt already made, up to 30 seconds. If the response has a Retry-After header, the request 
+    waits for at least the delay that it asks for. A request whose Retry-After delay is longer than 30 seconds 
+    fails instead.
+    
+    Only HEAD, GET, PUT and DELETE requests are retried, unless retryNonIdempotent is enabled.
+    
+    The default value is 1, meaning that failed requests are not retried.
+    
+    The values of the session are used instead while the request is attached to a Session.
+    
+    \sa retryDelay, retryNonIdempotent
 */
 
 /*!
-    \fn void Request::statusChanged()
-    \brief Emitted when the status changes.
+    \fn void Request::maximumAttemptsChanged()
+    \brief Emitted when maximumAttempts changes.
 */
-Request::Status Request::status() const {
+int Request::maximumAttempts() const {
     Q_D(const Request);
     
-    return d->status;
+    return d->session ? d->session->maximumAttempts() : d->maximumAttempts;
+}
+
+void Request::setMaximumAttempts(int attempts) {
+    Q_D(Request);
+    
+    attempts = qMax(1, attempts);
+    
+    if (d->session) {
+        // The change is emitted by the session
+        d->session->setMaximumAttempts(attempts);
+    }
+    else if (attempts != d->maximumAttempts) {
+        d->maximumAttempts = attempts;
+        emit maximumAttemptsChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Request::setMaximumAttempts" << attempts;
+#endif
 }
 
 /*!
-    \fn void Request::finished()
-    \brief Emitted when the request is completed.
+    \property int Request::retryDelay
+    \brief The base delay in milliseconds before a failed request is attempted again.
     
-    \sa status, result
+    The default value is 1000.
+    
+    \sa maximumAttempts
 */
 
 /*!
-    \property QVariant Request::result
-    \brief The result of the last HTTP request.
+    \fn void Request::retryDelayChanged()
+    \brief Emitted when the retryDelay changes.
 */
-QVariant Request::result() const {
+int Request::retryDelay() const {
     Q_D(const Request);
     
-    return d->result;
+    return d->session ? d->session->retryDelay() : d->retryDelay;
+}
+
+void Request::setRetryDelay(int msecs) {
+    Q_D(Request);
+    
+    msecs = qMax(0, msecs);
+    
+    if (d->session) {
+        d->session->setRetryDelay(msecs);
+    }
+    else if (msecs != d->retryDelay) {
+        d->retryDelay = msecs;
+        emit retryDelayChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Request::setRetryDelay" << msecs;
+#endif
 }
 
 /*!
-    \enum Request::Error
-    \brief The error resulting from the last HTTP request.
+    \property bool Request::retryNonIdempotent
+    \brief Whether POST requests are retried.
     
-    Can be one of the folowing:
+    A POST request can have been processed by the server even if it failed, so retrying it could repeat 
+    its effect. The default value is false.
     
-    <table>
-        <tr>
-            <th>Value</th>
-            <th>Description</th>
-        </tr>
-        <tr>
-            <td>NoError</td>
-            <td>No error condition.</td>
-        </tr>
-        <tr>
-            <td>ConnectionRefusedError</td>
-            <td>The remote server refused the connection (the server is not accepting requests).</td>
-        </tr>
-        <tr>
-            <td>HostNotFoundError</td>
-            <td>The remote host name was not found (invalid hostname).</td>
-        </tr>
-        <tr>
-            <td>TimeoutError</td>
-            <td>The connection to the remote server timed out.</td>
-        </tr>
-        <tr>
-            <td>SslHandshakeFailedError</td>
-            <td>The SSL/TLS handshake failed and the encrypted channel could not be established.</td>
-        </tr>
-        <tr>
-            <td>TemporaryNetworkFailureError</td>
-            <td>
-                The connection was broken due to disconnection from the network, however the system has initiated
-                roaming to another access point.
-            </td>
-        </tr>
-        <tr>
-            <td>ProxyConnectionRefusedError</td>
-            <td>
+    \sa maximumAttempts
+*/
+
+/*!
+    \fn void Request::retryNonIdempotentChanged()
+    \brief Emitted when retryNonIdempotent changes.
+*/
+bool Request::retryNonIdempotent() const {
+    Q_D(const Request);
+    
+    return d->session ? d->session->retryNonIdempotent() : d->retryNonIdempotent;
+}
+
+void Request::setRetryNonIdempotent(bool enabled) {
+    Q_D(Request);
+    
+    if (d->session) {
+        d->session->setRetryNonIdempotent(enabled);
+    }
+    else if (enabled != d->retryNonIdempotent) {
+        d->retryNonIdempotent = enabled;
+        emit retryNonIdempotentChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Request::setRetryNonIdempotent" << enabled;
+#endif
+}
+
+/*!
+    \property int Request::deadline
+    \brief The time in milliseconds within which each operation must finish.
+    
+    The deadline covers the whole operation, including any redirects, retries and refreshing of the access 
+    token. If the operation has not finished when the deadline expires, it is aborted and fails with 
+    TimeoutError.
+    
+    The default value is 0, meaning that operations have no deadline.
+    
+    \sa maximumAttempts
+*/
+
+/*!
+    \fn void Request::deadlineChanged()
+    \brief Emitted when the deadline changes.
+*/
+int Request::deadline() const {
+    Q_D(const Request);
+    
+    return d->session ? d->session->deadline() : d->deadline;
+}
+
+void Request::setDeadline(int msecs) {
+    Q_D(Request);
+    
+    msecs = qMax(0, msecs);
+    
+    if (d->session) {
+        d->session->setDeadline(msecs);
+    }
+    else if (msecs != d->deadline) {
+        d->deadline = msecs;
+        emit deadlineChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Request::setDeadline" << msecs;
+#endif
+}
+
+/*!
+    \property bool Request::hedging
+    \brief Whether slow GET requests are hedged with a second attempt.
+    
+    When enabled, a GET request that has received no response after the 95th percentile of the latencies 
+    of recent GET requests is sent again, and the result of whichever attempt succeeds first is used. The 
+    other attempt is canceled.
+    
+    Hedging increases the load on the API, so it is disabled by default.
+    
+    \sa deadline
+*/
+
+/*!
+    \fn void Request::hedgingChanged()
+    \brief Emitted when hedging changes.
+*/
+bool Request::hedging() const {
+    Q_D(const Request);
+    
+    return d->session ? d->session->hedging() : d->hedging;
+}
+
+void Request::setHedging(bool enabled) {
+    Q_D(Request);
+    
+    if (d->session) {
+        d->session->setHedging(enabled);
+    }
+    else if (enabled != d->hedging) {
+        d->hedging = enabled;
+        emit hedgingChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Request::setHedging" << enabled;
+#endif
+}
+
+/*!
+    \property QUrl Request::url
+    \brief The url used when making requests to the Dailymotion Data API.
+*/
+
+/*!
+    \fn void Request::urlChanged()
+    \brief Emitted when the url changes.
+*/
+QUrl Request::url() const {
+    Q_D(const Request);
+    
+    return d->url;
+}
+
+void Request::setUrl(const QUrl &url) {
+    Q_D(Request);
+    
+    if (url != d->url) {
+        d->url = url;
+        emit urlChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Request::setUrl" << url;
+#endif
+}
+
+/*!
+    \property QVariantMap Request::headers
+    \brief The headers used when making requests to the Dailymotion Data API.
+*/
+
+/*!
+    \fn void Request::headersChanged()
+    \brief Emitted when the headers change.
+*/
+QVariantMap Request::headers() const {
+    Q_D(const Request);
+    
+    return d->headers;
+}
+
+void Request::setHeaders(const QVariantMap &headers) {
+    Q_D(Request);
+    
+    d->headers = headers;
+    emit headersChanged();
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Request::setHeaders" << headers;
+#endif
+}
+
+/*!
+    \property QVariant Request::data
+    \brief The data used when making HTTP PUT/POST requests to the Dailymotion Data API.
+*/
+
+/*!
+    \fn void Request::dataChanged()
+    \brief Emitted when the data changes.
+*/
+QVariant Request::data() const {
+    Q_D(const Request);
+    
+    return d->data;
+}
+
+void Request::setData(const QVariant &data) {
+    Q_D(Request);
+    
+    if (data != d->data) {
+        d->data = data;
+        emit dataChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Request::setData" << data;
+#endif
+}
+
+/*!
+    \brief Sets the key \a paths to be parsed from the response of the next request.
+    
+    Any other values in the response are skipped by the parser. An empty list means that the whole 
+    response is parsed.
+    
+    \sa QtJson::Parser::setProjection()
+*/
+void Request::setProjection(const QStringList &paths) {
+    Q_D(Request);
+    d->parser.setProjection(paths);
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Request::setProjection" << paths;
+#endif
+}
+
+/*!
+    \enum Request::Operation
+    \brief The operation type of the last HTTP request.
+    
+    Can be one of the following:
+    
+    <table>
+        <tr>
+            <th>Value</th>
+            <th>Description</th>
+        </tr>
+        <tr>
+            <td>HeadOperation</td>
+            <td>Retrieve headers(created with head()).</td>
+        </tr>
+        <tr>
+            <td>GetOperation</td>
+            <td>Retrieve headers and download contents (created with get()).</td>
+        </tr>
+        <tr>
+            <td>PutOperation</td>
+            <td>Upload contents operation (created with put()).
+        </tr>
+        <tr>
+            <td>PostOperation</td>
+            <td>Send the contents of an HTML form for processing via HTTP POST (created with post()).
+        </tr>
+        <tr>
+            <td>DeleteOperation</td>
+            <td>Send the contents of an HTML form for processing via HTTP POST (created with post()).
+        </tr>
+    </table>
+*/
+
+/*!
+    \property Operation Request::operation
+    \brief The last HTTP operation type.
+*/
+
+/*!
+    \fn void Request::operationChanged()
+    \brief Emitted when the operation changes.
+*/
+Request::Operation Request::operation() const {
+    Q_D(const Request);
+    
+    return d->operation;
+}
+
+/*!
+    \enum Request::Status
+    \brief The status of the last HTTP request.
+    
+    Can be one of the following:
+    
+    <table>
+        <tr>
+            <th>Value</th>
+            <th>Description</th>
+        </tr>
+        <tr>
+            <td>Null</td>
+            <td>No request has been made.</td>
+        </tr>
+        <tr>
+            <td>Loading</td>
+            <td>A request is in progress.</td>
+        </tr>
+        <tr>
+            <td>Canceled</td>
+            <td>The last request was canceled.</td>
+        </tr>
+        <tr>
+            <td>Failed</td>
+            <td>The last request failed.</td>
+        </tr>
+        <tr>
+            <td>Ready</td>
+            <td>The last request was successful.</td>
+        </tr>
+    </table>
+*/
+
+/*!
+    \property Status Request::status
+    \brief The status of the last request.
+*/
+
+/*!
+    \fn void Request::statusChanged()
+    \brief Emitted when the status changes.
+*/
+Request::Status Request::status() const {
+    Q_D(const Request);
+    
+    return d->status;
+}
+
+/*!
+    \fn void Request::finished()
+    \brief Emitted when the request is completed.
+    
+    \sa status, result
+*/
+
+/*!
+    \property QVariant Request::result
+    \brief The result of the last HTTP request.
+*/
+QVariant Request::result() const {
+    Q_D(const Request);
+    
+    // A lazily parsed result is decoded once, when it is first read
+    if (d->document.isValid()) {
+        if (!d->documentDecoded) {
+            d->documentResult = d->document.toVariant();
+            d->documentDecoded = true;
+        }
+        
+        return d->documentResult;
+    }
+    
+    return d->result;
+}
+
+/*!
+    \brief Returns the lazily parsed result of the last HTTP request.
+    
+    The returned document is invalid unless lazyParsing is enabled and the response was parsed 
+    successfully.
+    
+    \sa lazyParsing
+*/
+QtJson::Document Request::resultDocument() const {
+    Q_D(const Request);
+    
+    return d->document;
+}
+
+/*!
+    \enum Request::Error
+    \brief The error resulting from the last HTTP request.
+    
+    Can be one of the folowing:
+    
+    <table>
+        <tr>
+            <th>Value</th>
+            <th>Description</th>
+        </tr>
+        <tr>
+            <td>NoError</td>
+            <td>No error condition.</td>
+        </tr>
+        <tr>
+            <td>ConnectionRefusedError</td>
+            <td>The remote server refused the connection (the server is not accepting requests).</td>
+        </tr>
+        <tr>
+            <td>HostNotFoundError</td>
+            <td>The remote host name was not found (invalid hostname).</td>
+        </tr>
+        <tr>
+            <td>TimeoutError</td>
+            <td>The connection to the remote server timed out.</td>
+        </tr>
+        <tr>
+            <td>SslHandshakeFailedError</td>
+            <td>The SSL/TLS handshake failed and the encrypted channel could not be established.</td>
+        </tr>
+        <tr>
+            <td>TemporaryNetworkFailureError</td>
+            <td>
+                The connection was broken due to disconnection from the network, however the system has initiated
+                roaming to another access point.
+            </td>
+        </tr>
+        <tr>
+            <td>ProxyConnectionRefusedError</td>
+            <td>
                 The proxy server closed the connection prematurely, before the entire reply was received and
                 processed.
             </td>
@@ -505,7 +1168,9 @@ QString Request::errorString() const {
     Request does not take ownership of \a manager.
     
     If no QNetworkAccessManager is set, one will be created 
-    when required.    
+    when required.
+    
+    The QNetworkAccessManager of the session is used instead while the request is attached to a Session.
 */
 void Request::setNetworkAccessManager(QNetworkAccessManager *manager) {
     Q_D(Request);
@@ -514,10 +1179,164 @@ void Request::setNetworkAccessManager(QNetworkAccessManager *manager) {
         delete d->manager;
     }
     
-    d->ownNetworkAccessManager = false;
-    d->manager = manager;
+    d->ownNetworkAccessManager = false;
+    d->manager = manager;
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Request::setNetworkAccessManager" << manager;
+#endif
+}
+
+/*!
+    \brief Returns the ResponseCache set on the request, or 0 if none is set.
+    
+    \sa setResponseCache()
+*/
+ResponseCache* Request::responseCache() const {
+    Q_D(const Request);
+    
+    return d->cache;
+}
+
+/*!
+    \brief Sets the ResponseCache to be used by GET requests.
+    
+    Request does not take ownership of \a cache.
+    
+    The ResponseCache of the session is used instead while the request is attached to a Session.
+    
+    \sa cachePolicy
+*/
+void Request::setResponseCache(ResponseCache *cache) {
+    Q_D(Request);
+    
+    d->cache = cache;
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Request::setResponseCache" << cache;
+#endif
+}
+
+/*!
+    \brief Returns the RequestScheduler set on the request, or 0 if none is set.
+    
+    \sa setScheduler()
+*/
+RequestScheduler* Request::scheduler() const {
+    Q_D(const Request);
+    
+    return d->scheduler;
+}
+
+/*!
+    \brief Sets the RequestScheduler that paces the HTTP requests of the request.
+    
+    Request does not take ownership of \a scheduler.
+    
+    The RequestScheduler of the session is used instead while the request is attached to a Session.
+    
+    \sa priority
+*/
+void Request::setScheduler(RequestScheduler *scheduler) {
+    Q_D(Request);
+    
+    d->scheduler = scheduler;
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Request::setScheduler" << scheduler;
+#endif
+}
+
+/*!
+    \brief Returns the TokenManager set on the request, or 0 if none is set.
+    
+    \sa setTokenManager()
+*/
+TokenManager* Request::tokenManager() const {
+    Q_D(const Request);
+    
+    return d->tokenManager;
+}
+
+/*!
+    \brief Sets the TokenManager that holds the credentials of the request and refreshes its access token.
+    
+    While a token manager is set, the credentials of the request are those of the token manager, and setting the 
+    credentials of the request sets those of the token manager. When the access token is refused, the request waits 
+    for the refresh that the token manager shares between its requests, and is then made again.
+    
+    Request does not take ownership of \a manager.
+    
+    The TokenManager of the session is used instead while the request is attached to a Session.
+    
+    \sa TokenManager
+*/
+void Request::setTokenManager(TokenManager *manager) {
+    Q_D(Request);
+    
+    if (manager == d->tokenManager) {
+        return;
+    }
+    
+    const QString id = clientId();
+    const QString secret = clientSecret();
+    const QString token = accessToken();
+    const QString refresh = refreshToken();
+    
+    d->disconnectCredentials();
+    d->tokenManager = manager;
+    d->connectCredentials();
+    d->emitCredentialChanges(id, secret, token, refresh);
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Request::setTokenManager" << manager;
+#endif
+}
+
+/*!
+    \brief Returns the Session to which the request is attached, or 0 if it is not attached to a session.
+    
+    \sa setSession()
+*/
+Session* Request::session() const {
+    Q_D(const Request);
+    
+    return d->session;
+}
+
+/*!
+    \brief Attaches the request to \a session.
+    
+    While the request is attached, it uses the QNetworkAccessManager, credentials, headers and maximum redirects of 
+    the session, and its retry policy, deadline and hedging. Setting the credentials or any of these policies of the 
+    request sets those of the session, and an access token refreshed by the request is used by every request of the session.
+    
+    The credentials and policies set before the request was attached are used again if it is detached by passing 0.
+    
+    Request does not take ownership of \a session.
+    
+    \sa Session
+*/
+void Request::setSession(Session *session) {
+    Q_D(Request);
+    
+    if (session == d->session) {
+        return;
+    }
+    
+    const QString id = clientId();
+    const QString secret = clientSecret();
+    const QString token = accessToken();
+    const QString refresh = refreshToken();
+    const int attempts = maximumAttempts();
+    const int delay = retryDelay();
+    const bool nonIdempotent = retryNonIdempotent();
+    const int msecs = deadline();
+    const bool hedge = hedging();
+    
+    d->disconnectCredentials();
+    d->session = session;
+    d->connectCredentials();
+    d->emitCredentialChanges(id, secret, token, refresh);
+    d->emitPolicyChanges(attempts, delay, nonIdempotent, msecs, hedge);
 #ifdef QDAILYMOTION_DEBUG
-    qDebug() << "QDailymotion::Request::setNetworkAccessManager" << manager;
+    qDebug() << "QDailymotion::Request::setSession" << session;
 #endif
 }
 
@@ -533,6 +1352,9 @@ void Request::head(bool authRequired) {
     }
     
     d->redirects = 0;
+    d->attempts = 1;
+    d->tokenRefreshed = false;
+    d->startDeadline();
     d->setOperation(HeadOperation);
     d->setStatus(Loading);
     
@@ -542,12 +1364,22 @@ void Request::head(bool authRequired) {
 #ifdef QDAILYMOTION_DEBUG
     qDebug() << "QDailymotion::Request::head" << d->url;
 #endif
-    d->reply = d->networkAccessManager()->head(d->buildRequest(authRequired));
-    connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+    d->cancelPending();
+    d->resetParsing();
+    d->sendRequest(authRequired);
 }
 
 /*!
     \brief Performs a HTTP GET request.
+    
+    Requests that share GETs, such as ResourcesRequest, wait for an identical GET that is already in flight, 
+    rather than making it again. The response is then parsed once, and its result is shared by all of the 
+    waiting requests. A shared GET continues when one of the waiting requests is canceled, and is only 
+    aborted once no request is waiting for it.
+    
+    GETs are shared by requests that use the same QNetworkAccessManager. Requests that have neither a Session 
+    nor a QNetworkAccessManager set make their shared GETs with a QNetworkAccessManager of the thread, so they 
+    share identical GETs with each other.
 */
 void Request::get(bool authRequired) {
     Q_D(Request);
@@ -558,6 +1390,9 @@ void Request::get(bool authRequired) {
     }
     
     d->redirects = 0;
+    d->attempts = 1;
+    d->tokenRefreshed = false;
+    d->startDeadline();
     d->setOperation(GetOperation);
     d->setStatus(Loading);
     
@@ -567,8 +1402,14 @@ void Request::get(bool authRequired) {
 #ifdef QDAILYMOTION_DEBUG
     qDebug() << "QDailymotion::Request::get" << d->url;
 #endif
-    d->reply = d->networkAccessManager()->get(d->buildRequest(authRequired));
-    connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+    d->cancelPending();
+    d->resetParsing();
+    
+    if ((d->loadFromCache()) || (d->startSharedGet(authRequired))) {
+        return;
+    }
+    
+    d->sendRequest(authRequired);
 }
 
 /*!
@@ -583,6 +1424,9 @@ void Request::post(bool authRequired) {
     }
     
     d->redirects = 0;
+    d->attempts = 1;
+    d->tokenRefreshed = false;
+    d->startDeadline();
     d->setOperation(PostOperation);
     
     bool ok = true;
@@ -595,7 +1439,7 @@ void Request::post(bool authRequired) {
         data = d->data.toString().toUtf8();
         break;
     default:
-        data = QtJson::Json::serialize(d->data, ok);
+        data = QtJson::Json::serialize(d->data, QtJson::Writer::Compact, ok);
         break;
     }
 #ifdef QDAILYMOTION_DEBUG
@@ -607,8 +1451,9 @@ void Request::post(bool authRequired) {
         }
         
         d->setStatus(Loading);        
-        d->reply = d->networkAccessManager()->post(d->buildRequest(authRequired), data);
-        connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+        d->cancelPending();
+        d->resetParsing();
+        d->sendRequest(authRequired, data);
     }
     else {
         d->setStatus(Failed);
@@ -630,6 +1475,9 @@ void Request::put(bool authRequired) {
     }
     
     d->redirects = 0;
+    d->attempts = 1;
+    d->tokenRefreshed = false;
+    d->startDeadline();
     d->setOperation(PutOperation);
         
     bool ok = true;
@@ -642,7 +1490,7 @@ void Request::put(bool authRequired) {
         data = d->data.toString().toUtf8();
         break;
     default:
-        data = QtJson::Json::serialize(d->data, ok);
+        data = QtJson::Json::serialize(d->data, QtJson::Writer::Compact, ok);
         break;
     }
 #ifdef QDAILYMOTION_DEBUG
@@ -654,8 +1502,9 @@ void Request::put(bool authRequired) {
         }
         
         d->setStatus(Loading);        
-        d->reply = d->networkAccessManager()->put(d->buildRequest(authRequired), data);
-        connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+        d->cancelPending();
+        d->resetParsing();
+        d->sendRequest(authRequired, data);
     }
     else {
         d->setStatus(Failed);
@@ -677,6 +1526,9 @@ void Request::deleteResource(bool authRequired) {
     }
     
     d->redirects = 0;
+    d->attempts = 1;
+    d->tokenRefreshed = false;
+    d->startDeadline();
     d->setOperation(DeleteOperation);
     d->setStatus(Loading);
     
@@ -686,8 +1538,9 @@ void Request::deleteResource(bool authRequired) {
 #ifdef QDAILYMOTION_DEBUG
     qDebug() << "QDailymotion::Request::deleteResource" << d->url;
 #endif
-    d->reply = d->networkAccessManager()->deleteResource(d->buildRequest(authRequired));
-    connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+    d->cancelPending();
+    d->resetParsing();
+    d->sendRequest(authRequired);
 }
 
 /*!
@@ -696,8 +1549,25 @@ void Request::deleteResource(bool authRequired) {
 void Request::cancel() {
     Q_D(Request);
     
+    d->cancelCalls();
+    
     if (d->reply) {
         d->reply->abort();
+        return;
+    }
+    
+    bool canceled = d->cancelPending();
+#ifndef QT_NO_CONCURRENT
+    if (d->parseWatcher) {
+        d->resetParsing();
+        canceled = true;
+    }
+#endif
+    if (canceled) {
+        d->setStatus(Canceled);
+        d->setError(NoError);
+        d->setErrorString(QString());
+        emit finished();
     }
 }
 
@@ -705,24 +1575,655 @@ RequestPrivate::RequestPrivate(Request *parent) :
     q_ptr(parent),
     manager(0),
     reply(0),
+    documentDecoded(false),
+    cachePolicy(Request::UseCacheControl),
+    cacheHit(false),
+    shareGets(false),
+    waitingForScheduler(false),
+    priority(Request::InteractivePriority),
+    sendAuthRequired(true),
+    maximumAttempts(MAX_ATTEMPTS),
+    retryDelay(RETRY_DELAY),
+    retryNonIdempotent(false),
+    attempts(0),
+    replyRetryAfter(-1),
+    retryTimer(0),
+    deadline(0),
+    hedging(false),
+    keepDeadline(false),
+    deadlineTimer(0),
+    hedgeTimer(0),
+    waitingForHedge(false),
+    isHedge(false),
+    hedgeGets(true),
+    waitingForToken(false),
+    tokenRefreshed(false),
     ownNetworkAccessManager(false),
+    lazyParsing(false),
+    backgroundParsing(false),
+    backgroundParsingThreshold(BACKGROUND_PARSING_THRESHOLD),
+#ifndef QT_NO_CONCURRENT
+    parseWatcher(0),
+#endif
+    replyError(QNetworkReply::NoError),
+    replyStatusCode(0),
     operation(Request::UnknownOperation),
     status(Request::Null),
     error(Request::NoError),
     redirects(0)
 {
+    parser.setKeyPool(sharedKeyPool());
+}
+
+RequestPrivate::~RequestPrivate() {}
+
+QNetworkAccessManager* RequestPrivate::networkAccessManager() {
+    if (session) {
+        return session->networkAccessManager();
+    }
+    
+    if (!manager) {
+        Q_Q(Request);
+        ownNetworkAccessManager = true;
+        manager = new QNetworkAccessManager(q);
+    }
+    
+    return manager;
+}
+
+int RequestPrivate::maximumRedirects() const {
+    return session ? session->maximumRedirects() : MAX_REDIRECTS;
+}
+
+ResponseCache* RequestPrivate::responseCache() const {
+    return session ? session->responseCache() : cache.data();
+}
+
+// The credentials of the request are held by the session, the token manager or the request itself
+QObject* RequestPrivate::credentialsHolder() const {
+    if (session) {
+        return session;
+    }
+    
+    return tokenManager;
+}
+
+void RequestPrivate::disconnectCredentials() {
+    QObject *holder = credentialsHolder();
+    
+    if (holder) {
+        Q_Q(Request);
+        Request::disconnect(holder, 0, q, 0);
+    }
+}
+
+void RequestPrivate::connectCredentials() {
+    QObject *holder = credentialsHolder();
+    
+    if (holder) {
+        Q_Q(Request);
+        Request::connect(holder, SIGNAL(clientIdChanged()), q, SIGNAL(clientIdChanged()));
+        Request::connect(holder, SIGNAL(clientSecretChanged()), q, SIGNAL(clientSecretChanged()));
+        Request::connect(holder, SIGNAL(accessTokenChanged(QString)), q, SIGNAL(accessTokenChanged(QString)));
+        Request::connect(holder, SIGNAL(refreshTokenChanged(QString)), q, SIGNAL(refreshTokenChanged(QString)));
+    }
+    
+    // The policies of the session replace those of the request
+    if (session) {
+        Q_Q(Request);
+        Request::connect(session, SIGNAL(maximumAttemptsChanged()), q, SIGNAL(maximumAttemptsChanged()));
+        Request::connect(session, SIGNAL(retryDelayChanged()), q, SIGNAL(retryDelayChanged()));
+        Request::connect(session, SIGNAL(retryNonIdempotentChanged()), q, SIGNAL(retryNonIdempotentChanged()));
+        Request::connect(session, SIGNAL(deadlineChanged()), q, SIGNAL(deadlineChanged()));
+        Request::connect(session, SIGNAL(hedgingChanged()), q, SIGNAL(hedgingChanged()));
+    }
+}
+
+// Emits the change signals of the credentials that differ from those held before
+void RequestPrivate::emitCredentialChanges(const QString &id, const QString &secret, const QString &token,
+                                           const QString &refresh) {
+    Q_Q(Request);
+    
+    if (q->clientId() != id) {
+        emit q->clientIdChanged();
+    }
+    
+    if (q->clientSecret() != secret) {
+        emit q->clientSecretChanged();
+    }
+    
+    if (q->accessToken() != token) {
+        emit q->accessTokenChanged(q->accessToken());
+    }
+    
+    if (q->refreshToken() != refresh) {
+        emit q->refreshTokenChanged(q->refreshToken());
+    }
+}
+
+// Emits the change signals of the policies that differ from those that applied before
+void RequestPrivate::emitPolicyChanges(int attempts, int delay, bool nonIdempotent, int msecs, bool hedge) {
+    Q_Q(Request);
+    
+    if (q->maximumAttempts() != attempts) {
+        emit q->maximumAttemptsChanged();
+    }
+    
+    if (q->retryDelay() != delay) {
+        emit q->retryDelayChanged();
+    }
+    
+    if (q->retryNonIdempotent() != nonIdempotent) {
+        emit q->retryNonIdempotentChanged();
+    }
+    
+    if (q->deadline() != msecs) {
+        emit q->deadlineChanged();
+    }
+    
+    if (q->hedging() != hedge) {
+        emit q->hedgingChanged();
+    }
+}
+
+// Gives request the session, credentials and policies of this request, and requestManager unless it is attached
+void RequestPrivate::configure(Request *request, QNetworkAccessManager *requestManager) {
+    request->setSession(session);
+    
+    if (!session) {
+        request->setNetworkAccessManager(requestManager);
+        request->setTokenManager(tokenManager);
+        
+        if (!tokenManager) {
+            request->setClientId(clientId);
+            request->setClientSecret(clientSecret);
+            request->setAccessToken(accessToken);
+            request->setRefreshToken(refreshToken);
+        }
+    }
+    
+    request->setHeaders(headers);
+    request->setLazyParsing(lazyParsing);
+    request->setBackgroundParsing(backgroundParsing);
+    request->setBackgroundParsingThreshold(backgroundParsingThreshold);
+    request->setResponseCache(cache);
+    request->setCachePolicy(cachePolicy);
+    request->setScheduler(scheduler);
+    request->setPriority(priority);
+    
+    // The policies of the session apply to the request already
+    if (!session) {
+        request->setMaximumAttempts(maximumAttempts);
+        request->setRetryDelay(retryDelay);
+        request->setRetryNonIdempotent(retryNonIdempotent);
+        request->setDeadline(deadline);
+        request->setHedging(hedging);
+    }
+}
+
+RequestScheduler* RequestPrivate::requestScheduler() const {
+    return session ? session->scheduler() : scheduler.data();
+}
+
+TokenManager* RequestPrivate::requestTokenManager() const {
+    return session ? session->tokenManager() : tokenManager.data();
+}
+
+// Sends the HTTP request of the current operation, once the token manager and the scheduler allow it
+void RequestPrivate::sendRequest(bool authRequired, const QByteArray &body) {
+    sendAuthRequired = authRequired;
+    sendBody = body;
+    
+    // The request is not sent with an access token that is being refreshed, or has expired
+    if ((authRequired) && (waitForToken(false))) {
+        return;
+    }
+    
+    // The scheduler counts the request until it finishes, including its redirects
+    RequestScheduler *s = requestScheduler();
+    
+    if (s) {
+        Q_Q(Request);
+        activeScheduler = s;
+        waitingForScheduler = true;
+        s->enqueue(q);
+        return;
+    }
+    
+    startReply();
+}
+
+void RequestPrivate::startReply() {
+    Q_Q(Request);
+    
+    const QNetworkRequest request = buildRequest(sendAuthRequired);
+    sentAccessToken = q->accessToken();
+    
+    switch (operation) {
+    case Request::HeadOperation:
+        reply = networkAccessManager()->head(request);
+        break;
+    case Request::GetOperation:
+        reply = networkAccessManager()->get(request);
+        break;
+    case Request::PostOperation:
+        reply = networkAccessManager()->post(request, sendBody);
+        break;
+    case Request::PutOperation:
+        reply = networkAccessManager()->put(request, sendBody);
+        break;
+    case Request::DeleteOperation:
+        reply = networkAccessManager()->deleteResource(request);
+        break;
+    default:
+        return;
+    }
+    
+    Request::connect(reply, SIGNAL(readyRead()), q, SLOT(_q_onReplyReadyRead()));
+    Request::connect(reply, SIGNAL(finished()), q, SLOT(_q_onReplyFinished()));
+    replyTime.start();
+    
+    // A GET that is slower than most is hedged with a second attempt
+    if ((operation == Request::GetOperation) && (hedgeGets) && (!isHedge) && (!hedge)
+        && (session ? session->hedging() : hedging)) {
+        const qint64 p95 = latencyPercentile();
+        
+        if (p95 >= 0) {
+            if (!hedgeTimer) {
+                hedgeTimer = new QTimer(q);
+                hedgeTimer->setSingleShot(true);
+                Request::connect(hedgeTimer, SIGNAL(timeout()), q, SLOT(_q_onHedgeTimeout()));
+            }
+            
+            hedgeTimer->start(int(qMax(Q_INT64_C(1), p95)));
+        }
+    }
+}
+
+// Starts the deadline of a new operation. An operation that is made again with a refreshed access token keeps 
+// the deadline that it already has.
+void RequestPrivate::startDeadline() {
+    if ((keepDeadline) && (deadlineTimer) && (deadlineTimer->isActive())) {
+        return;
+    }
+    
+    const int msecs = session ? session->deadline() : deadline;
+    
+    if (msecs <= 0) {
+        if (deadlineTimer) {
+            deadlineTimer->stop();
+        }
+        
+        return;
+    }
+    
+    if (!deadlineTimer) {
+        Q_Q(Request);
+        deadlineTimer = new QTimer(q);
+        deadlineTimer->setSingleShot(true);
+        Request::connect(deadlineTimer, SIGNAL(timeout()), q, SLOT(_q_onDeadlineExpired()));
+    }
+    
+    deadlineTimer->start(msecs);
+}
+
+// Cancels the hedged GET, returning true if there was one
+bool RequestPrivate::cancelHedge() {
+    if (hedgeTimer) {
+        hedgeTimer->stop();
+    }
+    
+    waitingForHedge = false;
+    
+    if (!hedge) {
+        return false;
+    }
+    
+    Q_Q(Request);
+    
+    Request *request = hedge;
+    hedge = 0;
+    request->disconnect(q);
+    request->cancel();
+    request->deleteLater();
+    return true;
+}
+
+// Waits for the token manager to refresh the access token, either because it has been refused, or before the request 
+// is sent. Returns false if the request has no token manager, or does not need to wait for it.
+bool RequestPrivate::waitForToken(bool refused) {
+    TokenManager *manager = requestTokenManager();
+    
+    if (!manager) {
+        return false;
+    }
+    
+    Q_Q(Request);
+    
+    if (refused) {
+        // The scheduler does not count the request while it waits
+        leaveScheduler();
+        tokenRefreshed = true;
+        manager->refreshFor(q, sentAccessToken);
+    }
+    else if (!manager->waitFor(q)) {
+        return false;
+    }
+    
+    activeTokenManager = manager;
+    waitingForToken = true;
+    return true;
+}
+
+// Stops waiting for the token manager, returning true if the request was waiting
+bool RequestPrivate::leaveTokenManager() {
+    if (!waitingForToken) {
+        return false;
+    }
+    
+    waitingForToken = false;
+    
+    if (activeTokenManager) {
+        Q_Q(Request);
+        activeTokenManager->remove(q);
+        activeTokenManager = 0;
+    }
+    
+    return true;
+}
+
+// Stops waiting for the scheduler, or stops being counted by it, returning true if the request was waiting
+bool RequestPrivate::leaveScheduler() {
+    const bool waiting = waitingForScheduler;
+    waitingForScheduler = false;
+    
+    if (activeScheduler) {
+        Q_Q(Request);
+        activeScheduler->remove(q);
+        activeScheduler = 0;
+    }
+    
+    return waiting;
+}
+
+// Responses are cached for each access token, since they can depend on the authenticated user, and for each 
+// projection, since a projected result holds only part of the response
+QByteArray RequestPrivate::responseCacheKey() const {
+    Q_Q(const Request);
+    
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(url.toEncoded());
+    hash.addData("\n");
+    hash.addData(q->accessToken().toUtf8());
+    hash.addData("\n");
+    hash.addData(parser.projection().join(",").toUtf8());
+    return hash.result().toHex();
+}
+
+// Returns true if the GET is served from the cache, and otherwise keeps the cached response for revalidation
+bool RequestPrivate::loadFromCache() {
+    ResponseCache *c = responseCache();
+    cacheEntry = CacheEntry();
+    cacheKey = c ? responseCacheKey() : QByteArray();
+    cacheHit = false;
+    
+    if ((!c) || (cachePolicy == Request::NetworkOnly)) {
+        return false;
+    }
+    
+    cacheEntry = c->entry(cacheKey);
+    
+    switch (cachePolicy) {
+    case Request::UseCacheControl:
+        cacheHit = cacheEntry.isFresh();
+        break;
+    case Request::PreferCache:
+        cacheHit = cacheEntry.valid;
+        break;
+    case Request::CacheOnly:
+        // The request fails in _q_onCacheHit() if there is no cached response
+        cacheHit = true;
+        break;
+    default:
+        break;
+    }
+    
+    if (cacheHit) {
+        // The result is delivered asynchronously, as it would be from the network
+        Q_Q(Request);
+        QMetaObject::invokeMethod(q, "_q_onCacheHit", Qt::QueuedConnection);
+    }
+    
+    return cacheHit;
+}
+
+// Uses the cached result for a 304 Not Modified response, and stores or invalidates cached responses
+void RequestPrivate::updateResponseCache() {
+    ResponseCache *c = responseCache();
+    
+    if (!c) {
+        return;
+    }
+    
+    switch (operation) {
+    case Request::GetOperation:
+        if (cacheKey.isEmpty()) {
+            break;
+        }
+        
+        if ((replyStatusCode == 304) && (cacheEntry.valid)) {
+            setDocument(QtJson::Document());
+            setResult(cacheEntry.result);
+            
+            // The freshness of the cached response is renewed by the 304 response
+            if (replyCacheEntry.expires.isValid()) {
+                cacheEntry.expires = replyCacheEntry.expires;
+                cacheEntry.noCache = replyCacheEntry.noCache;
+                
+                if (!replyCacheEntry.etag.isEmpty()) {
+                    cacheEntry.etag = replyCacheEntry.etag;
+                }
+                
+                c->insert(cacheKey, url.path(), cacheEntry);
+            }
+        }
+        else if ((replyStatusCode == 200) && (replyCacheEntry.isStorable())) {
+            Q_Q(Request);
+            replyCacheEntry.result = q->result();
+            c->insert(cacheKey, url.path(), replyCacheEntry);
+        }
+        
+        break;
+    case Request::PostOperation:
+    case Request::PutOperation:
+    case Request::DeleteOperation:
+        // A change to the resource invalidates its cached responses, whatever their fields and projection
+        foreach (const QString &path, changedUrlPaths()) {
+            c->invalidate(path);
+        }
+        
+        break;
+    default:
+        break;
+    }
+    
+    cacheKey.clear();
+    cacheEntry = CacheEntry();
+    replyCacheEntry = CacheEntry();
+}
+
+// Returns the URL paths of the resources changed by the current write, which is made to the resource at its URL
+QStringList RequestPrivate::changedUrlPaths() const {
+    return QStringList() << url.path();
+}
+
+// Returns true if the GET is served from the ResultCache, and otherwise keeps the key so that the result is stored
+bool RequestPrivate::loadFromResultCache(const QString &key) {
+    resultCachePaths.clear();
+    
+    // The result is not decoded for the cache unless the cache keeps it
+    if (!ResultCache::isEnabled()) {
+        resultCacheKey.clear();
+        return false;
+    }
+    
+    resultCacheKey = key;
+    
+    if ((cachePolicy == Request::NetworkOnly) || (cachePolicy == Request::Revalidate)) {
+        return false;
+    }
+    
+    QVariant res;
+    
+    if (!ResultCache::find(key, &res)) {
+        return false;
+    }
+    
+    Q_Q(Request);
+    
+    redirects = 0;
+    setOperation(Request::GetOperation);
+    setStatus(Request::Loading);
+    
+    if (reply) {
+        delete reply;
+    }
+    
+    resetParsing();
+    
+    // The result is delivered in the same way as a cached response
+    resultCacheKey.clear();
+    cacheKey.clear();
+    cacheEntry = CacheEntry();
+    cacheEntry.result = res;
+    cacheEntry.valid = true;
+    cacheHit = true;
+    QMetaObject::invokeMethod(q, "_q_onCacheHit", Qt::QueuedConnection);
+    return true;
+}
+
+// Stores the result of a list or get in the ResultCache, or invalidates the results affected by a write
+void RequestPrivate::updateResultCache() {
+    if ((!resultCacheKey.isEmpty()) && (ResultCache::isEnabled())) {
+        Q_Q(Request);
+        ResultCache::insert(resultCacheKey, q->result());
+    }
+    
+    foreach (const QString &path, resultCachePaths) {
+        ResultCache::invalidate(path);
+    }
+    
+    resultCacheKey.clear();
+    resultCachePaths.clear();
+}
+
+// Requests share a GET only if they would make the same request, parse the response in the same way and give it
+// the same deadline
+QByteArray RequestPrivate::sharedGetKey(bool authRequired) {
+    Q_Q(Request);
+    
+    // The headers of the request take precedence over those of the session
+    QVariantMap allHeaders = session ? session->headers() : QVariantMap();
+    QMapIterator<QString, QVariant> iterator(headers);
+    
+    while (iterator.hasNext()) {
+        iterator.next();
+        allHeaders[iterator.key()] = iterator.value();
+    }
+    
+    QByteArray key = url.toEncoded();
+    key += "\n";
+    key += authRequired ? q->accessToken().toUtf8() : QByteArray();
+    key += "\n";
+    key += QtJson::Json::serialize(allHeaders, QtJson::Writer::Compact);
+    key += "\n";
+    key += parser.projection().join(",").toUtf8();
+    key += "\n";
+    key += QByteArray::number(quintptr(sharedGetManager()), 16);
+    key += "\n";
+    key += QByteArray::number(q->deadline());
+    key += lazyParsing ? "\nlazy" : "\n";
+    return key;
+}
+
+// Returns the QNetworkAccessManager of a shared GET, which is that of the session, or the one set on the request, 
+// or else one that is shared by all requests in the thread
+QNetworkAccessManager* RequestPrivate::sharedGetManager() {
+    if (session) {
+        return session->networkAccessManager();
+    }
+    
+    if ((manager) && (!ownNetworkAccessManager)) {
+        return manager;
+    }
+    
+    return sharedGetManagerInThread();
+}
+
+// Waits for an identical GET that is in flight, or starts a shared GET that later requests can wait for
+bool RequestPrivate::startSharedGet(bool authRequired) {
+    if (!shareGets) {
+        return false;
+    }
+    
+    Q_Q(Request);
+    
+    SharedGets *gets = sharedGetsInThread();
+    const QByteArray key = sharedGetKey(authRequired);
+    Request *get = gets->value(key);
+    
+    if ((!get) || (get->status() != Request::Loading)) {
+        // The GET is made by a request of its own, so that it is not canceled with the request that started it
+        get = new Request;
+        configure(get, sharedGetManager());
+        get->setUrl(url);
+        get->setProjection(parser.projection());
+        get->d_func()->sharedKey = key;
+        Request::connect(get, SIGNAL(finished()), get, SLOT(deleteLater()));
+        gets->insert(key, get);
+        get->get(authRequired);
+    }
+#ifdef QDAILYMOTION_DEBUG
+    else {
+        qDebug() << "QDailymotion::RequestPrivate::startSharedGet: Sharing GET" << url;
+    }
+#endif
+    // The cached response is revalidated by the shared GET
+    cacheKey.clear();
+    cacheEntry = CacheEntry();
+    sharedGet = get;
+    get->d_func()->sharers.append(q);
+    Request::connect(get, SIGNAL(finished()), q, SLOT(_q_onSharedGetFinished()));
+    return true;
 }
 
-RequestPrivate::~RequestPrivate() {}
-
-QNetworkAccessManager* RequestPrivate::networkAccessManager() {    
-    if (!manager) {
-        Q_Q(Request);
-        ownNetworkAccessManager = true;
-        manager = new QNetworkAccessManager(q);
+// Stops waiting for the shared GET, which is canceled once no request is waiting for it
+bool RequestPrivate::leaveSharedGet() {
+    if (!sharedGet) {
+        return false;
     }
     
-    return manager;
+    Q_Q(Request);
+    
+    Request *get = sharedGet;
+    RequestPrivate *shared = get->d_func();
+    sharedGet = 0;
+    get->disconnect(q);
+    shared->sharers.removeAll(q);
+    shared->sharers.removeAll(QPointer<Request>());
+    
+    if (shared->sharers.isEmpty()) {
+        SharedGets *gets = sharedGetsInThread();
+        
+        if (gets->value(shared->sharedKey) == get) {
+            gets->remove(shared->sharedKey);
+        }
+        
+        get->cancel();
+        get->deleteLater();
+    }
+    
+    return true;
 }
 
 void RequestPrivate::setOperation(Request::Operation op) {
@@ -737,6 +2238,16 @@ void RequestPrivate::setOperation(Request::Operation op) {
 }
 
 void RequestPrivate::setStatus(Request::Status s) {
+    // The scheduler can send another request once this one has finished
+    if (s != Request::Loading) {
+        leaveScheduler();
+        cancelHedge();
+        
+        if (deadlineTimer) {
+            deadlineTimer->stop();
+        }
+    }
+    
     if (s != status) {
         Q_Q(Request);
         status = s;
@@ -761,6 +2272,12 @@ void RequestPrivate::setErrorString(const QString &es) {
 #endif
 }
 
+void RequestPrivate::setDocument(const QtJson::Document &doc) {
+    document = doc;
+    documentResult = QVariant();
+    documentDecoded = false;
+}
+
 void RequestPrivate::setResult(const QVariant &res) {
     result = res;
 #ifdef QDAILYMOTION_DEBUG
@@ -768,6 +2285,25 @@ void RequestPrivate::setResult(const QVariant &res) {
 #endif
 }
 
+bool RequestPrivate::setParseResult(const ParseResult &res) {
+    setDocument(res.document);
+    setResult(res.result);
+    return res.ok;
+}
+
+void RequestPrivate::resetParsing() {
+    parser.reset();
+    buffer.clear();
+#ifndef QT_NO_CONCURRENT
+    if (parseWatcher) {
+        // The worker is left to finish, but its result is discarded
+        parseWatcher->disconnect();
+        parseWatcher->deleteLater();
+        parseWatcher = 0;
+    }
+#endif
+}
+
 QNetworkRequest RequestPrivate::buildRequest(bool authRequired) {
     return buildRequest(url, authRequired);
 }
@@ -781,14 +2317,44 @@ QNetworkRequest RequestPrivate::buildRequest(QUrl u, bool authRequired) {
     switch (operation) {
     case Request::PostOperation:
     case Request::PutOperation:
-        request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
+        switch (data.type()) {
+        case QVariant::String:
+        case QVariant::ByteArray:
+        case QVariant::Invalid:
+            request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
+            break;
+        default:
+            // Other data is serialized as JSON
+            request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+            break;
+        }
+        
         break;
     default:
         break;
     }
     
-    if ((authRequired) && (!accessToken.isEmpty())) {
-        request.setRawHeader("Authorization", "Bearer " + accessToken.toUtf8());
+    Q_Q(Request);
+    const QString token = q->accessToken();
+    
+    if ((authRequired) && (!token.isEmpty())) {
+        request.setRawHeader("Authorization", "Bearer " + token.toUtf8());
+    }
+    
+    // A cached response is revalidated with a conditional request
+    if ((operation == Request::GetOperation) && (cacheEntry.valid) && (u == url)) {
+        if (!cacheEntry.etag.isEmpty()) {
+            request.setRawHeader("If-None-Match", cacheEntry.etag);
+        }
+        
+        if (!cacheEntry.lastModified.isEmpty()) {
+            request.setRawHeader("If-Modified-Since", cacheEntry.lastModified);
+        }
+    }
+    
+    // The headers of the request take precedence over those of the session
+    if ((session) && (!session->headers().isEmpty())) {
+        addRequestHeaders(&request, session->headers());
     }
     
     if (!headers.isEmpty()) {
@@ -807,17 +2373,33 @@ void RequestPrivate::followRedirect(const QUrl &redirect) {
         delete reply;
     }
         
+    resetParsing();
     reply = networkAccessManager()->get(buildRequest(redirect));
+    Request::connect(reply, SIGNAL(readyRead()), q, SLOT(_q_onReplyReadyRead()));
     Request::connect(reply, SIGNAL(finished()), q, SLOT(_q_onReplyFinished()));
 }
 
+QUrl RequestPrivate::redirectUrl() const {
+    if ((!reply) || (redirects >= maximumRedirects())) {
+        return QUrl();
+    }
+    
+    QUrl redirect = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toString();
+    
+    if (redirect.isEmpty()) {
+        redirect = reply->header(QNetworkRequest::LocationHeader).toString();
+    }
+    
+    return redirect;
+}
+
 void RequestPrivate::refreshAccessToken() {
     Q_Q(Request);
     
     QNetworkRequest request(TOKEN_URL);
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
-    const QString body("client_id=" + clientId + "&client_secret=" + clientSecret + "&refresh_token=" + refreshToken +
-                       "&grant_type=" + GRANT_TYPE_REFRESH);
+    const QString body("client_id=" + q->clientId() + "&client_secret=" + q->clientSecret() + "&refresh_token=" +
+                       q->refreshToken() + "&grant_type=" + GRANT_TYPE_REFRESH);
                     
     if (reply) {
         delete reply;
@@ -870,6 +2452,7 @@ void RequestPrivate::_q_onAccessTokenRefreshed() {
         }
         else {
             q->setAccessToken(token);
+            keepDeadline = true;
             
             switch (operation) {
             case Request::GetOperation:
@@ -887,6 +2470,8 @@ void RequestPrivate::_q_onAccessTokenRefreshed() {
             default:
                 break;
             }
+            
+            keepDeadline = false;
         }
     }
     else {
@@ -897,38 +2482,437 @@ void RequestPrivate::_q_onAccessTokenRefreshed() {
     }
 }
 
+// Cancels anything other than the reply that the request is waiting for, returning true if there was anything
+bool RequestPrivate::cancelPending() {
+    // A shared GET continues for the other requests that are waiting for it
+    bool canceled = leaveSharedGet();
+    
+    if (leaveScheduler()) {
+        canceled = true;
+    }
+    
+    if (leaveTokenManager()) {
+        canceled = true;
+    }
+    
+    if ((retryTimer) && (retryTimer->isActive())) {
+        retryTimer->stop();
+        canceled = true;
+    }
+    
+    if (cancelHedge()) {
+        canceled = true;
+    }
+    
+    if (cacheHit) {
+        cacheHit = false;
+        canceled = true;
+    }
+    
+    return canceled;
+}
+
+// Cancels the requests that are made on behalf of the request, which has none unless it is a ResourcesRequest
+void RequestPrivate::cancelCalls() {}
+
+void RequestPrivate::_q_onReplyReadyRead() {
+    if (!reply) {
+        return;
+    }
+    
+    // The GET is not hedged once it has started to answer
+    if (hedgeTimer) {
+        hedgeTimer->stop();
+    }
+    
+    // The body of a redirect is discarded, so there is no need to parse it
+    if (redirectUrl().isEmpty()) {
+        if ((lazyParsing) || (backgroundParsing)) {
+            buffer.append(reply->readAll());
+        }
+        else {
+            parser.addData(reply->readAll());
+        }
+    }
+}
+
 void RequestPrivate::_q_onReplyFinished() {
     if (!reply) {
         return;
     }
     
+    if (activeScheduler) {
+        activeScheduler->updateRateLimit(reply);
+    }
+    
+    const QUrl redirect = redirectUrl();
+    
+    if (!redirect.isEmpty()) {
+        reply->deleteLater();
+        reply = 0;
+        followRedirect(redirect);
+        return;
+    }
+    
+    if ((lazyParsing) || (backgroundParsing)) {
+        buffer.append(reply->readAll());
+    }
+    else {
+        parser.addData(reply->readAll());
+    }
+    
+    replyError = reply->error();
+    replyErrorString = reply->errorString();
+    replyStatusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    replyRetryAfter = retryAfter(reply);
+    replyCacheEntry = cacheKey.isEmpty() ? CacheEntry() : CacheEntry::fromReply(reply);
+    reply->deleteLater();
+    reply = 0;
+#ifndef QT_NO_CONCURRENT
+    if ((backgroundParsing) && (buffer.size() >= backgroundParsingThreshold)) {
+        // The result is passed back to this thread in _q_onParseFinished()
+        Q_Q(Request);
+        parseWatcher = new QFutureWatcher<ParseResult>(q);
+        Request::connect(parseWatcher, SIGNAL(finished()), q, SLOT(_q_onParseFinished()));
+        parseWatcher->setFuture(QtConcurrent::run(parseResponse, buffer, lazyParsing, parser.projection()));
+        buffer.clear();
+        parser.reset();
+        return;
+    }
+#endif
+    bool ok = true;
+    
+    if (lazyParsing) {
+        ok = setParseResult(parseResponse(buffer, true, QStringList()));
+        buffer.clear();
+    }
+    else {
+        setDocument(QtJson::Document());
+        
+        // A response buffered for background parsing, but too small to be worth the thread hop
+        if (!buffer.isEmpty()) {
+            parser.addData(buffer);
+            buffer.clear();
+        }
+        
+        if (parser.isEmpty()) {
+            setResult(QString());
+        }
+        else {
+            ok = parser.finish();
+            setResult(parser.result());
+        }
+    }
+    
+    parser.reset();
+    completeReply(ok);
+}
+
+void RequestPrivate::_q_onParseFinished() {
+#ifndef QT_NO_CONCURRENT
+    if (!parseWatcher) {
+        return;
+    }
+    
+    const ParseResult res = parseWatcher->result();
+    parseWatcher->deleteLater();
+    parseWatcher = 0;
+    completeReply(setParseResult(res));
+#endif
+}
+
+void RequestPrivate::_q_onCacheHit() {
+    if (!cacheHit) {
+        return;
+    }
+    
+    Q_Q(Request);
+    
+    cacheHit = false;
+    setDocument(QtJson::Document());
+    
+    if (cacheEntry.valid) {
+        setResult(cacheEntry.result);
+        updateResultCache();
+        setStatus(Request::Ready);
+        setError(Request::NoError);
+        setErrorString(QString());
+    }
+    else {
+        setResult(QVariant());
+        setStatus(Request::Failed);
+        setError(Request::ContentNotFoundError);
+        setErrorString(Request::tr("The response is not cached"));
+    }
+    
+    cacheKey.clear();
+    cacheEntry = CacheEntry();
+    emit q->finished();
+}
+
+void RequestPrivate::_q_onSharedGetFinished() {
     Q_Q(Request);
     
-    if (redirects < MAX_REDIRECTS) {
-        QUrl redirect = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toString();
+    Request *get = qobject_cast<Request*>(q->sender());
+    
+    if ((!get) || (get != sharedGet)) {
+        return;
+    }
+    
+    const RequestPrivate *shared = get->d_func();
+    SharedGets *gets = sharedGetsInThread();
+    
+    if (gets->value(shared->sharedKey) == get) {
+        gets->remove(shared->sharedKey);
+    }
+    
+    sharedGet = 0;
+    
+    // An access token refreshed by the shared GET is used by this request
+    if ((!session) && (get->accessToken() != q->accessToken())) {
+        q->setAccessToken(get->accessToken());
+    }
+    
+    setDocument(shared->document);
+    setResult(shared->result);
+    
+    if (get->status() == Request::Ready) {
+        updateResultCache();
+    }
+    
+    setStatus(get->status());
+    setError(get->error());
+    setErrorString(get->errorString());
+    emit q->finished();
+}
+
+// Schedules another attempt after a transient failure, returning false if the request should fail instead
+bool RequestPrivate::startRetry() {
+    if (attempts >= (session ? session->maximumAttempts() : maximumAttempts)) {
+        return false;
+    }
+    
+    // Only idempotent requests are retried, unless the request allows otherwise
+    switch (operation) {
+    case Request::HeadOperation:
+    case Request::GetOperation:
+    case Request::PutOperation:
+    case Request::DeleteOperation:
+        break;
+    case Request::PostOperation:
+        if (!(session ? session->retryNonIdempotent() : retryNonIdempotent)) {
+            return false;
+        }
+        
+        break;
+    default:
+        return false;
+    }
     
-        if (redirect.isEmpty()) {
-            redirect = reply->header(QNetworkRequest::LocationHeader).toString();
+    switch (replyError) {
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+        break;
+    default:
+        if ((replyStatusCode != 429) && ((replyStatusCode < 500) || (replyStatusCode >= 600))) {
+            return false;
         }
+        
+        break;
+    }
+    
+    // A request that the server will not accept for a long time fails rather than waiting
+    if (replyRetryAfter > MAX_RETRY_DELAY) {
+        return false;
+    }
+    
+    // Full jitter: a random delay of up to the exponential backoff, but no less than the server asks for
+    const qint64 base = session ? session->retryDelay() : retryDelay;
+    const qint64 backoff = qMin(qint64(MAX_RETRY_DELAY), base << qMin(attempts - 1, 16));
+    const qint64 delay = qMax(qint64(randomFraction() * backoff), replyRetryAfter);
+    
+    Q_Q(Request);
+    
+    if (!retryTimer) {
+        retryTimer = new QTimer(q);
+        retryTimer->setSingleShot(true);
+        Request::connect(retryTimer, SIGNAL(timeout()), q, SLOT(_q_onRetryTimeout()));
+    }
+    
+    // The scheduler can send other requests in the meantime
+    leaveScheduler();
+    retryTimer->start(int(delay));
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::RequestPrivate::startRetry: Retrying in" << delay << "ms" << url;
+#endif
+    return true;
+}
+
+void RequestPrivate::_q_onRetryTimeout() {
+    attempts++;
+    redirects = 0;
+    replyError = QNetworkReply::NoError;
+    replyErrorString = QString();
+    resetParsing();
+    sendRequest(sendAuthRequired, sendBody);
+}
+
+void RequestPrivate::_q_onTokenRefreshed(int e, const QString &es) {
+    if (!waitingForToken) {
+        return;
+    }
+    
+    waitingForToken = false;
+    activeTokenManager = 0;
+    
+    // A request that waited before it was sent is sent anyway, since its access token may still be accepted
+    if ((e != Request::NoError) && (tokenRefreshed)) {
+        Q_Q(Request);
+        setStatus(Request::Failed);
+        setError(Request::Error(e));
+        setErrorString(es);
+        emit q->finished();
+        return;
+    }
+    
+    redirects = 0;
+    replyError = QNetworkReply::NoError;
+    replyErrorString = QString();
+    resetParsing();
+    sendRequest(sendAuthRequired, sendBody);
+}
+
+void RequestPrivate::_q_onDeadlineExpired() {
+    if (status != Request::Loading) {
+        return;
+    }
+    
+    Q_Q(Request);
+    
+    // Everything that the operation is waiting for is abandoned
+    if (reply) {
+        reply->disconnect(q);
+        reply->abort();
+        reply->deleteLater();
+        reply = 0;
+    }
+    
+    cancelPending();
+    resetParsing();
+    setStatus(Request::Failed);
+    setError(Request::TimeoutError);
+    setErrorString(Request::tr("The request did not finish before its deadline"));
+    emit q->finished();
+}
+
+void RequestPrivate::_q_onHedgeTimeout() {
+    if ((!reply) || (hedge) || (operation != Request::GetOperation)) {
+        return;
+    }
+    
+    Q_Q(Request);
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::RequestPrivate::_q_onHedgeTimeout: Hedging GET" << url;
+#endif
+    Request *request = new Request;
+    configure(request, networkAccessManager());
+    request->setUrl(url);
+    request->setProjection(parser.projection());
+    request->d_func()->isHedge = true;
+    hedge = request;
+    Request::connect(request, SIGNAL(finished()), q, SLOT(_q_onHedgeFinished()));
+    request->get(sendAuthRequired);
+}
+
+void RequestPrivate::_q_onHedgeFinished() {
+    Q_Q(Request);
+    
+    Request *request = qobject_cast<Request*>(q->sender());
+    
+    if ((!request) || (request != hedge)) {
+        return;
+    }
+    
+    hedge = 0;
+    request->deleteLater();
     
-        if (!redirect.isEmpty()) {
+    if (request->status() == Request::Ready) {
+        // The hedged GET has won, so the first attempt is abandoned
+        if (reply) {
+            reply->disconnect(q);
+            reply->abort();
             reply->deleteLater();
             reply = 0;
-            followRedirect(redirect);
-            return;
         }
+        
+        resetParsing();
+        
+        if (retryTimer) {
+            retryTimer->stop();
+        }
+        
+        if ((!session) && (request->accessToken() != q->accessToken())) {
+            q->setAccessToken(request->accessToken());
+        }
+        
+        const RequestPrivate *hedged = request->d_func();
+        waitingForHedge = false;
+        cacheKey.clear();
+        cacheEntry = CacheEntry();
+        setDocument(hedged->document);
+        setResult(hedged->result);
+        updateResultCache();
+        setStatus(Request::Ready);
+        setError(Request::NoError);
+        setErrorString(QString());
+        emit q->finished();
+    }
+    else if (waitingForHedge) {
+        // Both attempts have failed, so the first is completed with its own error
+        waitingForHedge = false;
+        completeReply(false);
+    }
+}
+
+void RequestPrivate::_q_onScheduled() {
+    if (!waitingForScheduler) {
+        return;
     }
     
-    bool ok = true;
-    const QString response = QString::fromUtf8(reply->readAll());
-    setResult(response.isEmpty() ? response : QtJson::Json::parse(response, ok));
+    waitingForScheduler = false;
+    startReply();
+}
+
+void RequestPrivate::completeReply(bool ok) {
+    Q_Q(Request);
     
-    const QNetworkReply::NetworkError e = reply->error();
-    const QString es = reply->errorString();
-    reply->deleteLater();
-    reply = 0;
+    if (hedgeTimer) {
+        hedgeTimer->stop();
+    }
     
-    switch (e) {
+    // The first successful attempt wins, so a failure waits for the hedged GET
+    if (hedge) {
+        switch (replyError) {
+        case QNetworkReply::NoError:
+            if (!ok) {
+                waitingForHedge = true;
+                return;
+            }
+            
+            cancelHedge();
+            break;
+        case QNetworkReply::OperationCanceledError:
+        case QNetworkReply::AuthenticationRequiredError:
+            cancelHedge();
+            break;
+        default:
+            waitingForHedge = true;
+            return;
+        }
+    }
+    
+    switch (replyError) {
     case QNetworkReply::NoError:
         break;
     case QNetworkReply::OperationCanceledError:
@@ -938,26 +2922,37 @@ void RequestPrivate::_q_onReplyFinished() {
         emit q->finished();
         return;
     case QNetworkReply::AuthenticationRequiredError:
-        if (refreshToken.isEmpty()) {
+        // An access token that is refused again after it has been refreshed is not refreshed again
+        if ((q->refreshToken().isEmpty()) || (tokenRefreshed)) {
             setStatus(Request::Failed);
-            setError(Request::Error(e));
-            setErrorString(es);
+            setError(Request::Error(replyError));
+            setErrorString(replyErrorString);
             emit q->finished();
         }
-        else {
+        else if (!waitForToken(true)) {
             refreshAccessToken();
         }
         
         return;
     default:
+        if (startRetry()) {
+            return;
+        }
+        
         setStatus(Request::Failed);
-        setError(Request::Error(e));
-        setErrorString(es);
+        setError(Request::Error(replyError));
+        setErrorString(replyErrorString);
         emit q->finished();
         return;
     }
     
     if (ok) {
+        if ((operation == Request::GetOperation) && (replyTime.isValid())) {
+            addLatency(replyTime.elapsed());
+        }
+        
+        updateResponseCache();
+        updateResultCache();
         setStatus(Request::Ready);
         setError(Request::NoError);
         setErrorString(QString());
@@ -23,11 +23,22 @@
 
 class QUrl;
 class QString;
+class QStringList;
 class QNetworkAccessManager;
 
+namespace QtJson {
+
+class Document;
+
+}
+
 namespace QDailymotion {
 
 class RequestPrivate;
+class RequestScheduler;
+class ResponseCache;
+class TokenManager;
+class Session;
 
 class QDAILYMOTIONSHARED_EXPORT Request : public QObject
 {
@@ -37,6 +48,19 @@ class QDAILYMOTIONSHARED_EXPORT Request : public QObject
     Q_PROPERTY(QString clientSecret READ clientSecret WRITE setClientSecret NOTIFY clientSecretChanged)
     Q_PROPERTY(QString accessToken READ accessToken WRITE setAccessToken NOTIFY accessTokenChanged)
     Q_PROPERTY(QString refreshToken READ refreshToken WRITE setRefreshToken NOTIFY refreshTokenChanged)
+    Q_PROPERTY(bool lazyParsing READ lazyParsing WRITE setLazyParsing NOTIFY lazyParsingChanged)
+    Q_PROPERTY(bool backgroundParsing READ backgroundParsing WRITE setBackgroundParsing
+               NOTIFY backgroundParsingChanged)
+    Q_PROPERTY(int backgroundParsingThreshold READ backgroundParsingThreshold WRITE setBackgroundParsingThreshold
+               NOTIFY backgroundParsingThresholdChanged)
+    Q_PROPERTY(CachePolicy cachePolicy READ cachePolicy WRITE setCachePolicy NOTIFY cachePolicyChanged)
+    Q_PROPERTY(Priority priority READ priority WRITE setPriority NOTIFY priorityChanged)
+    Q_PROPERTY(int maximumAttempts READ maximumAttempts WRITE setMaximumAttempts NOTIFY maximumAttemptsChanged)
+    Q_PROPERTY(int retryDelay READ retryDelay WRITE setRetryDelay NOTIFY retryDelayChanged)
+    Q_PROPERTY(bool retryNonIdempotent READ retryNonIdempotent WRITE setRetryNonIdempotent
+               NOTIFY retryNonIdempotentChanged)
+    Q_PROPERTY(int deadline READ deadline WRITE setDeadline NOTIFY deadlineChanged)
+    Q_PROPERTY(bool hedging READ hedging WRITE setHedging NOTIFY hedgingChanged)
     Q_PROPERTY(QUrl url READ url NOTIFY urlChanged)
     Q_PROPERTY(QVariantMap headers READ headers NOTIFY headersChanged)
     Q_PROPERTY(QVariant data READ data NOTIFY dataChanged)
@@ -46,7 +70,7 @@ class QDAILYMOTIONSHARED_EXPORT Request : public QObject
     Q_PROPERTY(Error error READ error NOTIFY finished)
     Q_PROPERTY(QString errorString READ errorString NOTIFY finished)
     
-    Q_ENUMS(Operation Status Error)
+    Q_ENUMS(Operation Status Error CachePolicy Priority)
     
 public:
     enum Operation {
@@ -105,6 +129,20 @@ public:
         ParseError = 401
     };
     
+    enum CachePolicy {
+        UseCacheControl = 0,
+        NetworkOnly,
+        PreferCache,
+        CacheOnly,
+        Revalidate
+    };
+    
+    enum Priority {
+        InteractivePriority = 0,
+        PrefetchPriority,
+        BackgroundPriority
+    };
+    
     explicit Request(QObject *parent = 0);
     ~Request();
     
@@ -120,6 +158,36 @@ public:
     QString refreshToken() const;
     void setRefreshToken(const QString &token);
     
+    bool lazyParsing() const;
+    void setLazyParsing(bool enabled);
+    
+    bool backgroundParsing() const;
+    void setBackgroundParsing(bool enabled);
+    
+    int backgroundParsingThreshold() const;
+    void setBackgroundParsingThreshold(int bytes);
+    
+    CachePolicy cachePolicy() const;
+    void setCachePolicy(CachePolicy policy);
+    
+    Priority priority() const;
+    void setPriority(Priority priority);
+    
+    int maximumAttempts() const;
+    void setMaximumAttempts(int attempts);
+    
+    int retryDelay() const;
+    void setRetryDelay(int msecs);
+    
+    bool retryNonIdempotent() const;
+    void setRetryNonIdempotent(bool enabled);
+    
+    int deadline() const;
+    void setDeadline(int msecs);
+    
+    bool hedging() const;
+    void setHedging(bool enabled);
+    
     QUrl url() const;
     
     QVariantMap headers() const;
@@ -131,12 +199,25 @@ public:
     Status status() const;
     
     QVariant result() const;
+    QtJson::Document resultDocument() const;
     
     Error error() const;
     QString errorString() const;
     
     void setNetworkAccessManager(QNetworkAccessManager *manager);
     
+    ResponseCache* responseCache() const;
+    void setResponseCache(ResponseCache *cache);
+    
+    RequestScheduler* scheduler() const;
+    void setScheduler(RequestScheduler *scheduler);
+    
+    TokenManager* tokenManager() const;
+    void setTokenManager(TokenManager *manager);
+    
+    Session* session() const;
+    void setSession(Session *session);
+    
 public Q_SLOTS:
     void cancel();
     
@@ -144,6 +225,7 @@ protected:
     void setUrl(const QUrl &url);
     void setHeaders(const QVariantMap &headers);
     void setData(const QVariant &data);
+    void setProjection(const QStringList &paths);
     
 protected Q_SLOTS:
     void head(bool authRequired = true);
@@ -157,6 +239,16 @@ Q_SIGNALS:
     void clientSecretChanged();
     void accessTokenChanged(const QString &token);
     void refreshTokenChanged(const QString &token);
+    void lazyParsingChanged();
+    void backgroundParsingChanged();
+    void backgroundParsingThresholdChanged();
+    void cachePolicyChanged();
+    void priorityChanged();
+    void maximumAttemptsChanged();
+    void retryDelayChanged();
+    void retryNonIdempotentChanged();
+    void deadlineChanged();
+    void hedgingChanged();
     void urlChanged();
     void dataChanged();
     void headersChanged();
@@ -172,7 +264,17 @@ protected:
     Q_DECLARE_PRIVATE(Request)
     
     Q_PRIVATE_SLOT(d_func(), void _q_onAccessTokenRefreshed())
+    Q_PRIVATE_SLOT(d_func(), void _q_onTokenRefreshed(int, QString))
+    Q_PRIVATE_SLOT(d_func(), void _q_onReplyReadyRead())
     Q_PRIVATE_SLOT(d_func(), void _q_onReplyFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_onParseFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_onCacheHit())
+    Q_PRIVATE_SLOT(d_func(), void _q_onSharedGetFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_onScheduled())
+    Q_PRIVATE_SLOT(d_func(), void _q_onRetryTimeout())
+    Q_PRIVATE_SLOT(d_func(), void _q_onDeadlineExpired())
+    Q_PRIVATE_SLOT(d_func(), void _q_onHedgeTimeout())
+    Q_PRIVATE_SLOT(d_func(), void _q_onHedgeFinished())
     
 private:
     Q_DISABLE_COPY(Request)
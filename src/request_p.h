@@ -18,23 +18,52 @@
 #define QDAILYMOTION_REQUEST_P_H
 
 #include "request.h"
+#include "responsecache_p.h"
+#include "session.h"
 #include "json.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QLocale>
+#include <QPointer>
+#include <QTimer>
 #include <QUrl>
 #include <QVariantMap>
 #include <QNetworkRequest>
+#include <QNetworkReply>
 #if QT_VERSION >= 0x050000
 #include <QUrlQuery>
 #endif
+#ifndef QT_NO_CONCURRENT
+#include <QFutureWatcher>
+#endif
 #ifdef QDAILYMOTION_DEBUG
 #include <QDebug>
 #endif
 
-class QNetworkReply;
-
 namespace QDailymotion {
 
 static const int MAX_REDIRECTS = 8;
 
+static const int MAX_ATTEMPTS = 1;
+
+static const int RETRY_DELAY = 1000;
+
+static const int MAX_RETRY_DELAY = 30000;
+
+static const int BACKGROUND_PARSING_THRESHOLD = 64 * 1024;
+
+/*!
+    \brief The parsed response, which may be produced in a worker thread.
+*/
+struct ParseResult
+{
+    ParseResult() : ok(true) {}
+    
+    QVariant result;
+    QtJson::Document document;
+    bool ok;
+};
+
 #if QT_VERSION >= 0x050000
 inline void addUrlQueryItems(QUrlQuery *query, const QVariantMap &map) {
 #ifdef QDAILYMOTION_DEBUG
@@ -51,7 +80,7 @@ inline void addUrlQueryItems(QUrlQuery *query, const QVariantMap &map) {
             query->addQueryItem(iterator.key(), iterator.value().toString());
             break;
         default:
-            query->addQueryItem(iterator.key(), QtJson::Json::serialize(iterator.value()));
+            query->addQueryItem(iterator.key(), QtJson::Json::serialize(iterator.value(), QtJson::Writer::Compact));
             break;
         }
     }
@@ -72,7 +101,7 @@ inline void addUrlQueryItems(QUrl *url, const QVariantMap &map) {
             url->addQueryItem(iterator.key(), iterator.value().toString());
             break;
         default:
-            url->addQueryItem(iterator.key(), QtJson::Json::serialize(iterator.value()));
+            url->addQueryItem(iterator.key(), QtJson::Json::serialize(iterator.value(), QtJson::Writer::Compact));
             break;
         }
     }
@@ -94,12 +123,38 @@ inline void addRequestHeaders(QNetworkRequest *request, const QVariantMap &map)
             request->setRawHeader(iterator.key().toUtf8(), iterator.value().toByteArray());
             break;
         default:
-            request->setRawHeader(iterator.key().toUtf8(), QtJson::Json::serialize(iterator.value()));
+            request->setRawHeader(iterator.key().toUtf8(), QtJson::Json::serialize(iterator.value(), QtJson::Writer::Compact));
             break;
         }
     }
 }
 
+// Returns the delay in milliseconds requested by the Retry-After header of reply, or -1 if there is none
+inline qint64 retryAfter(const QNetworkReply *reply) {
+    const QByteArray value = reply->rawHeader("Retry-After").trimmed();
+    
+    if (value.isEmpty()) {
+        return -1;
+    }
+    
+    bool ok;
+    const qint64 secs = value.toLongLong(&ok);
+    
+    if (ok) {
+        return qMax(Q_INT64_C(0), secs) * 1000;
+    }
+    
+    // The header can also be a HTTP date
+    QDateTime date = QLocale::c().toDateTime(QString::fromLatin1(value), "ddd, dd MMM yyyy hh:mm:ss 'GMT'");
+    
+    if (!date.isValid()) {
+        return -1;
+    }
+    
+    date.setTimeSpec(Qt::UTC);
+    return qMax(Q_INT64_C(0), qint64(QDateTime::currentDateTimeUtc().secsTo(date)) * 1000);
+}
+
 inline void addPostBody(QString *body, const QVariantMap &map) {
 #ifdef QDAILYMOTION_DEBUG
     qDebug() << "addPostBody:" << body << map;
@@ -115,7 +170,7 @@ inline void addPostBody(QString *body, const QVariantMap &map) {
             body->append(iterator.key() + "=" + iterator.value().toString());
             break;
         default:
-            body->append(iterator.key() + "=" + QtJson::Json::serialize(iterator.value()));
+            body->append(iterator.key() + "=" + QtJson::Json::serialize(iterator.value(), QtJson::Writer::Compact));
             break;
         }
         
@@ -134,6 +189,47 @@ public:
     
     QNetworkAccessManager* networkAccessManager();
     
+    int maximumRedirects() const;
+    
+    ResponseCache* responseCache() const;
+    QByteArray responseCacheKey() const;
+    
+    bool loadFromCache();
+    void updateResponseCache();
+    virtual QStringList changedUrlPaths() const;
+    
+    bool loadFromResultCache(const QString &key);
+    void updateResultCache();
+    
+    QObject* credentialsHolder() const;
+    void disconnectCredentials();
+    void connectCredentials();
+    void emitCredentialChanges(const QString &id, const QString &secret, const QString &token,
+                               const QString &refresh);
+    void emitPolicyChanges(int attempts, int delay, bool nonIdempotent, int msecs, bool hedge);
+    
+    void configure(Request *request, QNetworkAccessManager *requestManager);
+    
+    RequestScheduler* requestScheduler() const;
+    TokenManager* requestTokenManager() const;
+    
+    void sendRequest(bool authRequired, const QByteArray &body = QByteArray());
+    void startReply();
+    bool leaveScheduler();
+    
+    bool waitForToken(bool refused);
+    bool leaveTokenManager();
+    
+    bool startRetry();
+    
+    void startDeadline();
+    bool cancelHedge();
+    
+    QByteArray sharedGetKey(bool authRequired);
+    QNetworkAccessManager* sharedGetManager();
+    bool startSharedGet(bool authRequired);
+    bool leaveSharedGet();
+    
     void setOperation(Request::Operation op);
     
     void setStatus(Request::Status s);
@@ -142,26 +238,169 @@ public:
     
     void setErrorString(const QString &es);
     
+    void setDocument(const QtJson::Document &doc);
+    
     void setResult(const QVariant &res);
     
+    bool setParseResult(const ParseResult &res);
+    
+    void resetParsing();
+    
     virtual QNetworkRequest buildRequest(bool authRequired = true);
     virtual QNetworkRequest buildRequest(QUrl u, bool authRequired = true);
     
     virtual void followRedirect(const QUrl &redirect);
+    
+    QUrl redirectUrl() const;
         
     void refreshAccessToken();
     void _q_onAccessTokenRefreshed();
+    void _q_onTokenRefreshed(int e, const QString &es);
+    
+    virtual bool cancelPending();
+    virtual void cancelCalls();
     
+    virtual void _q_onReplyReadyRead();
     virtual void _q_onReplyFinished();
     
+    void _q_onParseFinished();
+    
+    void _q_onCacheHit();
+    
+    void _q_onSharedGetFinished();
+    
+    void _q_onScheduled();
+    
+    void _q_onRetryTimeout();
+    
+    void _q_onDeadlineExpired();
+    
+    void _q_onHedgeTimeout();
+    void _q_onHedgeFinished();
+    
+    void completeReply(bool ok);
+    
     Request *q_ptr;
     
     QNetworkAccessManager *manager;
     
-    QNetworkReply *reply;
+    QPointer<Session> session;
+    
+    // Guarded, since the reply is deleted with a manager that is not owned by the request
+    QPointer<QNetworkReply> reply;
+    
+    QtJson::Parser parser;
+    
+    QByteArray buffer;
+    
+    QtJson::Document document;
+    
+    // The result decoded from the document, once it has been read
+    mutable QVariant documentResult;
+    mutable bool documentDecoded;
+    
+    QPointer<ResponseCache> cache;
+    
+    Request::CachePolicy cachePolicy;
+    
+    // The key and entry of the cached response to the current GET, and the cache headers of its reply
+    QByteArray cacheKey;
+    CacheEntry cacheEntry;
+    CacheEntry replyCacheEntry;
+    
+    bool cacheHit;
+    
+    // The ResultCache key of the current list or get, and the resource paths changed by the current write
+    QString resultCacheKey;
+    QStringList resultCachePaths;
+    
+    // Whether an identical GET that is in flight is shared rather than made again
+    bool shareGets;
+    
+    // The shared GET that this request is waiting for
+    QPointer<Request> sharedGet;
+    
+    // The key of this shared GET, and the requests waiting for it
+    QByteArray sharedKey;
+    QList< QPointer<Request> > sharers;
+    
+    QPointer<RequestScheduler> scheduler;
+    
+    // The scheduler that the current operation is waiting for or counted by
+    QPointer<RequestScheduler> activeScheduler;
+    
+    bool waitingForScheduler;
+    
+    Request::Priority priority;
+    
+    // The HTTP request to be sent once the scheduler allows it
+    bool sendAuthRequired;
+    QByteArray sendBody;
+    
+    int maximumAttempts;
+    
+    int retryDelay;
+    
+    bool retryNonIdempotent;
+    
+    // The number of attempts made by the current operation
+    int attempts;
+    
+    // The delay requested by the Retry-After header of the last reply, or -1
+    qint64 replyRetryAfter;
+    
+    QTimer *retryTimer;
+    
+    int deadline;
+    
+    bool hedging;
+    
+    bool keepDeadline;
+    
+    QTimer *deadlineTimer;
+    QTimer *hedgeTimer;
+    
+    // The second attempt of a hedged GET, and whether the first attempt has failed and is waiting for it
+    QPointer<Request> hedge;
+    bool waitingForHedge;
+    
+    // Whether this request is itself a hedged GET, which is never hedged again
+    bool isHedge;
+    
+    // Whether GETs can be hedged with a plain Request, which is not the case for requests that handle their 
+    // replies differently
+    bool hedgeGets;
+    
+    // When the current reply was started
+    QElapsedTimer replyTime;
+    
+    QPointer<TokenManager> tokenManager;
+    
+    // The token manager that the current operation is waiting for
+    QPointer<TokenManager> activeTokenManager;
+    
+    bool waitingForToken;
+    
+    // The access token sent with the current reply, and whether the current operation has refreshed it
+    QString sentAccessToken;
+    bool tokenRefreshed;
     
     bool ownNetworkAccessManager;
     
+    bool lazyParsing;
+    
+    bool backgroundParsing;
+    
+    int backgroundParsingThreshold;
+#ifndef QT_NO_CONCURRENT
+    QFutureWatcher<ParseResult> *parseWatcher;
+#endif
+    QNetworkReply::NetworkError replyError;
+    
+    int replyStatusCode;
+    
+    QString replyErrorString;
+    
     QString apiKey;
     QString clientId;
     QString clientSecret;
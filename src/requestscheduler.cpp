@@ -0,0 +1,487 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "requestscheduler.h"
+#include "request_p.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QTimer>
+#include <qmath.h>
+#ifdef QDAILYMOTION_DEBUG
+#include <QDebug>
+#endif
+
+namespace QDailymotion {
+
+static const int BURST = 10;
+
+static const int MAX_HOST_REQUESTS = 6;
+
+static const int PRIORITY_COUNT = 3;
+
+// The number of requests that a rate-limit header allows, read from the prefixed or the standard header
+static QByteArray rateLimitHeader(const QNetworkReply *reply, const QByteArray &name) {
+    const QByteArray value = reply->rawHeader("X-RateLimit-" + name);
+    return value.isEmpty() ? reply->rawHeader("RateLimit-" + name) : value;
+}
+
+struct ScheduledRequest
+{
+    QPointer<Request> request;
+    QString host;
+};
+
+class RequestSchedulerPrivate
+{
+
+public:
+    RequestSchedulerPrivate(RequestScheduler *parent) :
+        q_ptr(parent),
+        rate(0.0),
+        burst(BURST),
+        maximumHostRequests(MAX_HOST_REQUESTS),
+        adaptive(true),
+        tokens(BURST),
+        lastRefill(0),
+        limitRate(0.0),
+        limitUntil(0),
+        pausedUntil(0)
+    {
+        clock.start();
+        timer.setSingleShot(true);
+    }
+    
+    // The rate allowed by the server takes precedence while it applies
+    qreal effectiveRate(qint64 now) const {
+        if ((adaptive) && (limitRate > 0.0) && (now < limitUntil)) {
+            return rate > 0.0 ? qMin(rate, limitRate) : limitRate;
+        }
+        
+        return rate;
+    }
+    
+    void refill(qint64 now) {
+        const qreal r = effectiveRate(now);
+        
+        if (r > 0.0) {
+            tokens = qMin(qreal(burst), tokens + (now - lastRefill) * r / 1000);
+        }
+        else {
+            tokens = burst;
+        }
+        
+        lastRefill = now;
+    }
+    
+    void startTimer(qint64 msecs) {
+        if ((!timer.isActive()) || (timer.interval() > msecs)) {
+            timer.start(int(qMax(Q_INT64_C(1), msecs)));
+        }
+    }
+    
+    // Requests of lower priority leave one request per host for interactive requests
+    int hostLimit(int priority) const {
+        return priority == Request::InteractivePriority ? maximumHostRequests : qMax(1, maximumHostRequests - 1);
+    }
+    
+    void _q_schedule() {
+        const qint64 now = clock.elapsed();
+        refill(now);
+        
+        if (now < pausedUntil) {
+            startTimer(pausedUntil - now);
+            return;
+        }
+        
+        const qreal r = effectiveRate(now);
+        
+        for (int priority = 0; priority < PRIORITY_COUNT; priority++) {
+            QList<ScheduledRequest> &queue = queues[priority];
+            const int limit = hostLimit(priority);
+            int i = 0;
+            
+            while (i < queue.size()) {
+                if (!queue.at(i).request) {
+                    queue.removeAt(i);
+                    continue;
+                }
+                
+                if ((r > 0.0) && (tokens < 1.0)) {
+                    startTimer(qCeil((1.0 - tokens) * 1000 / r));
+                    return;
+                }
+                
+                // Requests to a host that is busy wait, but do not hold up requests to other hosts
+                if (active.value(queue.at(i).host) >= limit) {
+                    i++;
+                    continue;
+                }
+                
+                const ScheduledRequest scheduled = queue.takeAt(i);
+                
+                if (r > 0.0) {
+                    tokens -= 1.0;
+                }
+                
+                running.insert(scheduled.request, scheduled.host);
+                active[scheduled.host]++;
+                QMetaObject::invokeMethod(scheduled.request, "_q_onScheduled", Qt::QueuedConnection);
+            }
+        }
+    }
+    
+    RequestScheduler *q_ptr;
+    
+    qreal rate;
+    
+    int burst;
+    
+    int maximumHostRequests;
+    
+    bool adaptive;
+    
+    QElapsedTimer clock;
+    
+    QTimer timer;
+    
+    qreal tokens;
+    qint64 lastRefill;
+    
+    // The rate allowed by the rate-limit headers of the last response, and when it ends
+    qreal limitRate;
+    qint64 limitUntil;
+    
+    // When requests can be sent again after the server has refused them
+    qint64 pausedUntil;
+    
+    QList<ScheduledRequest> queues[PRIORITY_COUNT];
+    
+    QHash<Request*, QString> running;
+    QHash<QString, int> active;
+    
+    Q_DECLARE_PUBLIC(RequestScheduler)
+};
+
+/*!
+    \class RequestScheduler
+    \brief Paces the requests made to the Dailymotion Data API.
+    
+    \ingroup requests
+    
+    Requests that use a RequestScheduler wait for it before sending each HTTP request. The scheduler sends at most 
+    rate requests per second, allowing bursts of up to burst requests, and at most maximumHostRequests requests to 
+    each host at the same time.
+    
+    Waiting requests are sent in order of their Request::priority. An interactive request is sent before any 
+    waiting prefetch or background request, and requests of lower priority leave one request per host free, so 
+    that an interactive request does not wait for background work to finish.
+    
+    When the scheduler is adaptive, it reads the X-RateLimit-Remaining and X-RateLimit-Reset headers of each 
+    response (or RateLimit-Remaining and RateLimit-Reset), and lowers its rate to the one that the server allows 
+    until the limit is reset. When the remaining requests run out, or a response has status 429 or 503 and a 
+    Retry-After header, no requests are sent until the server accepts them again.
+    
+    The requests of a scheduler are counted from when they are sent until they finish. Responses served from a 
+    ResponseCache or a ResultCache do not wait for the scheduler.
+    
+    Example usage:
+    
+    \code
+    using namespace QDailymotion;
+    
+    ...
+    
+    RequestScheduler *scheduler = new RequestScheduler(this);
+    scheduler->setRate(5);
+    scheduler->setBurst(10);
+    session->setScheduler(scheduler);
+    
+    ResourcesRequest *request = new ResourcesRequest(this);
+    request->setSession(session);
+    request->setPriority(Request::BackgroundPriority);
+    request->list("/videos");
+    \endcode
+    
+    \sa Request::priority, Session::setScheduler()
+*/
+RequestScheduler::RequestScheduler(QObject *parent) :
+    QObject(parent),
+    d_ptr(new RequestSchedulerPrivate(this))
+{
+    Q_D(RequestScheduler);
+    
+    connect(&d->timer, SIGNAL(timeout()), this, SLOT(_q_schedule()));
+}
+
+RequestScheduler::~RequestScheduler() {
+    Q_D(RequestScheduler);
+    
+    // Waiting requests are sent without the scheduler
+    for (int priority = 0; priority < PRIORITY_COUNT; priority++) {
+        foreach (const ScheduledRequest &scheduled, d->queues[priority]) {
+            if (scheduled.request) {
+                QMetaObject::invokeMethod(scheduled.request, "_q_onScheduled", Qt::QueuedConnection);
+            }
+        }
+    }
+}
+
+/*!
+    \property qreal RequestScheduler::rate
+    \brief The maximum number of requests that are sent per second.
+    
+    The default value is 0, meaning that the rate is only limited by the rate-limit headers of the server.
+*/
+
+/*!
+    \fn void RequestScheduler::rateChanged()
+    \brief Emitted when the rate changes.
+*/
+qreal RequestScheduler::rate() const {
+    Q_D(const RequestScheduler);
+    
+    return d->rate;
+}
+
+void RequestScheduler::setRate(qreal rate) {
+    Q_D(RequestScheduler);
+    
+    rate = qMax(qreal(0.0), rate);
+    
+    if (rate != d->rate) {
+        d->refill(d->clock.elapsed());
+        d->rate = rate;
+        emit rateChanged();
+        d->_q_schedule();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::RequestScheduler::setRate" << rate;
+#endif
+}
+
+/*!
+    \property int RequestScheduler::burst
+    \brief The maximum number of requests that are sent at once after the scheduler has been idle.
+    
+    The default value is 10.
+*/
+
+/*!
+    \fn void RequestScheduler::burstChanged()
+    \brief Emitted when the burst changes.
+*/
+int RequestScheduler::burst() const {
+    Q_D(const RequestScheduler);
+    
+    return d->burst;
+}
+
+void RequestScheduler::setBurst(int burst) {
+    Q_D(RequestScheduler);
+    
+    burst = qMax(1, burst);
+    
+    if (burst != d->burst) {
+        d->burst = burst;
+        d->tokens = qMin(d->tokens, qreal(burst));
+        emit burstChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::RequestScheduler::setBurst" << burst;
+#endif
+}
+
+/*!
+    \property int RequestScheduler::maximumHostRequests
+    \brief The maximum number of requests that are sent to each host at the same time.
+    
+    The default value is 6.
+*/
+
+/*!
+    \fn void RequestScheduler::maximumHostRequestsChanged()
+    \brief Emitted when maximumHostRequests changes.
+*/
+int RequestScheduler::maximumHostRequests() const {
+    Q_D(const RequestScheduler);
+    
+    return d->maximumHostRequests;
+}
+
+void RequestScheduler::setMaximumHostRequests(int requests) {
+    Q_D(RequestScheduler);
+    
+    requests = qMax(1, requests);
+    
+    if (requests != d->maximumHostRequests) {
+        d->maximumHostRequests = requests;
+        emit maximumHostRequestsChanged();
+        d->_q_schedule();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::RequestScheduler::setMaximumHostRequests" << requests;
+#endif
+}
+
+/*!
+    \property bool RequestScheduler::adaptive
+    \brief Whether the rate is adapted to the rate-limit headers of responses.
+    
+    The default value is true.
+*/
+
+/*!
+    \fn void RequestScheduler::adaptiveChanged()
+    \brief Emitted when adaptive changes.
+*/
+bool RequestScheduler::isAdaptive() const {
+    Q_D(const RequestScheduler);
+    
+    return d->adaptive;
+}
+
+void RequestScheduler::setAdaptive(bool enabled) {
+    Q_D(RequestScheduler);
+    
+    if (enabled != d->adaptive) {
+        d->adaptive = enabled;
+        
+        if (!enabled) {
+            d->limitRate = 0.0;
+            d->limitUntil = 0;
+            d->pausedUntil = 0;
+        }
+        
+        emit adaptiveChanged();
+        d->_q_schedule();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::RequestScheduler::setAdaptive" << enabled;
+#endif
+}
+
+/*!
+    \property int RequestScheduler::queued
+    \brief The number of requests that are waiting to be sent.
+*/
+int RequestScheduler::queued() const {
+    Q_D(const RequestScheduler);
+    
+    int count = 0;
+    
+    for (int priority = 0; priority < PRIORITY_COUNT; priority++) {
+        count += d->queues[priority].size();
+    }
+    
+    return count;
+}
+
+// Adds request to the queue of its priority. The request is sent in its _q_onScheduled() slot.
+void RequestScheduler::enqueue(Request *request) {
+    Q_D(RequestScheduler);
+    
+    ScheduledRequest scheduled;
+    scheduled.request = request;
+    scheduled.host = request->url().host();
+    d->queues[qBound(0, int(request->priority()), PRIORITY_COUNT - 1)].append(scheduled);
+    d->_q_schedule();
+}
+
+// Removes request from the queue, or counts it as finished if it has been sent
+void RequestScheduler::remove(Request *request) {
+    Q_D(RequestScheduler);
+    
+    if (d->running.contains(request)) {
+        const QString host = d->running.take(request);
+        
+        if (--d->active[host] <= 0) {
+            d->active.remove(host);
+        }
+    }
+    else {
+        for (int priority = 0; priority < PRIORITY_COUNT; priority++) {
+            QList<ScheduledRequest> &queue = d->queues[priority];
+            
+            for (int i = queue.size() - 1; i >= 0; i--) {
+                if ((!queue.at(i).request) || (queue.at(i).request == request)) {
+                    queue.removeAt(i);
+                }
+            }
+        }
+    }
+    
+    d->_q_schedule();
+}
+
+// Adapts the rate to the rate-limit headers of reply
+void RequestScheduler::updateRateLimit(const QNetworkReply *reply) {
+    Q_D(RequestScheduler);
+    
+    if (!d->adaptive) {
+        return;
+    }
+    
+    const qint64 now = d->clock.elapsed();
+    bool remainingOk;
+    bool resetOk;
+    const qint64 remaining = rateLimitHeader(reply, "Remaining").trimmed().toLongLong(&remainingOk);
+    qint64 reset = rateLimitHeader(reply, "Reset").trimmed().toLongLong(&resetOk);
+    
+    if ((remainingOk) && (resetOk)) {
+        // The reset is either a number of seconds, or a time in seconds since the epoch
+        const qint64 currentTime = QDateTime::currentDateTimeUtc().toTime_t();
+        
+        if (reset > currentTime) {
+            reset -= currentTime;
+        }
+        
+        reset = qMax(Q_INT64_C(1), reset);
+        d->refill(now);
+        
+        if (remaining <= 0) {
+            d->pausedUntil = now + reset * 1000;
+        }
+        else {
+            d->limitRate = qreal(remaining) / reset;
+            d->limitUntil = now + reset * 1000;
+        }
+#ifdef QDAILYMOTION_DEBUG
+        qDebug() << "QDailymotion::RequestScheduler::updateRateLimit" << remaining << reset;
+#endif
+    }
+    
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    
+    if ((status == 429) || (status == 503)) {
+        qint64 delay = retryAfter(reply);
+        
+        // Too many requests have been sent, even if the server does not say for how long to wait
+        if ((delay < 0) && (status == 429)) {
+            delay = 1000;
+        }
+        
+        if (delay >= 0) {
+            d->pausedUntil = qMax(d->pausedUntil, now + delay);
+#ifdef QDAILYMOTION_DEBUG
+            qDebug() << "QDailymotion::RequestScheduler::updateRateLimit: Paused for" << delay << "ms";
+#endif
+        }
+    }
+}
+
+}
+
+#include "moc_requestscheduler.cpp"
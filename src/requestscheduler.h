@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QDAILYMOTION_REQUESTSCHEDULER_H
+#define QDAILYMOTION_REQUESTSCHEDULER_H
+
+#include "qdailymotion_global.h"
+#include <QObject>
+
+class QNetworkReply;
+
+namespace QDailymotion {
+
+class Request;
+class RequestSchedulerPrivate;
+
+class QDAILYMOTIONSHARED_EXPORT RequestScheduler : public QObject
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(qreal rate READ rate WRITE setRate NOTIFY rateChanged)
+    Q_PROPERTY(int burst READ burst WRITE setBurst NOTIFY burstChanged)
+    Q_PROPERTY(int maximumHostRequests READ maximumHostRequests WRITE setMaximumHostRequests
+               NOTIFY maximumHostRequestsChanged)
+    Q_PROPERTY(bool adaptive READ isAdaptive WRITE setAdaptive NOTIFY adaptiveChanged)
+    Q_PROPERTY(int queued READ queued)
+    
+public:
+    explicit RequestScheduler(QObject *parent = 0);
+    ~RequestScheduler();
+    
+    qreal rate() const;
+    void setRate(qreal rate);
+    
+    int burst() const;
+    void setBurst(int burst);
+    
+    int maximumHostRequests() const;
+    void setMaximumHostRequests(int requests);
+    
+    bool isAdaptive() const;
+    void setAdaptive(bool enabled);
+    
+    int queued() const;
+    
+Q_SIGNALS:
+    void rateChanged();
+    void burstChanged();
+    void maximumHostRequestsChanged();
+    void adaptiveChanged();
+    
+protected:
+    QScopedPointer<RequestSchedulerPrivate> d_ptr;
+    
+    Q_DECLARE_PRIVATE(RequestScheduler)
+    
+    Q_PRIVATE_SLOT(d_func(), void _q_schedule())
+    
+private:
+    void enqueue(Request *request);
+    void remove(Request *request);
+    void updateRateLimit(const QNetworkReply *reply);
+    
+    friend class RequestPrivate;
+    
+    Q_DISABLE_COPY(RequestScheduler)
+};
+
+}
+
+#endif // QDAILYMOTION_REQUESTSCHEDULER_H
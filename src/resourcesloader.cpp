@@ -0,0 +1,384 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resourcesloader.h"
+#include "resourcesrequest_p.h"
+#include <QSet>
+#include <QTimer>
+#ifdef QDAILYMOTION_DEBUG
+#include <QDebug>
+#endif
+
+namespace QDailymotion {
+
+// The maximum number of ids accepted by the ids filter of the Data API
+static const int MAX_BATCH_SIZE = 100;
+
+// A get() that is waiting for its resource
+struct PendingLoad
+{
+    PendingLoad() : loadId(0) {}
+    PendingLoad(ResourcesRequest *r, int l, const QString &i) : request(r), loadId(l), id(i) {}
+    
+    QPointer<ResourcesRequest> request;
+    int loadId;
+    QString id;
+};
+
+// The gets of resources of one type with the same fields
+struct LoadBatch
+{
+    QString resourcePath;
+    QStringList fields;
+    QList<PendingLoad> loads;
+};
+
+class ResourcesLoaderPrivate
+{
+
+public:
+    ResourcesLoaderPrivate(ResourcesLoader *parent) :
+        q_ptr(parent),
+        request(new ResourcesRequest(parent)),
+        delay(0),
+        maximumBatchSize(MAX_BATCH_SIZE),
+        nextLoadId(1)
+    {
+        timer.setSingleShot(true);
+    }
+    
+    // Returns the path of the list of resources of the type of resourcePath, or an empty string
+    static QString listPath(const QString &resourcePath, QString *id) {
+        const QStringList parts = resourcePath.split("/", QString::SkipEmptyParts);
+        
+        if ((parts.size() == 2) && ((parts.first() == "video") || (parts.first() == "user")
+                                    || (parts.first() == "playlist"))) {
+            *id = parts.last();
+            return "/" + parts.first() + "s";
+        }
+        
+        return QString();
+    }
+    
+    void cancel() {
+        QList<PendingLoad> loads;
+        
+        foreach (const LoadBatch &batch, batches) {
+            loads << batch.loads;
+        }
+        
+        foreach (const LoadBatch &batch, calls) {
+            loads << batch.loads;
+        }
+        
+        batches.clear();
+        calls.clear();
+        
+        foreach (const PendingLoad &load, loads) {
+            if (load.request) {
+                load.request->d_func()->completeLoad(load.loadId, Request::Canceled, QVariant(), Request::NoError,
+                                                     QString());
+            }
+        }
+    }
+    
+    void _q_onTimeout() {
+        foreach (const LoadBatch &batch, batches) {
+            QStringList ids;
+            QSet<QString> unique;
+            
+            foreach (const PendingLoad &load, batch.loads) {
+                if (!unique.contains(load.id)) {
+                    unique.insert(load.id);
+                    ids << load.id;
+                }
+            }
+            
+            // The ids are needed to match the resources with the gets
+            QStringList fields = batch.fields;
+            
+            if ((!fields.isEmpty()) && (!fields.contains("id"))) {
+                fields << "id";
+            }
+            
+            for (int i = 0; i < ids.size(); i += maximumBatchSize) {
+                const QStringList chunk = ids.mid(i, maximumBatchSize);
+                const QSet<QString> chunkIds = chunk.toSet();
+                LoadBatch call;
+                call.resourcePath = batch.resourcePath;
+                call.fields = batch.fields;
+                
+                foreach (const PendingLoad &load, batch.loads) {
+                    if (chunkIds.contains(load.id)) {
+                        call.loads << load;
+                    }
+                }
+                
+                QVariantMap filters;
+                filters["ids"] = chunk.join(",");
+                filters["limit"] = chunk.size();
+                calls.insert(request->startList(batch.resourcePath, filters, fields), call);
+            }
+        }
+        
+        batches.clear();
+    }
+    
+    void _q_onCallFinished(int id) {
+        if (!calls.contains(id)) {
+            return;
+        }
+        
+        const LoadBatch call = calls.take(id);
+        const Request::Status status = request->callStatus(id);
+        const Request::Error error = request->callError(id);
+        const QString errorString = request->callErrorString(id);
+        const bool removeId = (!call.fields.isEmpty()) && (!call.fields.contains("id"));
+        QHash<QString, QVariantMap> items;
+        
+        if (status == Request::Ready) {
+            foreach (const QVariant &item, request->callResult(id).toMap().value("list").toList()) {
+                QVariantMap map = item.toMap();
+                const QString itemId = map.value("id").toString();
+                
+                if (removeId) {
+                    map.remove("id");
+                }
+                
+                items.insert(itemId, map);
+            }
+        }
+        
+        foreach (const PendingLoad &load, call.loads) {
+            if (!load.request) {
+                continue;
+            }
+            
+            ResourcesRequestPrivate *rd = load.request->d_func();
+            
+            if (status != Request::Ready) {
+                rd->completeLoad(load.loadId, status, QVariant(), error, errorString);
+            }
+            else if (items.contains(load.id)) {
+                rd->completeLoad(load.loadId, Request::Ready, items.value(load.id), Request::NoError, QString());
+            }
+            else {
+                // Resources that do not exist are omitted from the list
+                rd->completeLoad(load.loadId, Request::Failed, QVariant(), Request::ContentNotFoundError,
+                                 ResourcesLoader::tr("Resource not found"));
+            }
+        }
+    }
+    
+    ResourcesLoader *q_ptr;
+    
+    ResourcesRequest *request;
+    
+    QTimer timer;
+    
+    int delay;
+    
+    int maximumBatchSize;
+    
+    int nextLoadId;
+    
+    QMap<QString, LoadBatch> batches;
+    
+    QHash<int, LoadBatch> calls;
+    
+    Q_DECLARE_PUBLIC(ResourcesLoader)
+};
+
+/*!
+    \class ResourcesLoader
+    \brief Gathers requests for single Dailymotion resources into list calls.
+    
+    \ingroup requests
+    
+    When many requests retrieve single resources at the same time, for example when each delegate of a view 
+    retrieves the details of its video, each of them makes its own HTTP request. When the requests use a 
+    ResourcesLoader, calls to ResourcesRequest::get() for videos, users and playlists are instead gathered 
+    by the loader until control returns to the event loop, or until delay has elapsed. The loader then makes 
+    one list call for each type of resource and set of fields, using the ids filter, and each request is 
+    finished with its own resource. A request for a resource that does not exist fails with 
+    ResourcesRequest::ContentNotFoundError.
+    
+    Only requests with the same session and access token as the loader are gathered. Calls to 
+    ResourcesRequest::get() with filters or a projection are made as usual.
+    
+    Example usage:
+    
+    \code
+    using namespace QDailymotion;
+    
+    ...
+    
+    ResourcesLoader *loader = new ResourcesLoader(this);
+    loader->setSession(session);
+    
+    ...
+    
+    ResourcesRequest *request = new ResourcesRequest(this);
+    request->setSession(session);
+    request->setLoader(loader);
+    request->get("/video/VIDEO_ID", QVariantMap(), QStringList() << "id" << "title" << "duration");
+    \endcode
+    
+    \sa ResourcesRequest::setLoader()
+*/
+ResourcesLoader::ResourcesLoader(QObject *parent) :
+    QObject(parent),
+    d_ptr(new ResourcesLoaderPrivate(this))
+{
+    Q_D(ResourcesLoader);
+    
+    connect(&d->timer, SIGNAL(timeout()), this, SLOT(_q_onTimeout()));
+    connect(d->request, SIGNAL(callFinished(int)), this, SLOT(_q_onCallFinished(int)));
+}
+
+ResourcesLoader::~ResourcesLoader() {
+    Q_D(ResourcesLoader);
+    
+    // The requests waiting for the loader are finished, so that none of them is left loading
+    d->cancel();
+}
+
+/*!
+    \property int ResourcesLoader::delay
+    \brief The time in milliseconds for which gets are gathered before the list calls are made.
+    
+    The default value is 0, meaning that the gets made before control returns to the event loop are gathered.
+*/
+
+/*!
+    \fn void ResourcesLoader::delayChanged()
+    \brief Emitted when the delay changes.
+*/
+int ResourcesLoader::delay() const {
+    Q_D(const ResourcesLoader);
+    
+    return d->delay;
+}
+
+void ResourcesLoader::setDelay(int msecs) {
+    Q_D(ResourcesLoader);
+    
+    if (msecs != d->delay) {
+        d->delay = qMax(0, msecs);
+        emit delayChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResourcesLoader::setDelay" << msecs;
+#endif
+}
+
+/*!
+    \property int ResourcesLoader::maximumBatchSize
+    \brief The maximum number of resources retrieved by each list call.
+    
+    The default and maximum value is 100, which is the maximum number of ids accepted by the Data API.
+*/
+
+/*!
+    \fn void ResourcesLoader::maximumBatchSizeChanged()
+    \brief Emitted when the maximumBatchSize changes.
+*/
+int ResourcesLoader::maximumBatchSize() const {
+    Q_D(const ResourcesLoader);
+    
+    return d->maximumBatchSize;
+}
+
+void ResourcesLoader::setMaximumBatchSize(int size) {
+    Q_D(ResourcesLoader);
+    
+    size = qBound(1, size, MAX_BATCH_SIZE);
+    
+    if (size != d->maximumBatchSize) {
+        d->maximumBatchSize = size;
+        emit maximumBatchSizeChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResourcesLoader::setMaximumBatchSize" << size;
+#endif
+}
+
+/*!
+    \brief Returns the Session used to make the list calls, or 0 if the loader is not attached to a session.
+    
+    \sa setSession()
+*/
+Session* ResourcesLoader::session() const {
+    Q_D(const ResourcesLoader);
+    
+    return d->request->session();
+}
+
+/*!
+    \brief Attaches the loader to \a session.
+    
+    The list calls are made with the session, and only requests attached to the same session are gathered.
+    
+    ResourcesLoader does not take ownership of \a session.
+*/
+void ResourcesLoader::setSession(Session *session) {
+    Q_D(ResourcesLoader);
+    
+    d->request->setSession(session);
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResourcesLoader::setSession" << session;
+#endif
+}
+
+// Gathers the get() of resourcePath by request, returning the id of the load, or 0 if it cannot be gathered
+int ResourcesLoader::load(ResourcesRequest *request, const QString &resourcePath, const QStringList &fields) {
+    Q_D(ResourcesLoader);
+    
+    // Resources are retrieved with the credentials of the loader
+    if ((request->session() != d->request->session()) || (request->accessToken() != d->request->accessToken())) {
+        return 0;
+    }
+    
+    QString id;
+    const QString path = d->listPath(resourcePath, &id);
+    
+    if (path.isEmpty()) {
+        return 0;
+    }
+    
+    QStringList sorted = fields;
+    sorted.removeDuplicates();
+    sorted.sort();
+    
+    LoadBatch &batch = d->batches[path + "?" + sorted.join(",")];
+    batch.resourcePath = path;
+    batch.fields = sorted;
+    
+    const int loadId = d->nextLoadId++;
+    batch.loads << PendingLoad(request, loadId, id);
+    
+    if (!d->timer.isActive()) {
+        d->timer.start(d->delay);
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResourcesLoader::load" << loadId << resourcePath;
+#endif
+    return loadId;
+}
+
+}
+
+#include "moc_resourcesloader.cpp"
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QDAILYMOTION_RESOURCESLOADER_H
+#define QDAILYMOTION_RESOURCESLOADER_H
+
+#include "qdailymotion_global.h"
+#include <QObject>
+#include <QStringList>
+
+namespace QDailymotion {
+
+class ResourcesLoaderPrivate;
+class ResourcesRequest;
+class Session;
+
+class QDAILYMOTIONSHARED_EXPORT ResourcesLoader : public QObject
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(int delay READ delay WRITE setDelay NOTIFY delayChanged)
+    Q_PROPERTY(int maximumBatchSize READ maximumBatchSize WRITE setMaximumBatchSize NOTIFY maximumBatchSizeChanged)
+    
+public:
+    explicit ResourcesLoader(QObject *parent = 0);
+    ~ResourcesLoader();
+    
+    int delay() const;
+    void setDelay(int msecs);
+    
+    int maximumBatchSize() const;
+    void setMaximumBatchSize(int size);
+    
+    Session* session() const;
+    void setSession(Session *session);
+    
+Q_SIGNALS:
+    void delayChanged();
+    void maximumBatchSizeChanged();
+    
+protected:
+    QScopedPointer<ResourcesLoaderPrivate> d_ptr;
+    
+    Q_DECLARE_PRIVATE(ResourcesLoader)
+    
+    Q_PRIVATE_SLOT(d_func(), void _q_onTimeout())
+    Q_PRIVATE_SLOT(d_func(), void _q_onCallFinished(int))
+    
+private:
+    int load(ResourcesRequest *request, const QString &resourcePath, const QStringList &fields);
+    
+    friend class ResourcesRequestPrivate;
+    
+    Q_DISABLE_COPY(ResourcesLoader)
+};
+
+}
+
+#endif // QDAILYMOTION_RESOURCESLOADER_H
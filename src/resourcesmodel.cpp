@@ -33,6 +33,26 @@ public:
     {
     }
         
+    // Appends the items of a list, whether they are decoded lazily or have already been decoded
+    void appendItems(const QList<ModelItem> &list, bool more) {
+        hasMore = more;
+        
+        if (list.isEmpty()) {
+            return;
+        }
+        
+        Q_Q(ResourcesModel);
+        
+        if (items.isEmpty()) {
+            setRoleNames(list.first().keys());
+        }
+        
+        q->beginInsertRows(QModelIndex(), items.size(), items.size() + list.size() - 1);
+        items << list;
+        q->endInsertRows();
+        emit q->countChanged(q->rowCount());
+    }
+    
     void _q_onListRequestFinished() {
         if (!request) {
             return;
@@ -41,28 +61,35 @@ public:
         Q_Q(ResourcesModel);
     
         if (request->status() == ResourcesRequest::Ready) {
-            const QVariantMap result = request->result().toMap();
-        
-            if (!result.isEmpty()) {
-                hasMore = result.value("has_more").toBool();
+            const QtJson::Document result = request->resultDocument();
+            QList<ModelItem> list;
+            bool more = false;
             
-                const QVariantList list = result.value("list").toList();
-            
-                if (!list.isEmpty()) {
-                    if (items.isEmpty()) {
-                        setRoleNames(list.first().toMap());
-                    }
+            // The items are decoded lazily, as their values are read. The document holds the whole response, as 
+            // lazy parsing does not apply a projection.
+            if (result.isValid()) {
+                if (result.isObject()) {
+                    more = result.value("has_more").toVariant().toBool();
+                    const QtJson::Document listDocument = result.value("list");
                     
-                    q->beginInsertRows(QModelIndex(), items.size(), items.size() + list.size() - 1);
-                    
-                    foreach (const QVariant &item, list) {
-                        items << item.toMap();
+                    if (listDocument.isArray()) {
+                        foreach (const QtJson::Document &item, listDocument.elements()) {
+                            list << item;
+                        }
                     }
-                    
-                    q->endInsertRows();
-                    emit q->countChanged(q->rowCount());
                 }
             }
+            // Results served from a cache have no document
+            else {
+                const QVariantMap map = request->result().toMap();
+                more = map.value("has_more").toBool();
+                
+                foreach (const QVariant &item, map.value("list").toList()) {
+                    list << item.toMap();
+                }
+            }
+            
+            appendItems(list, more);
         }
         
         ResourcesModel::disconnect(request, SIGNAL(finished()), q, SLOT(_q_onListRequestFinished()));
@@ -236,6 +263,7 @@ ResourcesModel::ResourcesModel(QObject *parent) :
     Q_D(ResourcesModel);
 
     d->request = new ResourcesRequest(this);
+    d->request->setLazyParsing(true);
     connect(d->request, SIGNAL(clientIdChanged()), this, SIGNAL(clientIdChanged()));
     connect(d->request, SIGNAL(clientSecretChanged()), this, SIGNAL(clientSecretChanged()));
     connect(d->request, SIGNAL(accessTokenChanged(QString)), this, SIGNAL(accessTokenChanged(QString)));
@@ -410,6 +438,30 @@ void ResourcesModel::setNetworkAccessManager(QNetworkAccessManager *manager) {
     d->request->setNetworkAccessManager(manager);
 }
 
+/*!
+    \brief Returns the Session to which the model is attached, or 0 if it is not attached to a session.
+    
+    \sa ResourcesRequest::session()
+*/
+Session* ResourcesModel::session() const {
+    Q_D(const ResourcesModel);
+    
+    return d->request->session();
+}
+
+/*!
+    \brief Attaches the model to \a session.
+    
+    ResourcesModel does not take ownership of \a session.
+    
+    \sa ResourcesRequest::setSession()
+*/
+void ResourcesModel::setSession(Session *session) {
+    Q_D(ResourcesModel);
+    
+    d->request->setSession(session);
+}
+
 bool ResourcesModel::canFetchMore(const QModelIndex &) const {
     if (status() == ResourcesRequest::Loading) {
         return false;
@@ -62,6 +62,9 @@ public:
     
     void setNetworkAccessManager(QNetworkAccessManager *manager);
     
+    Session* session() const;
+    void setSession(Session *session);
+    
     bool canFetchMore(const QModelIndex &parent = QModelIndex()) const;
     Q_INVOKABLE void fetchMore(const QModelIndex &parent = QModelIndex());
     
@@ -15,11 +15,85 @@
  */
 
 #include "resourcesrequest.h"
-#include "request_p.h"
-#include "urls.h"
+#include "resourcesrequest_p.h"
 
 namespace QDailymotion {
 
+// The errors of batched calls, which are reported using HTTP status codes
+static Request::Error batchCallError(int code) {
+    switch (code) {
+    case 401:
+        return Request::AuthenticationRequiredError;
+    case 403:
+        return Request::ContentAccessDenied;
+    case 404:
+        return Request::ContentNotFoundError;
+    case 405:
+        return Request::ContentOperationNotPermittedError;
+    default:
+        return Request::UnknownContentError;
+    }
+}
+
+bool ResourcesRequestPrivate::startLoad(const QString &resourcePath, const QStringList &fields) {
+    Q_Q(ResourcesRequest);
+    
+    const int id = loader->load(q, resourcePath, fields);
+    
+    if (!id) {
+        return false;
+    }
+    
+    loadId = id;
+    redirects = 0;
+    startDeadline();
+    setOperation(Request::GetOperation);
+    setStatus(Request::Loading);
+    resetParsing();
+    return true;
+}
+
+void ResourcesRequestPrivate::completeLoad(int id, Request::Status s, const QVariant &res, Request::Error e,
+                                           const QString &es) {
+    // The result of a load that has been canceled is discarded
+    if (id != loadId) {
+        return;
+    }
+    
+    Q_Q(ResourcesRequest);
+    
+    loadId = 0;
+    setDocument(QtJson::Document());
+    setResult(res);
+    
+    if (s == Request::Ready) {
+        updateResultCache();
+    }
+    
+    setStatus(s);
+    setError(e);
+    setErrorString(es);
+    emit q->finished();
+}
+
+bool ResourcesRequestPrivate::cancelPending() {
+    const bool canceled = RequestPrivate::cancelPending();
+    
+    if (!loadId) {
+        return canceled;
+    }
+    
+    loadId = 0;
+    return true;
+}
+
+// Calls are canceled with the request, though not when it starts an operation of its own
+void ResourcesRequestPrivate::cancelCalls() {
+    foreach (ResourcesRequest *request, calls.values()) {
+        request->cancel();
+    }
+}
+
 /*!
     \class ResourcesRequest
     \brief Handles requests for Dailymotion resources.
@@ -83,14 +157,220 @@ namespace QDailymotion {
     }
     \endcode
     
+    Only one of list(), get(), insert(), update() and del() can be in progress at a time, and calling one of them 
+    while the request is loading has no effect. To make several requests at the same time, use startList(), 
+    startGet(), startInsert(), startUpdate() and startDel() instead. Each of these starts a separate call and returns 
+    its id. The callFinished() signal is emitted with the id when the call has finished, and the result of the call 
+    can then be retrieved using callStatus(), callResult(), callError() and callErrorString():
+    
+    \code
+    ResourcesRequest request;
+    connect(&request, SIGNAL(callFinished(int)), this, SLOT(onCallFinished(int)));
+    videoCall = request.startGet("/video/VIDEO_ID");
+    playlistsCall = request.startList("/user/USER_ID/playlists");
+    
+    ...
+    
+    void MyClass::onCallFinished(int id) {
+        if (request.callStatus(id) == ResourcesRequest::Ready) {
+            if (id == videoCall) {
+                ...
+            }
+            ...
+        }
+        else {
+            qDebug() << request.callErrorString(id);
+        }
+    }
+    \endcode
+    
+    Calls do not change the status(), result() or error() of the request. Canceling the request with cancel() also 
+    cancels its calls.
+    
     For more details about Dailymotion resources, see the Dailymotion reference documentation 
     <a target="_blank" href="https://developer.dailymotion.com/documentation#api-reference">here</a>.
 */
 ResourcesRequest::ResourcesRequest(QObject *parent) :
-    Request(parent)
+    Request(*new ResourcesRequestPrivate(this), parent)
 {
 }
 
+/*!
+    \brief Returns the status of the call identified by \a id.
+    
+    ResourcesRequest::Null is returned if there is no such call, or its result has been discarded.
+    
+    \sa callFinished()
+*/
+Request::Status ResourcesRequest::callStatus(int id) const {
+    Q_D(const ResourcesRequest);
+    
+    const ResourcesRequest *request = d->call(id);
+    return request ? request->status() : Null;
+}
+
+/*!
+    \brief Returns the result of the call identified by \a id.
+    
+    The result is only available while callFinished() is being handled, and is discarded afterwards. It must 
+    therefore be read from a direct connection to callFinished(), and not from a queued connection.
+    
+    \sa result(), callFinished()
+*/
+QVariant ResourcesRequest::callResult(int id) const {
+    Q_D(const ResourcesRequest);
+    
+    const ResourcesRequest *request = d->call(id);
+    return request ? request->result() : QVariant();
+}
+
+/*!
+    \brief Returns the indexed response of the call identified by \a id.
+    
+    \sa resultDocument(), callFinished()
+*/
+QtJson::Document ResourcesRequest::callResultDocument(int id) const {
+    Q_D(const ResourcesRequest);
+    
+    const ResourcesRequest *request = d->call(id);
+    return request ? request->resultDocument() : QtJson::Document();
+}
+
+/*!
+    \brief Returns the error of the call identified by \a id.
+    
+    \sa error(), callFinished()
+*/
+Request::Error ResourcesRequest::callError(int id) const {
+    Q_D(const ResourcesRequest);
+    
+    const ResourcesRequest *request = d->call(id);
+    return request ? request->error() : NoError;
+}
+
+/*!
+    \brief Returns the description of the error of the call identified by \a id.
+    
+    \sa errorString(), callFinished()
+*/
+QString ResourcesRequest::callErrorString(int id) const {
+    Q_D(const ResourcesRequest);
+    
+    const ResourcesRequest *request = d->call(id);
+    return request ? request->errorString() : QString();
+}
+
+/*!
+    \brief Returns the number of calls that have not yet finished.
+*/
+int ResourcesRequest::activeCalls() const {
+    Q_D(const ResourcesRequest);
+    
+    return d->calls.size();
+}
+
+/*!
+    \brief Returns the result of the call at \a index of the last batch().
+    
+    \sa batch(), batchError()
+*/
+QVariant ResourcesRequest::batchResult(int index) const {
+    Q_D(const ResourcesRequest);
+    
+    return d->batchResponse(index).value("result");
+}
+
+/*!
+    \brief Returns the error of the call at \a index of the last batch().
+    
+    If the batch request itself has failed, error() is returned for each call.
+    
+    \sa batch(), batchErrorString()
+*/
+Request::Error ResourcesRequest::batchError(int index) const {
+    if (status() != Ready) {
+        return error();
+    }
+    
+    Q_D(const ResourcesRequest);
+    
+    const QVariantMap response = d->batchResponse(index);
+    
+    if (response.contains("result")) {
+        return NoError;
+    }
+    
+    if (response.contains("error")) {
+        return batchCallError(response.value("error").toMap().value("code").toInt());
+    }
+    
+    return ParseError;
+}
+
+/*!
+    \brief Returns the description of the error of the call at \a index of the last batch().
+    
+    \sa batch(), batchError()
+*/
+QString ResourcesRequest::batchErrorString(int index) const {
+    if (status() != Ready) {
+        return errorString();
+    }
+    
+    Q_D(const ResourcesRequest);
+    
+    const QVariantMap response = d->batchResponse(index);
+    
+    if (response.contains("result")) {
+        return QString();
+    }
+    
+    if (response.contains("error")) {
+        return response.value("error").toMap().value("message").toString();
+    }
+    
+    return tr("Unable to parse response");
+}
+
+/*!
+    \brief Returns the ResourcesLoader used by get(), or 0 if none is set.
+    
+    \sa setLoader()
+*/
+ResourcesLoader* ResourcesRequest::loader() const {
+    Q_D(const ResourcesRequest);
+    
+    return d->loader;
+}
+
+/*!
+    \brief Sets the ResourcesLoader used by get() to \a loader.
+    
+    While a loader is set, calls to get() for single videos, users or playlists, without filters or a projection, 
+    are gathered by the loader into list calls. This can greatly reduce the number of HTTP requests when many 
+    requests retrieve resources of the same type at the same time.
+    
+    ResourcesRequest does not take ownership of \a loader.
+    
+    \sa ResourcesLoader
+*/
+void ResourcesRequest::setLoader(ResourcesLoader *loader) {
+    Q_D(ResourcesRequest);
+    
+    d->loader = loader;
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResourcesRequest::setLoader" << loader;
+#endif
+}
+
+/*!
+    \fn void ResourcesRequest::callFinished(int id)
+    \brief Emitted when the call identified by \a id has finished.
+    
+    The result of the call is available until the signal has been handled, and is then discarded, so it must be 
+    read from a direct connection.
+*/
+
 /*!
     \brief Requests a list of Dailymotion resources from \a resourcePath.
     
@@ -104,13 +384,26 @@ ResourcesRequest::ResourcesRequest(QObject *parent) :
     filters["search"] = "Qt";
     request.list("/videos", filters);
     \endcode
+    
+    If \a projection is not empty, only the key paths it contains are parsed from the response, and 
+    the rest of it is skipped. For example, to parse only the ids and titles of the videos:
+    
+    \code
+    request.list("/videos", filters, QStringList() << "id" << "title",
+                 QStringList() << "list[*].id" << "list[*].title" << "has_more");
+    \endcode
+    
+    \sa QtJson::Parser::setProjection()
 */
-void ResourcesRequest::list(const QString &resourcePath, const QVariantMap &filters, const QStringList &fields) {
+void ResourcesRequest::list(const QString &resourcePath, const QVariantMap &filters, const QStringList &fields,
+                            const QStringList &projection) {
+    Q_D(ResourcesRequest);
+    
     if (status() == Loading) {
         return;
     }
     
-    QUrl u(QString("%1%2%3").arg(API_URL).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
+    QUrl u(QString("%1%2%3").arg(d->apiUrl()).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
                             .arg(resourcePath));
 #if QT_VERSION >= 0x050000
     QUrlQuery query(u);
@@ -135,6 +428,13 @@ void ResourcesRequest::list(const QString &resourcePath, const QVariantMap &filt
 #endif
     setUrl(u);
     setData(QVariant());
+    setProjection(projection);
+    
+    if (d->loadFromResultCache(ResultCache::key("GET", resourcePath, filters, fields, projection,
+                                                d->resultCacheIdentity()))) {
+        return;
+    }
+    
     Request::get();
 }
 
@@ -147,13 +447,22 @@ void ResourcesRequest::list(const QString &resourcePath, const QVariantMap &filt
     ResourcesRequest request;
     request.get("/videos/VIDEO_ID");
     \endcode
+    
+    If \a projection is not empty, only the key paths it contains are parsed from the response.
+    
+    If a loader is set, the resource may be retrieved together with others in one list call.
+    
+    \sa list(), setLoader()
 */
-void ResourcesRequest::get(const QString &resourcePath, const QVariantMap &filters, const QStringList &fields) {
+void ResourcesRequest::get(const QString &resourcePath, const QVariantMap &filters, const QStringList &fields,
+                           const QStringList &projection) {
+    Q_D(ResourcesRequest);
+    
     if (status() == Loading) {
         return;
     }
     
-    QUrl u(QString("%1%2%3").arg(API_URL).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
+    QUrl u(QString("%1%2%3").arg(d->apiUrl()).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
                             .arg(resourcePath));
 #if QT_VERSION >= 0x050000
     QUrlQuery query(u);
@@ -178,6 +487,18 @@ void ResourcesRequest::get(const QString &resourcePath, const QVariantMap &filte
 #endif
     setUrl(u);
     setData(QVariant());
+    setProjection(projection);
+    
+    if (d->loadFromResultCache(ResultCache::key("GET", resourcePath, filters, fields, projection,
+                                                d->resultCacheIdentity()))) {
+        return;
+    }
+    
+    // Single resources are gathered by the loader into list calls
+    if ((d->loader) && (filters.isEmpty()) && (projection.isEmpty()) && (d->startLoad(resourcePath, fields))) {
+        return;
+    }
+    
     Request::get();
 }
 
@@ -192,14 +513,18 @@ void ResourcesRequest::get(const QString &resourcePath, const QVariantMap &filte
     \endcode
 */
 void ResourcesRequest::insert(const QString &resourcePath) {
+    Q_D(ResourcesRequest);
+    
     if (status() == Loading) {
         return;
     }
     
-    QUrl u(QString("%1%2%3").arg(API_URL).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
+    QUrl u(QString("%1%2%3").arg(d->apiUrl()).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
                             .arg(resourcePath));
     setUrl(u);
     setData(QVariant());
+    setProjection(QStringList());
+    d->setChangedPaths(QStringList() << resourcePath);
     Request::post();
 }
 
@@ -217,16 +542,20 @@ void ResourcesRequest::insert(const QString &resourcePath) {
     \endcode
 */
 void ResourcesRequest::insert(const QVariantMap &resource, const QString &resourcePath) {
+    Q_D(ResourcesRequest);
+    
     if (status() == Loading) {
         return;
     }
     
-    QUrl u(QString("%1%2%3").arg(API_URL).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
+    QUrl u(QString("%1%2%3").arg(d->apiUrl()).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
                             .arg(resourcePath));
     QString body;
     addPostBody(&body, resource);
     setUrl(u);
     setData(body);
+    setProjection(QStringList());
+    d->setChangedPaths(QStringList() << resourcePath);
     post();
 }
 
@@ -244,16 +573,20 @@ void ResourcesRequest::insert(const QVariantMap &resource, const QString &resour
     \endcode
 */
 void ResourcesRequest::update(const QString &resourcePath, const QVariantMap &resource) {
+    Q_D(ResourcesRequest);
+    
     if (status() == Loading) {
         return;
     }
     
-    QUrl u(QString("%1%2%3").arg(API_URL).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
+    QUrl u(QString("%1%2%3").arg(d->apiUrl()).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
                             .arg(resourcePath));
     QString body;
     addPostBody(&body, resource);
     setUrl(u);
     setData(body);
+    setProjection(QStringList());
+    d->setChangedPaths(QStringList() << resourcePath);
     post();
 }
 
@@ -268,15 +601,236 @@ void ResourcesRequest::update(const QString &resourcePath, const QVariantMap &re
     \endcode
 */
 void ResourcesRequest::del(const QString &resourcePath) {
+    Q_D(ResourcesRequest);
+    
     if (status() == Loading) {
         return;
     }
     
-    QUrl u(QString("%1%2%3").arg(API_URL).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
+    QUrl u(QString("%1%2%3").arg(d->apiUrl()).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
                             .arg(resourcePath));
     setUrl(u);
     setData(QVariant());
+    setProjection(QStringList());
+    d->setChangedPaths(QStringList() << resourcePath);
     deleteResource();
 }
 
+/*!
+    \brief Makes several calls to the Dailymotion Data API in one HTTP request.
+    
+    Each of \a calls is a map that can contain the following keys:
+    
+    <table>
+        <tr>
+            <th>Key</th>
+            <th>Description</th>
+        </tr>
+        <tr>
+            <td>method</td>
+            <td>The HTTP method of the call. The default is GET.</td>
+        </tr>
+        <tr>
+            <td>path</td>
+            <td>The resource path, for example /video/VIDEO_ID.</td>
+        </tr>
+        <tr>
+            <td>filters</td>
+            <td>The arguments of the call, as passed to list() or insert().</td>
+        </tr>
+        <tr>
+            <td>fields</td>
+            <td>The fields to be returned.</td>
+        </tr>
+    </table>
+    
+    The request is Ready when the response has been received, even if some of the calls have failed. The result 
+    and error of each call are then retrieved using batchResult(), batchError() and batchErrorString(), with the 
+    index of the call in \a calls.
+    
+    For example, to retrieve a user, their playlists and their latest videos:
+    
+    \code
+    ResourcesRequest request;
+    QVariantList calls;
+    QVariantMap user;
+    user["path"] = "/user/USER_ID";
+    user["fields"] = QStringList() << "id" << "screenname";
+    calls << user;
+    QVariantMap playlists;
+    playlists["path"] = "/user/USER_ID/playlists";
+    calls << playlists;
+    QVariantMap videos;
+    QVariantMap filters;
+    filters["sort"] = "recent";
+    filters["limit"] = 5;
+    videos["path"] = "/user/USER_ID/videos";
+    videos["filters"] = filters;
+    calls << videos;
+    request.batch(calls);
+    \endcode
+    
+    When the batch has finished, the results and responses cached for the resources changed by its POST and DELETE 
+    calls are invalidated, as they would be by insert(), update() and del().
+    
+    The Data API accepts up to 10 calls in one request.
+*/
+void ResourcesRequest::batch(const QVariantList &calls) {
+    Q_D(ResourcesRequest);
+    
+    if (status() == Loading) {
+        return;
+    }
+    
+    QVariantList body;
+    QStringList changedPaths;
+    
+    foreach (const QVariant &call, calls) {
+        const QVariantMap map = call.toMap();
+        const QString method = map.value("method", QString("GET")).toString().toUpper();
+        const QString path = map.value("path").toString();
+        const QStringList fields = map.value("fields").toStringList();
+        QVariantMap args = map.value("filters").toMap();
+        
+        if (!fields.isEmpty()) {
+            args["fields"] = fields;
+        }
+        
+        // The resources changed by the calls are invalidated in the caches once the batch has finished
+        if (method != "GET") {
+            changedPaths << path;
+        }
+        
+        QVariantMap c;
+        c["call"] = QString("%1 %2%3").arg(method).arg(path.startsWith("/") ? QString() : QString("/")).arg(path);
+        
+        if (!args.isEmpty()) {
+            c["args"] = args;
+        }
+        
+        body << c;
+    }
+    
+    setUrl(QUrl(d->apiUrl()));
+    setData(body);
+    setProjection(QStringList());
+    d->setChangedPaths(changedPaths);
+    post();
+}
+
+/*!
+    \brief Starts a call that requests a list of Dailymotion resources from \a resourcePath, and returns its id.
+    
+    \sa list(), callFinished()
+*/
+int ResourcesRequest::startList(const QString &resourcePath, const QVariantMap &filters, const QStringList &fields,
+                                const QStringList &projection) {
+    Q_D(ResourcesRequest);
+    
+    int id;
+    d->startCall(&id)->list(resourcePath, filters, fields, projection);
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResourcesRequest::startList" << id << resourcePath;
+#endif
+    return id;
+}
+
+/*!
+    \brief Starts a call that retrieves the Dailymotion resource from \a resourcePath, and returns its id.
+    
+    \sa get(), callFinished()
+*/
+int ResourcesRequest::startGet(const QString &resourcePath, const QVariantMap &filters, const QStringList &fields,
+                               const QStringList &projection) {
+    Q_D(ResourcesRequest);
+    
+    int id;
+    d->startCall(&id)->get(resourcePath, filters, fields, projection);
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResourcesRequest::startGet" << id << resourcePath;
+#endif
+    return id;
+}
+
+/*!
+    \brief Starts a call that inserts a Dailymotion resource into \a resourcePath, and returns its id.
+    
+    \sa insert(), callFinished()
+*/
+int ResourcesRequest::startInsert(const QString &resourcePath) {
+    Q_D(ResourcesRequest);
+    
+    int id;
+    d->startCall(&id)->insert(resourcePath);
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResourcesRequest::startInsert" << id << resourcePath;
+#endif
+    return id;
+}
+
+/*!
+    \brief Starts a call that inserts a new Dailymotion resource, and returns its id.
+    
+    \sa insert(), callFinished()
+*/
+int ResourcesRequest::startInsert(const QVariantMap &resource, const QString &resourcePath) {
+    Q_D(ResourcesRequest);
+    
+    int id;
+    d->startCall(&id)->insert(resource, resourcePath);
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResourcesRequest::startInsert" << id << resourcePath;
+#endif
+    return id;
+}
+
+/*!
+    \brief Starts a call that updates the Dailymotion resource at \a resourcePath, and returns its id.
+    
+    \sa update(), callFinished()
+*/
+int ResourcesRequest::startUpdate(const QString &resourcePath, const QVariantMap &resource) {
+    Q_D(ResourcesRequest);
+    
+    int id;
+    d->startCall(&id)->update(resourcePath, resource);
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResourcesRequest::startUpdate" << id << resourcePath;
+#endif
+    return id;
 }
+
+/*!
+    \brief Starts a call that deletes the Dailymotion resource at \a resourcePath, and returns its id.
+    
+    \sa del(), callFinished()
+*/
+int ResourcesRequest::startDel(const QString &resourcePath) {
+    Q_D(ResourcesRequest);
+    
+    int id;
+    d->startCall(&id)->del(resourcePath);
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResourcesRequest::startDel" << id << resourcePath;
+#endif
+    return id;
+}
+
+/*!
+    \brief Cancels the call identified by \a id.
+    
+    The callFinished() signal is emitted with the status ResourcesRequest::Canceled.
+*/
+void ResourcesRequest::cancelCall(int id) {
+    Q_D(ResourcesRequest);
+    
+    ResourcesRequest *request = d->call(id);
+    
+    if (request) {
+        request->cancel();
+    }
+}
+
+}
+
+#include "moc_resourcesrequest.cpp"
@@ -18,10 +18,14 @@
 #define QDAILYMOTION_RESOURCESREQUEST_H
 
 #include "request.h"
+#include "json.h"
 #include <QStringList>
 
 namespace QDailymotion {
 
+class ResourcesLoader;
+class ResourcesRequestPrivate;
+
 class QDAILYMOTIONSHARED_EXPORT ResourcesRequest : public Request
 {
     Q_OBJECT
@@ -29,12 +33,33 @@ class QDAILYMOTIONSHARED_EXPORT ResourcesRequest : public Request
 public:
     explicit ResourcesRequest(QObject *parent = 0);
     
+    template <typename T>
+    QVector<T> resultAs() const;
+    
+    Q_INVOKABLE Status callStatus(int id) const;
+    Q_INVOKABLE QVariant callResult(int id) const;
+    QtJson::Document callResultDocument(int id) const;
+    Q_INVOKABLE Error callError(int id) const;
+    Q_INVOKABLE QString callErrorString(int id) const;
+    
+    template <typename T>
+    QVector<T> callResultAs(int id) const;
+    
+    int activeCalls() const;
+    
+    ResourcesLoader* loader() const;
+    void setLoader(ResourcesLoader *loader);
+    
+    Q_INVOKABLE QVariant batchResult(int index) const;
+    Q_INVOKABLE Error batchError(int index) const;
+    Q_INVOKABLE QString batchErrorString(int index) const;
+    
 public Q_SLOTS:
     void list(const QString &resourcePath, const QVariantMap &filters = QVariantMap(),
-              const QStringList &fields = QStringList());
+              const QStringList &fields = QStringList(), const QStringList &projection = QStringList());
     
     void get(const QString &resourcePath, const QVariantMap &filters = QVariantMap(),
-             const QStringList &fields = QStringList());
+             const QStringList &fields = QStringList(), const QStringList &projection = QStringList());
     
     void insert(const QString &resourcePath);
     
@@ -44,10 +69,62 @@ public Q_SLOTS:
     
     void del(const QString &resourcePath);
     
+    void batch(const QVariantList &calls);
+    
+    int startList(const QString &resourcePath, const QVariantMap &filters = QVariantMap(),
+                  const QStringList &fields = QStringList(), const QStringList &projection = QStringList());
+    
+    int startGet(const QString &resourcePath, const QVariantMap &filters = QVariantMap(),
+                 const QStringList &fields = QStringList(), const QStringList &projection = QStringList());
+    
+    int startInsert(const QString &resourcePath);
+    
+    int startInsert(const QVariantMap &resource, const QString &resourcePath);
+    
+    int startUpdate(const QString &resourcePath, const QVariantMap &resource);
+    
+    int startDel(const QString &resourcePath);
+    
+    void cancelCall(int id);
+    
+Q_SIGNALS:
+    void callFinished(int id);
+    
 private:
+    Q_DECLARE_PRIVATE(ResourcesRequest)
     Q_DISABLE_COPY(ResourcesRequest)
+    
+    friend class ResourcesLoaderPrivate;
+    
+    Q_PRIVATE_SLOT(d_func(), void _q_onCallFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_onCallAccessTokenChanged(QString))
 };
 
+/*!
+    \brief Returns the result decoded into structs of type T, such as Video.
+    
+    The objects are decoded from the indexed response if lazyParsing is enabled, and otherwise from result(). 
+    Only the fields described by QtJson::Schema<T> are decoded.
+    
+    \sa QtJson::Json::parseInto()
+*/
+template <typename T>
+inline QVector<T> ResourcesRequest::resultAs() const {
+    const QtJson::Document document = resultDocument();
+    return document.isValid() ? QtJson::Json::parseInto<T>(document) : QtJson::Json::parseInto<T>(result());
+}
+
+/*!
+    \brief Returns the result of the call identified by \a id decoded into structs of type T.
+    
+    \sa resultAs(), callFinished()
+*/
+template <typename T>
+inline QVector<T> ResourcesRequest::callResultAs(int id) const {
+    const QtJson::Document document = callResultDocument(id);
+    return document.isValid() ? QtJson::Json::parseInto<T>(document) : QtJson::Json::parseInto<T>(callResult(id));
+}
+
 }
 
 #endif // QDAILYMOTION_RESOURCESREQUEST_H
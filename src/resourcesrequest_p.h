@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QDAILYMOTION_RESOURCESREQUEST_P_H
+#define QDAILYMOTION_RESOURCESREQUEST_P_H
+
+#include "resourcesrequest.h"
+#include "resourcesloader.h"
+#include "request_p.h"
+#include "resultcache.h"
+#include "urls.h"
+#include <QHash>
+
+namespace QDailymotion {
+
+// The number of finished calls that are kept for reuse by later calls
+static const int MAX_IDLE_CALLS = 4;
+
+class ResourcesRequestPrivate : public RequestPrivate
+{
+
+public:
+    ResourcesRequestPrivate(ResourcesRequest *parent) :
+        RequestPrivate(parent),
+        nextCallId(1),
+        loadId(0)
+    {
+        shareGets = true;
+    }
+    
+    QString apiUrl() const {
+        return session ? session->apiUrl() : API_URL;
+    }
+    
+    // Results are cached for each API and access token, since they can depend on the authenticated user
+    QString resultCacheIdentity() const {
+        Q_Q(const ResourcesRequest);
+        
+        return apiUrl() + " " + q->accessToken();
+    }
+    
+    // Sets the resource paths changed by a write, which invalidate the results and responses cached for them
+    void setChangedPaths(const QStringList &paths) {
+        resultCacheKey.clear();
+        resultCachePaths = paths;
+        urlPaths.clear();
+        
+        foreach (const QString &path, paths) {
+            urlPaths << QUrl(apiUrl() + (path.startsWith("/") ? QString() : QString("/")) + path).path();
+        }
+    }
+    
+    // A batch is written to the API URL, and changes the resources of its calls instead
+    QStringList changedUrlPaths() const {
+        return urlPaths;
+    }
+    
+    QVariantMap batchResponse(int index) const {
+        Q_Q(const ResourcesRequest);
+        
+        return q->result().toList().value(index).toMap();
+    }
+    
+    ResourcesRequest* call(int id) const {
+        return calls.value(id);
+    }
+    
+    ResourcesRequest* startCall(int *id) {
+        Q_Q(ResourcesRequest);
+        
+        ResourcesRequest *request;
+        
+        if (idleCalls.isEmpty()) {
+            request = new ResourcesRequest(q);
+            ResourcesRequest::connect(request, SIGNAL(finished()), q, SLOT(_q_onCallFinished()));
+            ResourcesRequest::connect(request, SIGNAL(accessTokenChanged(QString)),
+                                      q, SLOT(_q_onCallAccessTokenChanged(QString)));
+        }
+        else {
+            request = idleCalls.takeLast();
+        }
+        
+        // Each call is made with the current configuration of this request
+        configure(request, networkAccessManager());
+        request->setLoader(loader);
+        
+        // Ids are never reused, so that a stale id does not refer to a later call
+        *id = nextCallId++;
+        calls.insert(*id, request);
+        callIds.insert(request, *id);
+        return request;
+    }
+    
+    void _q_onCallFinished() {
+        Q_Q(ResourcesRequest);
+        
+        ResourcesRequest *request = qobject_cast<ResourcesRequest*>(q->sender());
+        
+        if ((!request) || (!callIds.contains(request))) {
+            return;
+        }
+        
+        const int id = callIds.value(request);
+        emit q->callFinished(id);
+        
+        // The result of the call is discarded once callFinished() has been handled, so it can only be read from a 
+        // direct connection
+        calls.remove(id);
+        callIds.remove(request);
+        
+        if (idleCalls.size() < MAX_IDLE_CALLS) {
+            idleCalls.append(request);
+        }
+        else {
+            request->deleteLater();
+        }
+    }
+    
+    void _q_onCallAccessTokenChanged(const QString &token) {
+        // An access token refreshed by a call is used by this request and its later calls
+        if (!session) {
+            Q_Q(ResourcesRequest);
+            q->setAccessToken(token);
+        }
+    }
+    
+    bool startLoad(const QString &resourcePath, const QStringList &fields);
+    
+    void completeLoad(int id, Request::Status s, const QVariant &res, Request::Error e, const QString &es);
+    
+    bool cancelPending();
+    
+    void cancelCalls();
+    
+    QHash<int, ResourcesRequest*> calls;
+    QHash<ResourcesRequest*, int> callIds;
+    
+    QList<ResourcesRequest*> idleCalls;
+    
+    int nextCallId;
+    
+    QStringList urlPaths;
+    
+    QPointer<ResourcesLoader> loader;
+    
+    int loadId;
+    
+    Q_DECLARE_PUBLIC(ResourcesRequest)
+};
+
+}
+
+#endif // QDAILYMOTION_RESOURCESREQUEST_P_H
@@ -0,0 +1,483 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "responsecache_p.h"
+#include "json.h"
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QLocale>
+#include <QMap>
+#include <QNetworkReply>
+#include <QStringList>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#endif
+#ifdef QDAILYMOTION_DEBUG
+#include <QDebug>
+#endif
+
+namespace QDailymotion {
+
+static const quint32 CACHE_MAGIC = 0x51444d43;
+static const quint8 CACHE_VERSION = 2;
+
+static const QString CACHE_SUFFIX(".cache");
+
+static const qint64 MAX_CACHE_SIZE = 10 * 1024 * 1024;
+
+static QString defaultDirectory() {
+#if QT_VERSION >= 0x050000
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/qdailymotion";
+#else
+    return QDir::tempPath() + "/qdailymotion-cache";
+#endif
+}
+
+CacheEntry CacheEntry::fromReply(const QNetworkReply *reply) {
+    CacheEntry entry;
+    entry.etag = reply->rawHeader("ETag");
+    entry.lastModified = reply->rawHeader("Last-Modified");
+    
+    qint64 maxAge = -1;
+    
+    foreach (QByteArray directive, reply->rawHeader("Cache-Control").toLower().split(',')) {
+        directive = directive.trimmed();
+        
+        if (directive == "no-store") {
+            entry.noStore = true;
+        }
+        else if (directive == "no-cache") {
+            entry.noCache = true;
+        }
+        else if (directive.startsWith("max-age=")) {
+            bool ok;
+            const qint64 age = directive.mid(8).toLongLong(&ok);
+            
+            if (ok) {
+                maxAge = age;
+            }
+        }
+    }
+    
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    
+    if (maxAge >= 0) {
+        // The time spent in other caches is deducted
+        entry.expires = now.addSecs(int(qMax(Q_INT64_C(0), maxAge - reply->rawHeader("Age").toLongLong())));
+    }
+    else if (reply->hasRawHeader("Expires")) {
+        QDateTime expires = QLocale::c().toDateTime(QString::fromLatin1(reply->rawHeader("Expires")),
+                                                    "ddd, dd MMM yyyy hh:mm:ss 'GMT'");
+        
+        // An invalid date means that the response has already expired
+        if (expires.isValid()) {
+            expires.setTimeSpec(Qt::UTC);
+            entry.expires = expires;
+        }
+        else {
+            entry.expires = now;
+        }
+    }
+    
+    return entry;
+}
+
+// Returns the resource path of a URL, without a trailing slash
+static QString normalizedPath(const QString &path) {
+    QString p = path.startsWith("/") ? path : "/" + path;
+    
+    while ((p.size() > 1) && (p.endsWith("/"))) {
+        p.chop(1);
+    }
+    
+    return p;
+}
+
+struct CacheItem
+{
+    CacheItem() : size(0), access(0) {}
+    
+    QString path;
+    qint64 size;
+    qint64 access;
+};
+
+class ResponseCachePrivate
+{
+
+public:
+    ResponseCachePrivate(ResponseCache *parent) :
+        q_ptr(parent),
+        directory(defaultDirectory()),
+        maximumSize(MAX_CACHE_SIZE),
+        size(0),
+        accessCount(0)
+    {
+    }
+    
+    QString filePath(const QByteArray &key) const {
+        return directory + "/" + QString::fromLatin1(key) + CACHE_SUFFIX;
+    }
+    
+    // Indexes the entries in the directory by their resource path, with the least recently written first
+    void load() {
+        items.clear();
+        order.clear();
+        size = 0;
+        
+        const QFileInfoList files = QDir(directory).entryInfoList(QStringList() << "*" + CACHE_SUFFIX, QDir::Files,
+                                                                  QDir::Time | QDir::Reversed);
+        
+        foreach (const QFileInfo &info, files) {
+            QFile file(info.filePath());
+            QString path;
+            bool ok = false;
+            
+            if (file.open(QIODevice::ReadOnly)) {
+                QDataStream stream(&file);
+                stream.setVersion(QDataStream::Qt_4_6);
+                
+                quint32 magic;
+                quint8 version;
+                stream >> magic >> version >> path;
+                ok = (stream.status() == QDataStream::Ok) && (magic == CACHE_MAGIC) && (version == CACHE_VERSION);
+                file.close();
+            }
+            
+            // Entries written by an earlier version have no resource path, and are discarded
+            if (ok) {
+                addItem(info.completeBaseName().toLatin1(), path, info.size());
+            }
+            else {
+                QFile::remove(info.filePath());
+            }
+        }
+    }
+    
+    void addItem(const QByteArray &key, const QString &path, qint64 itemSize) {
+        removeItem(key);
+        
+        CacheItem &item = items[key];
+        item.path = path;
+        item.size = itemSize;
+        item.access = ++accessCount;
+        order.insert(item.access, key);
+        size += itemSize;
+    }
+    
+    void removeItem(const QByteArray &key) {
+        if (items.contains(key)) {
+            const CacheItem item = items.take(key);
+            order.remove(item.access);
+            size -= item.size;
+        }
+    }
+    
+    void touchItem(const QByteArray &key) {
+        if (items.contains(key)) {
+            CacheItem &item = items[key];
+            order.remove(item.access);
+            item.access = ++accessCount;
+            order.insert(item.access, key);
+        }
+    }
+    
+    // Removes the least recently used entries until the cache is within its maximum size
+    void expire() {
+        while ((size > maximumSize) && (!order.isEmpty())) {
+            const QByteArray key = order.begin().value();
+            removeItem(key);
+            QFile::remove(filePath(key));
+        }
+    }
+    
+    ResponseCache *q_ptr;
+    
+    QString directory;
+    
+    qint64 maximumSize;
+    
+    qint64 size;
+    
+    qint64 accessCount;
+    
+    QHash<QByteArray, CacheItem> items;
+    
+    QMap<qint64, QByteArray> order;
+    
+    Q_DECLARE_PUBLIC(ResponseCache)
+};
+
+/*!
+    \class ResponseCache
+    \brief Stores responses of the Dailymotion Data API on disk, so that they can be reused by later requests.
+    
+    \ingroup requests
+    
+    When a ResponseCache is set on a Request or Session, the parsed responses of GET requests are stored in the cache 
+    together with their ETag and Last-Modified validators and the freshness given by their Cache-Control or Expires 
+    headers. Depending on the Request::cachePolicy, a later request for the same URL with the same access token 
+    is either served from the cache without a network request, or made as a conditional request. A 
+    304 Not Modified response is then served from the cache, without downloading or parsing the response again.
+    
+    A successful POST, PUT or DELETE request removes the cached responses for its resource path, whatever the fields, 
+    filters and projection with which they were requested, together with those for the resources under it and for 
+    the collections that contain it.
+    
+    The cache is bounded by maximumSize, and the least recently used entries are removed when it is exceeded.
+    
+    Example usage:
+    
+    \code
+    using namespace QDailymotion;
+    
+    ...
+    
+    ResponseCache *cache = new ResponseCache(this);
+    cache->setDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/dailymotion");
+    cache->setMaximumSize(20 * 1024 * 1024);
+    session->setResponseCache(cache);
+    \endcode
+    
+    \sa Request::setResponseCache(), Session::setResponseCache()
+*/
+ResponseCache::ResponseCache(QObject *parent) :
+    QObject(parent),
+    d_ptr(new ResponseCachePrivate(this))
+{
+    Q_D(ResponseCache);
+    
+    d->load();
+}
+
+ResponseCache::~ResponseCache() {}
+
+/*!
+    \property QString ResponseCache::directory
+    \brief The directory in which the responses are stored.
+    
+    The default directory is a qdailymotion directory in the cache location of the application.
+*/
+
+/*!
+    \fn void ResponseCache::directoryChanged()
+    \brief Emitted when the directory changes.
+*/
+QString ResponseCache::directory() const {
+    Q_D(const ResponseCache);
+    
+    return d->directory;
+}
+
+void ResponseCache::setDirectory(const QString &directory) {
+    Q_D(ResponseCache);
+    
+    if (directory != d->directory) {
+        d->directory = directory;
+        d->load();
+        d->expire();
+        emit directoryChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResponseCache::setDirectory" << directory;
+#endif
+}
+
+/*!
+    \property qint64 ResponseCache::maximumSize
+    \brief The maximum size of the cache in bytes.
+    
+    The default value is 10MB.
+*/
+
+/*!
+    \fn void ResponseCache::maximumSizeChanged()
+    \brief Emitted when the maximumSize changes.
+*/
+qint64 ResponseCache::maximumSize() const {
+    Q_D(const ResponseCache);
+    
+    return d->maximumSize;
+}
+
+void ResponseCache::setMaximumSize(qint64 size) {
+    Q_D(ResponseCache);
+    
+    if (size != d->maximumSize) {
+        d->maximumSize = size;
+        d->expire();
+        emit maximumSizeChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResponseCache::setMaximumSize" << size;
+#endif
+}
+
+/*!
+    \property qint64 ResponseCache::size
+    \brief The current size of the cache in bytes.
+*/
+qint64 ResponseCache::size() const {
+    Q_D(const ResponseCache);
+    
+    return d->size;
+}
+
+/*!
+    \brief Removes all responses from the cache.
+*/
+void ResponseCache::clear() {
+    Q_D(ResponseCache);
+    
+    foreach (const QByteArray &key, d->items.keys()) {
+        QFile::remove(d->filePath(key));
+    }
+    
+    d->items.clear();
+    d->order.clear();
+    d->size = 0;
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResponseCache::clear";
+#endif
+}
+
+// Returns the entry stored under key, which is invalid if there is none
+CacheEntry ResponseCache::entry(const QByteArray &key) {
+    Q_D(ResponseCache);
+    
+    CacheEntry entry;
+    
+    if (!d->items.contains(key)) {
+        return entry;
+    }
+    
+    QFile file(d->filePath(key));
+    
+    if (file.open(QIODevice::ReadOnly)) {
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_4_6);
+        
+        quint32 magic;
+        quint8 version;
+        stream >> magic >> version;
+        
+        if ((magic == CACHE_MAGIC) && (version == CACHE_VERSION)) {
+            QString path;
+            qint64 expires;
+            QByteArray data;
+            stream >> path >> entry.etag >> entry.lastModified >> expires >> entry.noCache >> data;
+            
+            if (stream.status() == QDataStream::Ok) {
+                if (expires) {
+                    entry.expires = QDateTime::fromMSecsSinceEpoch(expires).toUTC();
+                }
+                
+                entry.result = QtJson::Json::fromBinary(data, entry.valid);
+            }
+        }
+        
+        file.close();
+    }
+    
+    // Entries that cannot be read are discarded
+    if (entry.valid) {
+        d->touchItem(key);
+    }
+    else {
+        remove(key);
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResponseCache::entry" << key << entry.valid;
+#endif
+    return entry;
+}
+
+// Stores entry for the resource at path under key, replacing any existing entry
+void ResponseCache::insert(const QByteArray &key, const QString &path, const CacheEntry &entry) {
+    Q_D(ResponseCache);
+    
+    bool ok;
+    const QByteArray data = QtJson::Json::toBinary(entry.result, ok);
+    
+    if ((!ok) || (!QDir().mkpath(d->directory))) {
+        return;
+    }
+    
+    QFile file(d->filePath(key));
+    
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return;
+    }
+    
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_6);
+    const QString resourcePath = normalizedPath(path);
+    stream << CACHE_MAGIC << CACHE_VERSION << resourcePath << entry.etag << entry.lastModified
+           << (entry.expires.isValid() ? entry.expires.toMSecsSinceEpoch() : Q_INT64_C(0)) << entry.noCache << data;
+    file.close();
+    
+    d->addItem(key, resourcePath, file.size());
+    d->expire();
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResponseCache::insert" << key << file.size();
+#endif
+}
+
+// Removes the entry stored under key
+void ResponseCache::remove(const QByteArray &key) {
+    Q_D(ResponseCache);
+    
+    if (d->items.contains(key)) {
+        d->removeItem(key);
+        QFile::remove(d->filePath(key));
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResponseCache::remove" << key;
+#endif
+}
+
+// Removes the entries for the resource at path, for the resources under it, and for the collections containing it, 
+// whatever the query and projection with which they were requested
+void ResponseCache::invalidate(const QString &path) {
+    Q_D(ResponseCache);
+    
+    const QString changedPath = normalizedPath(path);
+    QList<QByteArray> keys;
+    
+    for (QHash<QByteArray, CacheItem>::const_iterator iterator = d->items.constBegin();
+         iterator != d->items.constEnd(); ++iterator) {
+        const QString &itemPath = iterator.value().path;
+        
+        if ((itemPath == changedPath) || (itemPath.startsWith(changedPath + "/"))
+            || (changedPath.startsWith(itemPath + "/"))) {
+            keys << iterator.key();
+        }
+    }
+    
+    foreach (const QByteArray &key, keys) {
+        d->removeItem(key);
+        QFile::remove(d->filePath(key));
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResponseCache::invalidate" << path << keys.size();
+#endif
+}
+
+}
+
+#include "moc_responsecache.cpp"
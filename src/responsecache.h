@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QDAILYMOTION_RESPONSECACHE_H
+#define QDAILYMOTION_RESPONSECACHE_H
+
+#include "qdailymotion_global.h"
+#include <QObject>
+
+namespace QDailymotion {
+
+class ResponseCachePrivate;
+struct CacheEntry;
+
+class QDAILYMOTIONSHARED_EXPORT ResponseCache : public QObject
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(QString directory READ directory WRITE setDirectory NOTIFY directoryChanged)
+    Q_PROPERTY(qint64 maximumSize READ maximumSize WRITE setMaximumSize NOTIFY maximumSizeChanged)
+    Q_PROPERTY(qint64 size READ size)
+    
+public:
+    explicit ResponseCache(QObject *parent = 0);
+    ~ResponseCache();
+    
+    QString directory() const;
+    void setDirectory(const QString &directory);
+    
+    qint64 maximumSize() const;
+    void setMaximumSize(qint64 size);
+    
+    qint64 size() const;
+    
+public Q_SLOTS:
+    void clear();
+    
+Q_SIGNALS:
+    void directoryChanged();
+    void maximumSizeChanged();
+    
+protected:
+    QScopedPointer<ResponseCachePrivate> d_ptr;
+    
+    Q_DECLARE_PRIVATE(ResponseCache)
+    
+private:
+    CacheEntry entry(const QByteArray &key);
+    void insert(const QByteArray &key, const QString &path, const CacheEntry &entry);
+    void remove(const QByteArray &key);
+    void invalidate(const QString &path);
+    
+    friend class RequestPrivate;
+    
+    Q_DISABLE_COPY(ResponseCache)
+};
+
+}
+
+#endif // QDAILYMOTION_RESPONSECACHE_H
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QDAILYMOTION_RESPONSECACHE_P_H
+#define QDAILYMOTION_RESPONSECACHE_P_H
+
+#include "responsecache.h"
+#include <QDateTime>
+#include <QVariant>
+
+class QNetworkReply;
+
+namespace QDailymotion {
+
+/*!
+    \brief A cached response, with the validators and freshness given by its headers.
+*/
+struct CacheEntry
+{
+    CacheEntry() : noCache(false), noStore(false), valid(false) {}
+    
+    static CacheEntry fromReply(const QNetworkReply *reply);
+    
+    bool isFresh() const {
+        return (!noCache) && (expires.isValid()) && (QDateTime::currentDateTimeUtc() < expires);
+    }
+    
+    bool isStorable() const {
+        return (!noStore) && ((!etag.isEmpty()) || (!lastModified.isEmpty()) || (expires.isValid()));
+    }
+    
+    QByteArray etag;
+    QByteArray lastModified;
+    QDateTime expires;
+    bool noCache;
+    bool noStore;
+    
+    QVariant result;
+    bool valid;
+};
+
+}
+
+#endif // QDAILYMOTION_RESPONSECACHE_P_H
@@ -0,0 +1,417 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resultcache.h"
+#include "json.h"
+#include <QDateTime>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#ifdef QDAILYMOTION_DEBUG
+#include <QDebug>
+#endif
+
+namespace QDailymotion {
+
+static const int TIME_TO_LIVE = 60;
+
+// The approximate memory used by a value, including the overhead of its container
+static int variantCost(const QVariant &value) {
+    switch (value.type()) {
+    case QVariant::String:
+        return 32 + value.toString().size() * 2;
+    case QVariant::ByteArray:
+        return 32 + value.toByteArray().size();
+    case QVariant::StringList: {
+        int cost = 32;
+        
+        foreach (const QString &s, value.toStringList()) {
+            cost += 32 + s.size() * 2;
+        }
+        
+        return cost;
+    }
+    case QVariant::List: {
+        int cost = 32;
+        
+        foreach (const QVariant &v, value.toList()) {
+            cost += variantCost(v);
+        }
+        
+        return cost;
+    }
+    case QVariant::Map: {
+        const QVariantMap map = value.toMap();
+        int cost = 32;
+        
+        for (QVariantMap::const_iterator iterator = map.constBegin(); iterator != map.constEnd(); ++iterator) {
+            cost += 32 + iterator.key().size() * 2 + variantCost(iterator.value());
+        }
+        
+        return cost;
+    }
+    case QVariant::Hash: {
+        const QVariantHash hash = value.toHash();
+        int cost = 32;
+        
+        for (QVariantHash::const_iterator iterator = hash.constBegin(); iterator != hash.constEnd(); ++iterator) {
+            cost += 32 + iterator.key().size() * 2 + variantCost(iterator.value());
+        }
+        
+        return cost;
+    }
+    default:
+        return 16;
+    }
+}
+
+// Returns true if an entry for path is affected by a change to changedPath
+static bool isAffected(const QString &path, const QString &changedPath) {
+    // The resource itself, the resources under it, and the collections containing it
+    return (path == changedPath) || (path.startsWith(changedPath + "/")) || (changedPath.startsWith(path + "/"));
+}
+
+static QString normalizedPath(const QString &resourcePath) {
+    QString path = resourcePath.startsWith("/") ? resourcePath : "/" + resourcePath;
+    
+    while ((path.size() > 1) && (path.endsWith("/"))) {
+        path.chop(1);
+    }
+    
+    return path;
+}
+
+struct CachedResult
+{
+    CachedResult() : cost(0), access(0) {}
+    
+    QVariant result;
+    QString path;
+    QDateTime expires;
+    int cost;
+    qint64 access;
+};
+
+struct ResultCacheData
+{
+    ResultCacheData() :
+        limit(0),
+        timeToLive(TIME_TO_LIVE),
+        size(0),
+        hits(0),
+        misses(0),
+        accessCount(0)
+    {
+    }
+    
+    void remove(const QString &key) {
+        if (entries.contains(key)) {
+            const CachedResult entry = entries.take(key);
+            order.remove(entry.access);
+            size -= entry.cost;
+        }
+    }
+    
+    // Removes the least recently used entries until the cache is within its limit
+    void expire() {
+        while ((size > limit) && (!order.isEmpty())) {
+            remove(order.begin().value());
+        }
+    }
+    
+    QMutex mutex;
+    
+    int limit;
+    int timeToLive;
+    int size;
+    int hits;
+    int misses;
+    
+    qint64 accessCount;
+    
+    QHash<QString, CachedResult> entries;
+    QMap<qint64, QString> order;
+};
+
+Q_GLOBAL_STATIC(ResultCacheData, cacheData)
+
+/*!
+    \class ResultCache
+    \brief Keeps the parsed results of resource requests in memory, so that they can be reused without a 
+    network request or parsing.
+    
+    \ingroup requests
+    
+    The ResultCache is shared by all requests in the process. When it is enabled by setting a cacheLimit, the 
+    results of ResourcesRequest::list() and ResourcesRequest::get() are kept for timeToLive seconds. A later request 
+    with the same resource path, filters, fields and projection, made with the same access token, is then finished 
+    with the cached result, without a network request.
+    
+    When the cache exceeds its limit, the least recently used results are removed. The cost of each result is an 
+    estimate of the memory that it uses.
+    
+    A successful ResourcesRequest::insert(), ResourcesRequest::update() or ResourcesRequest::del() removes the cached 
+    results for the affected resource path, for the resources under it, and for the collections that contain it.
+    
+    Example usage:
+    
+    \code
+    using namespace QDailymotion;
+    
+    ...
+    
+    ResultCache::setCacheLimit(4096);
+    ResultCache::setTimeToLive(300);
+    
+    ...
+    
+    qDebug() << "Cache hits:" << ResultCache::hits() << "misses:" << ResultCache::misses();
+    \endcode
+    
+    All functions are thread-safe.
+    
+    \sa ResponseCache
+*/
+
+/*!
+    \brief Returns the maximum size of the cache in kilobytes.
+    
+    The default value is 0, meaning that the cache is disabled.
+*/
+int ResultCache::cacheLimit() {
+    ResultCacheData *d = cacheData();
+    QMutexLocker locker(&d->mutex);
+    
+    return d->limit / 1024;
+}
+
+/*!
+    \brief Sets the maximum size of the cache to \a kbytes kilobytes.
+    
+    Setting the limit to 0 disables the cache and removes all results from it.
+*/
+void ResultCache::setCacheLimit(int kbytes) {
+    ResultCacheData *d = cacheData();
+    QMutexLocker locker(&d->mutex);
+    
+    d->limit = qMax(0, kbytes) * 1024;
+    d->expire();
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResultCache::setCacheLimit" << kbytes;
+#endif
+}
+
+/*!
+    \brief Returns the number of seconds for which a result is kept.
+    
+    The default value is 60.
+*/
+int ResultCache::timeToLive() {
+    ResultCacheData *d = cacheData();
+    QMutexLocker locker(&d->mutex);
+    
+    return d->timeToLive;
+}
+
+/*!
+    \brief Sets the number of seconds for which a result is kept to \a secs.
+    
+    The new value applies to results that are added to the cache afterwards.
+*/
+void ResultCache::setTimeToLive(int secs) {
+    ResultCacheData *d = cacheData();
+    QMutexLocker locker(&d->mutex);
+    
+    d->timeToLive = qMax(0, secs);
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResultCache::setTimeToLive" << secs;
+#endif
+}
+
+/*!
+    \brief Returns the estimated size of the cached results in bytes.
+*/
+int ResultCache::size() {
+    ResultCacheData *d = cacheData();
+    QMutexLocker locker(&d->mutex);
+    
+    return d->size;
+}
+
+/*!
+    \brief Returns the number of requests that have been finished with a cached result.
+    
+    \sa misses(), resetCounters()
+*/
+int ResultCache::hits() {
+    ResultCacheData *d = cacheData();
+    QMutexLocker locker(&d->mutex);
+    
+    return d->hits;
+}
+
+/*!
+    \brief Returns the number of requests for which there was no cached result, or it had expired.
+    
+    \sa hits(), resetCounters()
+*/
+int ResultCache::misses() {
+    ResultCacheData *d = cacheData();
+    QMutexLocker locker(&d->mutex);
+    
+    return d->misses;
+}
+
+/*!
+    \brief Resets the hits() and misses() counters to 0.
+*/
+void ResultCache::resetCounters() {
+    ResultCacheData *d = cacheData();
+    QMutexLocker locker(&d->mutex);
+    
+    d->hits = 0;
+    d->misses = 0;
+}
+
+/*!
+    \brief Removes the cached results for \a resourcePath, for the resources under it, and for the 
+    collections that contain it.
+    
+    For example, invalidating /playlist/PLAYLIST_ID removes the results for /playlist/PLAYLIST_ID and 
+    /playlist/PLAYLIST_ID/videos.
+*/
+void ResultCache::invalidate(const QString &resourcePath) {
+    ResultCacheData *d = cacheData();
+    QMutexLocker locker(&d->mutex);
+    
+    const QString changedPath = normalizedPath(resourcePath);
+    QStringList keys;
+    
+    for (QHash<QString, CachedResult>::const_iterator iterator = d->entries.constBegin();
+         iterator != d->entries.constEnd(); ++iterator) {
+        if (isAffected(iterator.value().path, changedPath)) {
+            keys << iterator.key();
+        }
+    }
+    
+    foreach (const QString &key, keys) {
+        d->remove(key);
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResultCache::invalidate" << resourcePath << keys.size();
+#endif
+}
+
+/*!
+    \brief Removes all results from the cache.
+*/
+void ResultCache::clear() {
+    ResultCacheData *d = cacheData();
+    QMutexLocker locker(&d->mutex);
+    
+    d->entries.clear();
+    d->order.clear();
+    d->size = 0;
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::ResultCache::clear";
+#endif
+}
+
+/*!
+    \brief Returns the canonical key of a request.
+    
+    The key does not depend on the order of \a fields and \a projection, or on the form of \a resourcePath. 
+    Requests made with different access tokens should pass different values of \a identity.
+*/
+QString ResultCache::key(const QString &method, const QString &resourcePath, const QVariantMap &filters,
+                         const QStringList &fields, const QStringList &projection, const QString &identity) {
+    QStringList sortedFields = fields;
+    sortedFields.removeDuplicates();
+    sortedFields.sort();
+    
+    QStringList sortedProjection = projection;
+    sortedProjection.removeDuplicates();
+    sortedProjection.sort();
+    
+    // The keys of a QVariantMap are sorted, so the filters are serialized in a canonical order
+    return method.toUpper() + " " + normalizedPath(resourcePath) + "\n"
+           + QString::fromUtf8(QtJson::Json::serialize(filters, QtJson::Writer::Compact)) + "\n"
+           + sortedFields.join(",") + "\n" + sortedProjection.join(",") + "\n" + identity;
+}
+
+// Returns true if results are kept, which requires both a cache limit and a time to live
+bool ResultCache::isEnabled() {
+    ResultCacheData *d = cacheData();
+    QMutexLocker locker(&d->mutex);
+    
+    return (d->limit > 0) && (d->timeToLive > 0);
+}
+
+// Finds the result stored under key, returning false if there is none or it has expired
+bool ResultCache::find(const QString &key, QVariant *result) {
+    ResultCacheData *d = cacheData();
+    QMutexLocker locker(&d->mutex);
+    
+    if (!d->limit) {
+        return false;
+    }
+    
+    QHash<QString, CachedResult>::iterator iterator = d->entries.find(key);
+    
+    if ((iterator == d->entries.end()) || (iterator.value().expires <= QDateTime::currentDateTimeUtc())) {
+        d->remove(key);
+        d->misses++;
+        return false;
+    }
+    
+    d->order.remove(iterator.value().access);
+    iterator.value().access = ++d->accessCount;
+    d->order.insert(iterator.value().access, key);
+    d->hits++;
+    *result = iterator.value().result;
+    return true;
+}
+
+// Stores result under key, replacing any existing result
+void ResultCache::insert(const QString &key, const QVariant &result) {
+    ResultCacheData *d = cacheData();
+    QMutexLocker locker(&d->mutex);
+    
+    if ((!d->limit) || (!d->timeToLive)) {
+        return;
+    }
+    
+    d->remove(key);
+    
+    CachedResult entry;
+    entry.result = result;
+    entry.path = key.section('\n', 0, 0).section(' ', 1);
+    entry.expires = QDateTime::currentDateTimeUtc().addSecs(d->timeToLive);
+    entry.cost = key.size() * 2 + variantCost(result);
+    
+    // Results larger than the whole cache are not kept
+    if (entry.cost > d->limit) {
+        return;
+    }
+    
+    entry.access = ++d->accessCount;
+    d->entries.insert(key, entry);
+    d->order.insert(entry.access, key);
+    d->size += entry.cost;
+    d->expire();
+}
+
+}
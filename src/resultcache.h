@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QDAILYMOTION_RESULTCACHE_H
+#define QDAILYMOTION_RESULTCACHE_H
+
+#include "qdailymotion_global.h"
+#include <QStringList>
+#include <QVariantMap>
+
+namespace QDailymotion {
+
+class QDAILYMOTIONSHARED_EXPORT ResultCache
+{
+
+public:
+    static int cacheLimit();
+    static void setCacheLimit(int kbytes);
+    
+    static int timeToLive();
+    static void setTimeToLive(int secs);
+    
+    static int size();
+    
+    static int hits();
+    static int misses();
+    static void resetCounters();
+    
+    static void invalidate(const QString &resourcePath);
+    static void clear();
+    
+    static QString key(const QString &method, const QString &resourcePath, const QVariantMap &filters,
+                       const QStringList &fields, const QStringList &projection = QStringList(),
+                       const QString &identity = QString());
+    
+private:
+    static bool isEnabled();
+    static bool find(const QString &key, QVariant *result);
+    static void insert(const QString &key, const QVariant &result);
+    
+    friend class RequestPrivate;
+};
+
+}
+
+#endif // QDAILYMOTION_RESULTCACHE_H
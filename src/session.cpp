@@ -0,0 +1,656 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "session.h"
+#include "request_p.h"
+#include "requestscheduler.h"
+#include "responsecache.h"
+#include "tokenmanager.h"
+#include "urls.h"
+#include <QNetworkAccessManager>
+#ifdef QDAILYMOTION_DEBUG
+#include <QDebug>
+#endif
+
+namespace QDailymotion {
+
+class SessionPrivate
+{
+
+public:
+    SessionPrivate(Session *parent) :
+        q_ptr(parent),
+        manager(0),
+        ownNetworkAccessManager(false),
+        maximumRedirects(MAX_REDIRECTS),
+        apiUrl(API_URL),
+        maximumAttempts(MAX_ATTEMPTS),
+        retryDelay(RETRY_DELAY),
+        retryNonIdempotent(false),
+        deadline(0),
+        hedging(false)
+    {
+    }
+    
+    Session *q_ptr;
+    
+    QNetworkAccessManager *manager;
+    
+    bool ownNetworkAccessManager;
+    
+    QString clientId;
+    QString clientSecret;
+    QString accessToken;
+    QString refreshToken;
+    
+    QVariantMap headers;
+    
+    int maximumRedirects;
+    
+    QString apiUrl;
+    
+    int maximumAttempts;
+    
+    int retryDelay;
+    
+    bool retryNonIdempotent;
+    
+    int deadline;
+    
+    bool hedging;
+    
+    QPointer<ResponseCache> cache;
+    
+    QPointer<RequestScheduler> scheduler;
+    
+    QPointer<TokenManager> tokenManager;
+    
+    Q_DECLARE_PUBLIC(Session)
+};
+
+/*!
+    \class Session
+    \brief Holds the network access manager, credentials and policy shared by requests and models.
+    
+    \ingroup requests
+    
+    Each Request creates its own QNetworkAccessManager unless one is set, so each request and model would otherwise
+    use its own connections to the Dailymotion Data API. Requests and models that are attached to the same Session
+    use its QNetworkAccessManager, so that keep-alive connections and TLS sessions are reused between them.
+    
+    The credentials of an attached request are those of the session, so setting the access token of the session, or
+    refreshing it in any attached request, updates it for all of them. The headers, maximumRedirects, retry policy, 
+    ResponseCache and RequestScheduler of the session apply to every attached request. When a TokenManager is set, 
+    it holds the credentials instead, and the attached requests share a single refresh of the access token.
+    
+    A session must be used in the thread in which it was created.
+    
+    Example usage:
+    
+    \code
+    using namespace QDailymotion;
+    
+    ...
+    
+    Session *session = new Session(this);
+    session->setClientId(CLIENT_ID);
+    session->setClientSecret(CLIENT_SECRET);
+    session->setAccessToken(ACCESS_TOKEN);
+    session->setRefreshToken(REFRESH_TOKEN);
+    
+    ResourcesModel *model = new ResourcesModel(this);
+    model->setSession(session);
+    
+    ResourcesRequest *request = new ResourcesRequest(this);
+    request->setSession(session);
+    \endcode
+    
+    \sa Request::setSession()
+*/
+Session::Session(QObject *parent) :
+    QObject(parent),
+    d_ptr(new SessionPrivate(this))
+{
+}
+
+Session::~Session() {}
+
+/*!
+    \property QString Session::clientId
+    \brief The client id used by attached requests.
+*/
+
+/*!
+    \fn void Session::clientIdChanged()
+    \brief Emitted when the clientId changes.
+*/
+QString Session::clientId() const {
+    Q_D(const Session);
+    
+    return d->tokenManager ? d->tokenManager->clientId() : d->clientId;
+}
+
+void Session::setClientId(const QString &id) {
+    Q_D(Session);
+    
+    if (d->tokenManager) {
+        // The change is emitted by the token manager
+        d->tokenManager->setClientId(id);
+    }
+    else if (id != d->clientId) {
+        d->clientId = id;
+        emit clientIdChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Session::setClientId" << id;
+#endif
+}
+
+/*!
+    \property QString Session::clientSecret
+    \brief The client secret used by attached requests.
+*/
+
+/*!
+    \fn void Session::clientSecretChanged()
+    \brief Emitted when the clientSecret changes.
+*/
+QString Session::clientSecret() const {
+    Q_D(const Session);
+    
+    return d->tokenManager ? d->tokenManager->clientSecret() : d->clientSecret;
+}
+
+void Session::setClientSecret(const QString &secret) {
+    Q_D(Session);
+    
+    if (d->tokenManager) {
+        d->tokenManager->setClientSecret(secret);
+    }
+    else if (secret != d->clientSecret) {
+        d->clientSecret = secret;
+        emit clientSecretChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Session::setClientSecret" << secret;
+#endif
+}
+
+/*!
+    \property QString Session::accessToken
+    \brief The access token used by attached requests.
+    
+    This is updated when an attached request refreshes the access token.
+    
+    While a TokenManager is set, this is the access token of the token manager.
+*/
+
+/*!
+    \fn void Session::accessTokenChanged()
+    \brief Emitted when the accessToken changes.
+*/
+QString Session::accessToken() const {
+    Q_D(const Session);
+    
+    return d->tokenManager ? d->tokenManager->accessToken() : d->accessToken;
+}
+
+void Session::setAccessToken(const QString &token) {
+    Q_D(Session);
+    
+    if (d->tokenManager) {
+        d->tokenManager->setAccessToken(token);
+    }
+    else if (token != d->accessToken) {
+        d->accessToken = token;
+        emit accessTokenChanged(token);
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Session::setAccessToken" << token;
+#endif
+}
+
+/*!
+    \property QString Session::refreshToken
+    \brief The refresh token used by attached requests.
+*/
+
+/*!
+    \fn void Session::refreshTokenChanged()
+    \brief Emitted when the refreshToken changes.
+*/
+QString Session::refreshToken() const {
+    Q_D(const Session);
+    
+    return d->tokenManager ? d->tokenManager->refreshToken() : d->refreshToken;
+}
+
+void Session::setRefreshToken(const QString &token) {
+    Q_D(Session);
+    
+    if (d->tokenManager) {
+        d->tokenManager->setRefreshToken(token);
+    }
+    else if (token != d->refreshToken) {
+        d->refreshToken = token;
+        emit refreshTokenChanged(token);
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Session::setRefreshToken" << token;
+#endif
+}
+
+/*!
+    \property QVariantMap Session::headers
+    \brief The headers sent with every request of the session.
+    
+    The headers of a request take precedence over these.
+*/
+
+/*!
+    \fn void Session::headersChanged()
+    \brief Emitted when the headers change.
+*/
+QVariantMap Session::headers() const {
+    Q_D(const Session);
+    
+    return d->headers;
+}
+
+void Session::setHeaders(const QVariantMap &headers) {
+    Q_D(Session);
+    
+    if (headers != d->headers) {
+        d->headers = headers;
+        emit headersChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Session::setHeaders" << headers;
+#endif
+}
+
+/*!
+    \property int Session::maximumRedirects
+    \brief The maximum number of redirects that are followed for each request of the session.
+    
+    The default value is 8.
+*/
+
+/*!
+    \fn void Session::maximumRedirectsChanged()
+    \brief Emitted when maximumRedirects changes.
+*/
+int Session::maximumRedirects() const {
+    Q_D(const Session);
+    
+    return d->maximumRedirects;
+}
+
+void Session::setMaximumRedirects(int redirects) {
+    Q_D(Session);
+    
+    if (redirects != d->maximumRedirects) {
+        d->maximumRedirects = redirects;
+        emit maximumRedirectsChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Session::setMaximumRedirects" << redirects;
+#endif
+}
+
+/*!
+    \property QString Session::apiUrl
+    \brief The base URL of the Dailymotion Data API used by attached resources requests.
+    
+    The default value is https://api.dailymotion.com. This can be changed in order to use a proxy or a local 
+    server in place of the Data API.
+*/
+
+/*!
+    \fn void Session::apiUrlChanged()
+    \brief Emitted when the apiUrl changes.
+*/
+QString Session::apiUrl() const {
+    Q_D(const Session);
+    
+    return d->apiUrl;
+}
+
+void Session::setApiUrl(const QString &url) {
+    Q_D(Session);
+    
+    if (url != d->apiUrl) {
+        d->apiUrl = url;
+        emit apiUrlChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Session::setApiUrl" << url;
+#endif
+}
+
+/*!
+    \property int Session::maximumAttempts
+    \brief The maximum number of times that each request of the session is attempted.
+    
+    The default value is 1, meaning that failed requests are not retried.
+    
+    \sa Request::maximumAttempts
+*/
+
+/*!
+    \fn void Session::maximumAttemptsChanged()
+    \brief Emitted when maximumAttempts changes.
+*/
+int Session::maximumAttempts() const {
+    Q_D(const Session);
+    
+    return d->maximumAttempts;
+}
+
+void Session::setMaximumAttempts(int attempts) {
+    Q_D(Session);
+    
+    attempts = qMax(1, attempts);
+    
+    if (attempts != d->maximumAttempts) {
+        d->maximumAttempts = attempts;
+        emit maximumAttemptsChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Session::setMaximumAttempts" << attempts;
+#endif
+}
+
+/*!
+    \property int Session::retryDelay
+    \brief The base delay in milliseconds before the requests of the session are retried.
+    
+    The default value is 1000.
+    
+    \sa Request::retryDelay
+*/
+
+/*!
+    \fn void Session::retryDelayChanged()
+    \brief Emitted when the retryDelay changes.
+*/
+int Session::retryDelay() const {
+    Q_D(const Session);
+    
+    return d->retryDelay;
+}
+
+void Session::setRetryDelay(int msecs) {
+    Q_D(Session);
+    
+    msecs = qMax(0, msecs);
+    
+    if (msecs != d->retryDelay) {
+        d->retryDelay = msecs;
+        emit retryDelayChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Session::setRetryDelay" << msecs;
+#endif
+}
+
+/*!
+    \property bool Session::retryNonIdempotent
+    \brief Whether POST requests of the session are retried.
+    
+    The default value is false.
+    
+    \sa Request::retryNonIdempotent
+*/
+
+/*!
+    \fn void Session::retryNonIdempotentChanged()
+    \brief Emitted when retryNonIdempotent changes.
+*/
+bool Session::retryNonIdempotent() const {
+    Q_D(const Session);
+    
+    return d->retryNonIdempotent;
+}
+
+void Session::setRetryNonIdempotent(bool enabled) {
+    Q_D(Session);
+    
+    if (enabled != d->retryNonIdempotent) {
+        d->retryNonIdempotent = enabled;
+        emit retryNonIdempotentChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Session::setRetryNonIdempotent" << enabled;
+#endif
+}
+
+/*!
+    \property int Session::deadline
+    \brief The time in milliseconds within which each operation of the requests of the session must finish.
+    
+    The default value is 0, meaning that operations have no deadline.
+    
+    \sa Request::deadline
+*/
+
+/*!
+    \fn void Session::deadlineChanged()
+    \brief Emitted when the deadline changes.
+*/
+int Session::deadline() const {
+    Q_D(const Session);
+    
+    return d->deadline;
+}
+
+void Session::setDeadline(int msecs) {
+    Q_D(Session);
+    
+    msecs = qMax(0, msecs);
+    
+    if (msecs != d->deadline) {
+        d->deadline = msecs;
+        emit deadlineChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Session::setDeadline" << msecs;
+#endif
+}
+
+/*!
+    \property bool Session::hedging
+    \brief Whether slow GET requests of the session are hedged with a second attempt.
+    
+    The default value is false.
+    
+    \sa Request::hedging
+*/
+
+/*!
+    \fn void Session::hedgingChanged()
+    \brief Emitted when hedging changes.
+*/
+bool Session::hedging() const {
+    Q_D(const Session);
+    
+    return d->hedging;
+}
+
+void Session::setHedging(bool enabled) {
+    Q_D(Session);
+    
+    if (enabled != d->hedging) {
+        d->hedging = enabled;
+        emit hedgingChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Session::setHedging" << enabled;
+#endif
+}
+
+/*!
+    \brief Returns the QNetworkAccessManager instance used by attached requests.
+    
+    If no QNetworkAccessManager has been set, one is created and owned by the session.
+*/
+QNetworkAccessManager* Session::networkAccessManager() {
+    Q_D(Session);
+    
+    if (!d->manager) {
+        d->ownNetworkAccessManager = true;
+        d->manager = new QNetworkAccessManager(this);
+    }
+    
+    return d->manager;
+}
+
+/*!
+    \brief Sets the QNetworkAccessManager instance to be used by attached requests.
+    
+    Session does not take ownership of \a manager.
+*/
+void Session::setNetworkAccessManager(QNetworkAccessManager *manager) {
+    Q_D(Session);
+    
+    if ((d->manager) && (d->ownNetworkAccessManager)) {
+        delete d->manager;
+    }
+    
+    d->ownNetworkAccessManager = false;
+    d->manager = manager;
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Session::setNetworkAccessManager" << manager;
+#endif
+}
+
+/*!
+    \brief Returns the ResponseCache used by attached requests, or 0 if none is set.
+*/
+ResponseCache* Session::responseCache() const {
+    Q_D(const Session);
+    
+    return d->cache;
+}
+
+/*!
+    \brief Sets the ResponseCache to be used by attached requests.
+    
+    Session does not take ownership of \a cache.
+    
+    \sa Request::cachePolicy
+*/
+void Session::setResponseCache(ResponseCache *cache) {
+    Q_D(Session);
+    
+    d->cache = cache;
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Session::setResponseCache" << cache;
+#endif
+}
+
+/*!
+    \brief Returns the RequestScheduler used by attached requests, or 0 if none is set.
+*/
+RequestScheduler* Session::scheduler() const {
+    Q_D(const Session);
+    
+    return d->scheduler;
+}
+
+/*!
+    \brief Sets the RequestScheduler to be used by attached requests.
+    
+    Session does not take ownership of \a scheduler.
+    
+    \sa Request::priority
+*/
+void Session::setScheduler(RequestScheduler *scheduler) {
+    Q_D(Session);
+    
+    d->scheduler = scheduler;
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Session::setScheduler" << scheduler;
+#endif
+}
+
+/*!
+    \brief Returns the TokenManager used by attached requests, or 0 if none is set.
+*/
+TokenManager* Session::tokenManager() const {
+    Q_D(const Session);
+    
+    return d->tokenManager;
+}
+
+/*!
+    \brief Sets the TokenManager that holds the credentials of the session and refreshes its access token.
+    
+    While a token manager is set, the credentials of the session are those of the token manager, and only one 
+    refresh of the access token is made at a time for all of the attached requests.
+    
+    Session does not take ownership of \a manager.
+    
+    \sa Request::setTokenManager()
+*/
+void Session::setTokenManager(TokenManager *manager) {
+    Q_D(Session);
+    
+    if (manager == d->tokenManager) {
+        return;
+    }
+    
+    const QString id = clientId();
+    const QString secret = clientSecret();
+    const QString token = accessToken();
+    const QString refresh = refreshToken();
+    
+    if (d->tokenManager) {
+        disconnect(d->tokenManager, 0, this, 0);
+    }
+    
+    d->tokenManager = manager;
+    
+    if (manager) {
+        connect(manager, SIGNAL(clientIdChanged()), this, SIGNAL(clientIdChanged()));
+        connect(manager, SIGNAL(clientSecretChanged()), this, SIGNAL(clientSecretChanged()));
+        connect(manager, SIGNAL(accessTokenChanged(QString)), this, SIGNAL(accessTokenChanged(QString)));
+        connect(manager, SIGNAL(refreshTokenChanged(QString)), this, SIGNAL(refreshTokenChanged(QString)));
+    }
+    
+    if (clientId() != id) {
+        emit clientIdChanged();
+    }
+    
+    if (clientSecret() != secret) {
+        emit clientSecretChanged();
+    }
+    
+    if (accessToken() != token) {
+        emit accessTokenChanged(accessToken());
+    }
+    
+    if (refreshToken() != refresh) {
+        emit refreshTokenChanged(refreshToken());
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::Session::setTokenManager" << manager;
+#endif
+}
+
+}
+
+#include "moc_session.cpp"
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QDAILYMOTION_SESSION_H
+#define QDAILYMOTION_SESSION_H
+
+#include "qdailymotion_global.h"
+#include <QObject>
+#include <QVariantMap>
+
+class QNetworkAccessManager;
+
+namespace QDailymotion {
+
+class RequestScheduler;
+class ResponseCache;
+class TokenManager;
+class SessionPrivate;
+
+class QDAILYMOTIONSHARED_EXPORT Session : public QObject
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(QString clientId READ clientId WRITE setClientId NOTIFY clientIdChanged)
+    Q_PROPERTY(QString clientSecret READ clientSecret WRITE setClientSecret NOTIFY clientSecretChanged)
+    Q_PROPERTY(QString accessToken READ accessToken WRITE setAccessToken NOTIFY accessTokenChanged)
+    Q_PROPERTY(QString refreshToken READ refreshToken WRITE setRefreshToken NOTIFY refreshTokenChanged)
+    Q_PROPERTY(QVariantMap headers READ headers WRITE setHeaders NOTIFY headersChanged)
+    Q_PROPERTY(int maximumRedirects READ maximumRedirects WRITE setMaximumRedirects NOTIFY maximumRedirectsChanged)
+    Q_PROPERTY(QString apiUrl READ apiUrl WRITE setApiUrl NOTIFY apiUrlChanged)
+    Q_PROPERTY(int maximumAttempts READ maximumAttempts WRITE setMaximumAttempts NOTIFY maximumAttemptsChanged)
+    Q_PROPERTY(int retryDelay READ retryDelay WRITE setRetryDelay NOTIFY retryDelayChanged)
+    Q_PROPERTY(bool retryNonIdempotent READ retryNonIdempotent WRITE setRetryNonIdempotent
+               NOTIFY retryNonIdempotentChanged)
+    Q_PROPERTY(int deadline READ deadline WRITE setDeadline NOTIFY deadlineChanged)
+    Q_PROPERTY(bool hedging READ hedging WRITE setHedging NOTIFY hedgingChanged)
+    
+public:
+    explicit Session(QObject *parent = 0);
+    ~Session();
+    
+    QString clientId() const;
+    void setClientId(const QString &id);
+    
+    QString clientSecret() const;
+    void setClientSecret(const QString &secret);
+    
+    QString accessToken() const;
+    void setAccessToken(const QString &token);
+    
+    QString refreshToken() const;
+    void setRefreshToken(const QString &token);
+    
+    QVariantMap headers() const;
+    void setHeaders(const QVariantMap &headers);
+    
+    int maximumRedirects() const;
+    void setMaximumRedirects(int redirects);
+    
+    QString apiUrl() const;
+    void setApiUrl(const QString &url);
+    
+    int maximumAttempts() const;
+    void setMaximumAttempts(int attempts);
+    
+    int retryDelay() const;
+    void setRetryDelay(int msecs);
+    
+    bool retryNonIdempotent() const;
+    void setRetryNonIdempotent(bool enabled);
+    
+    int deadline() const;
+    void setDeadline(int msecs);
+    
+    bool hedging() const;
+    void setHedging(bool enabled);
+    
+    QNetworkAccessManager* networkAccessManager();
+    void setNetworkAccessManager(QNetworkAccessManager *manager);
+    
+    ResponseCache* responseCache() const;
+    void setResponseCache(ResponseCache *cache);
+    
+    RequestScheduler* scheduler() const;
+    void setScheduler(RequestScheduler *scheduler);
+    
+    TokenManager* tokenManager() const;
+    void setTokenManager(TokenManager *manager);
+    
+Q_SIGNALS:
+    void clientIdChanged();
+    void clientSecretChanged();
+    void accessTokenChanged(const QString &token);
+    void refreshTokenChanged(const QString &token);
+    void headersChanged();
+    void maximumRedirectsChanged();
+    void apiUrlChanged();
+    void maximumAttemptsChanged();
+    void retryDelayChanged();
+    void retryNonIdempotentChanged();
+    void deadlineChanged();
+    void hedgingChanged();
+    
+protected:
+    QScopedPointer<SessionPrivate> d_ptr;
+    
+    Q_DECLARE_PRIVATE(Session)
+    
+private:
+    Q_DISABLE_COPY(Session)
+};
+
+}
+
+#endif // QDAILYMOTION_SESSION_H
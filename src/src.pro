@@ -6,42 +6,70 @@ TEMPLATE = lib
 QT += network
 QT -= gui
 
+greaterThan(QT_MAJOR_VERSION, 4): QT += concurrent
+
 TARGET = qdailymotion
 DESTDIR = ../lib
 
 HEADERS += \
     authenticationrequest.h \
+    entities.h \
     json.h \
+    jsonscan_p.h \
     model.h \
     model_p.h \
     qdailymotion_global.h \
     request.h \
     request_p.h \
+    requestscheduler.h \
+    resourcesloader.h \
     resourcesmodel.h \
     resourcesrequest.h \
+    resourcesrequest_p.h \
+    responsecache.h \
+    responsecache_p.h \
+    resultcache.h \
+    session.h \
     streamsmodel.h \
     streamsrequest.h \
+    tokenmanager.h \
     urls.h
 
 SOURCES += \
     authenticationrequest.cpp \
+    entities.cpp \
     json.cpp \
+    jsonscan.cpp \
     model.cpp \
     request.cpp \
+    requestscheduler.cpp \
+    resourcesloader.cpp \
     resourcesmodel.cpp \
     resourcesrequest.cpp \
+    responsecache.cpp \
+    resultcache.cpp \
+    session.cpp \
     streamsmodel.cpp \
-    streamsrequest.cpp
+    streamsrequest.cpp \
+    tokenmanager.cpp
     
 headers.files += \
     authenticationrequest.h \
+    entities.h \
+    json.h \
     model.h \
     qdailymotion_global.h \
     request.h \
+    requestscheduler.h \
+    resourcesloader.h \
     resourcesmodel.h \
     resourcesrequest.h \
+    responsecache.h \
+    resultcache.h \
+    session.h \
     streamsmodel.h \
     streamsrequest.h \
+    tokenmanager.h \
     urls.h
     
 symbian {
@@ -241,6 +241,30 @@ void StreamsModel::setNetworkAccessManager(QNetworkAccessManager *manager) {
     d->request->setNetworkAccessManager(manager);
 }
 
+/*!
+    \brief Returns the Session to which the model is attached, or 0 if it is not attached to a session.
+    
+    \sa StreamsRequest::session()
+*/
+Session* StreamsModel::session() const {
+    Q_D(const StreamsModel);
+    
+    return d->request->session();
+}
+
+/*!
+    \brief Attaches the model to \a session.
+    
+    StreamsModel does not take ownership of \a session.
+    
+    \sa StreamsRequest::setSession()
+*/
+void StreamsModel::setSession(Session *session) {
+    Q_D(StreamsModel);
+    
+    d->request->setSession(session);
+}
+
 /*!
     \brief Retrieves a list of streams for a Dailymotion video.
     
@@ -54,6 +54,9 @@ public:
     
     void setNetworkAccessManager(QNetworkAccessManager *manager);
     
+    Session* session() const;
+    void setSession(Session *session);
+    
 public Q_SLOTS:
     void list(const QString &id);
         
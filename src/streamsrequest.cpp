@@ -70,6 +70,12 @@ public:
     StreamsRequestPrivate(StreamsRequest *parent) :
         RequestPrivate(parent)
     {
+        // A hedged GET would parse the embed page as JSON
+        hedgeGets = false;
+    }
+    
+    void _q_onReplyReadyRead() {
+        // The config is extracted from the complete embed page in _q_onReplyFinished()
     }
     
     void _q_onReplyFinished() {
@@ -79,7 +85,7 @@ public:
     
         Q_Q(StreamsRequest);
         
-        const QString response = reply->readAll();
+        const QByteArray response = reply->readAll();
         const QNetworkReply::NetworkError e = reply->error();
         const QString es = reply->errorString();
         reply->deleteLater();
@@ -102,9 +108,18 @@ public:
             return;
         }
         
+        const QByteArray marker("var config =");
+        const int start = response.lastIndexOf(marker);
+        QByteArray config = (start == -1 ? response : response.mid(start + marker.size()));
+        
+        const int end = config.indexOf(";\n");
+        
+        if (end != -1) {
+            config.truncate(end);
+        }
+        
         bool ok;
-        const QVariantMap info = QtJson::Json::parse(response.section("var config =", -1)
-                                                     .section(";\n", 0, 0).trimmed(), ok).toMap();
+        const QVariantMap info = QtJson::Json::parse(config.trimmed(), ok).toMap();
   
         if (ok) {
             const QVariantMap metadata = info.value("metadata").toMap();
@@ -0,0 +1,560 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tokenmanager.h"
+#include "json.h"
+#include "request.h"
+#include "urls.h"
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QPointer>
+#include <QTimer>
+#ifdef QDAILYMOTION_DEBUG
+#include <QDebug>
+#endif
+
+namespace QDailymotion {
+
+static const int REFRESH_MARGIN = 60;
+
+class TokenManagerPrivate
+{
+
+public:
+    TokenManagerPrivate(TokenManager *parent) :
+        q_ptr(parent),
+        manager(0),
+        ownNetworkAccessManager(false),
+        refreshMargin(REFRESH_MARGIN),
+        reply(0),
+        failed(false)
+    {
+        timer.setSingleShot(true);
+    }
+    
+    bool isExpired() const {
+        return (expiryTime.isValid()) && (QDateTime::currentDateTimeUtc() >= expiryTime);
+    }
+    
+    // Schedules a refresh of the access token shortly before it expires, but not before half of its lifetime has
+    // passed, so that a token that is issued for less than the margin is not refreshed continuously
+    void scheduleRefresh() {
+        timer.stop();
+        
+        if ((!expiryTime.isValid()) || (refreshToken.isEmpty())) {
+            return;
+        }
+        
+        const qint64 remaining = QDateTime::currentDateTimeUtc().msecsTo(expiryTime);
+        const qint64 msecs = qMax(remaining - qint64(refreshMargin) * 1000, remaining / 2);
+        timer.start(int(qBound(Q_INT64_C(0), msecs, Q_INT64_C(0x7fffffff))));
+    }
+    
+    // Tells the waiting requests that the refresh has finished
+    void notify(int error, const QString &errorString) {
+        const QList< QPointer<Request> > requests = waiting;
+        waiting.clear();
+        
+        foreach (const QPointer<Request> &request, requests) {
+            if (request) {
+                QMetaObject::invokeMethod(request, "_q_onTokenRefreshed", Qt::QueuedConnection, Q_ARG(int, error),
+                                          Q_ARG(QString, errorString));
+            }
+        }
+    }
+    
+    void _q_onRefreshFinished() {
+        if (!reply) {
+            return;
+        }
+        
+        Q_Q(TokenManager);
+        
+        bool ok;
+        const QVariantMap result = QtJson::Json::parse(reply->readAll(), ok).toMap();
+        const QNetworkReply::NetworkError e = reply->error();
+        const QString es = reply->errorString();
+        reply->deleteLater();
+        reply = 0;
+        
+        int error = Request::NoError;
+        QString errorString;
+        
+        if (e != QNetworkReply::NoError) {
+            error = e;
+            errorString = es;
+        }
+        else if (!ok) {
+            error = Request::ParseError;
+            errorString = Request::tr("Unable to parse response");
+        }
+        else {
+            const QString token = result.value("access_token").toString();
+            
+            if (token.isEmpty()) {
+                error = Request::ContentAccessDenied;
+                errorString = Request::tr("Unable to refresh access token");
+            }
+            else {
+                q->setAccessToken(token);
+                
+                // The expiry of the previous access token does not apply to the new one, so the refresh token is 
+                // only set once it has been replaced
+                if (result.contains("expires_in")) {
+                    q->setExpiresIn(result.value("expires_in").toInt());
+                }
+                else {
+                    q->setExpiryTime(QDateTime());
+                }
+                
+                // The server can issue a new refresh token, which replaces the one that has been used
+                const QString refresh = result.value("refresh_token").toString();
+                
+                if (!refresh.isEmpty()) {
+                    q->setRefreshToken(refresh);
+                }
+            }
+        }
+#ifdef QDAILYMOTION_DEBUG
+        qDebug() << "QDailymotion::TokenManagerPrivate::_q_onRefreshFinished" << error << errorString;
+#endif
+        failed = (error != Request::NoError);
+        emit q->refreshingChanged();
+        notify(error, errorString);
+        
+        if (error == Request::NoError) {
+            emit q->refreshed();
+        }
+        else {
+            emit q->refreshFailed(errorString);
+        }
+    }
+    
+    TokenManager *q_ptr;
+    
+    QNetworkAccessManager *manager;
+    
+    bool ownNetworkAccessManager;
+    
+    QString clientId;
+    QString clientSecret;
+    QString accessToken;
+    QString refreshToken;
+    
+    QDateTime expiryTime;
+    
+    int refreshMargin;
+    
+    QTimer timer;
+    
+    // The refresh in flight, and the requests that are waiting for it
+    QNetworkReply *reply;
+    QList< QPointer<Request> > waiting;
+    
+    // Whether the last refresh failed, in which case requests are no longer held back for an expired token
+    bool failed;
+    
+    Q_DECLARE_PUBLIC(TokenManager)
+};
+
+/*!
+    \class TokenManager
+    \brief Holds the credentials shared by requests, and refreshes their access token.
+    
+    \ingroup requests
+    
+    Requests that use the same TokenManager share its credentials, and share each refresh of the access token.
+    Only one refresh is made at a time. When a request is refused because its access token has expired, it
+    waits for the refresh that is in flight, or starts one, and is then made again with the new access token.
+    Requests that are made while a refresh is in flight, or after the access token has expired, wait for the
+    refresh before they are sent.
+    
+    When the expiryTime of the access token is known, it is refreshed refreshMargin seconds before it expires, so
+    that requests are not refused. The expiryTime is updated from the expires_in value of each refresh.
+    
+    A token manager must be used in the thread in which it was created.
+    
+    Example usage:
+    
+    \code
+    using namespace QDailymotion;
+    
+    ...
+    
+    TokenManager *tokens = new TokenManager(this);
+    tokens->setClientId(CLIENT_ID);
+    tokens->setClientSecret(CLIENT_SECRET);
+    tokens->setAccessToken(ACCESS_TOKEN);
+    tokens->setRefreshToken(REFRESH_TOKEN);
+    tokens->setExpiresIn(EXPIRES_IN);
+    session->setTokenManager(tokens);
+    \endcode
+    
+    \sa Session::setTokenManager(), Request::setTokenManager()
+*/
+TokenManager::TokenManager(QObject *parent) :
+    QObject(parent),
+    d_ptr(new TokenManagerPrivate(this))
+{
+    Q_D(TokenManager);
+    
+    connect(&d->timer, SIGNAL(timeout()), this, SLOT(refresh()));
+}
+
+TokenManager::~TokenManager() {
+    Q_D(TokenManager);
+    
+    if (d->reply) {
+        d->reply->disconnect(this);
+        d->reply->abort();
+        d->reply->deleteLater();
+        d->reply = 0;
+    }
+    
+    // Waiting requests are sent with the current access token
+    d->notify(Request::NoError, QString());
+}
+
+/*!
+    \property QString TokenManager::clientId
+    \brief The client id used when refreshing the access token.
+*/
+
+/*!
+    \fn void TokenManager::clientIdChanged()
+    \brief Emitted when the clientId changes.
+*/
+QString TokenManager::clientId() const {
+    Q_D(const TokenManager);
+    
+    return d->clientId;
+}
+
+void TokenManager::setClientId(const QString &id) {
+    Q_D(TokenManager);
+    
+    if (id != d->clientId) {
+        d->clientId = id;
+        emit clientIdChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::TokenManager::setClientId" << id;
+#endif
+}
+
+/*!
+    \property QString TokenManager::clientSecret
+    \brief The client secret used when refreshing the access token.
+*/
+
+/*!
+    \fn void TokenManager::clientSecretChanged()
+    \brief Emitted when the clientSecret changes.
+*/
+QString TokenManager::clientSecret() const {
+    Q_D(const TokenManager);
+    
+    return d->clientSecret;
+}
+
+void TokenManager::setClientSecret(const QString &secret) {
+    Q_D(TokenManager);
+    
+    if (secret != d->clientSecret) {
+        d->clientSecret = secret;
+        emit clientSecretChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::TokenManager::setClientSecret" << secret;
+#endif
+}
+
+/*!
+    \property QString TokenManager::accessToken
+    \brief The access token used by the requests of the token manager.
+*/
+
+/*!
+    \fn void TokenManager::accessTokenChanged()
+    \brief Emitted when the accessToken changes.
+*/
+QString TokenManager::accessToken() const {
+    Q_D(const TokenManager);
+    
+    return d->accessToken;
+}
+
+void TokenManager::setAccessToken(const QString &token) {
+    Q_D(TokenManager);
+    
+    if (token != d->accessToken) {
+        d->accessToken = token;
+        d->failed = false;
+        emit accessTokenChanged(token);
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::TokenManager::setAccessToken" << token;
+#endif
+}
+
+/*!
+    \property QString TokenManager::refreshToken
+    \brief The refresh token used when refreshing the access token.
+*/
+
+/*!
+    \fn void TokenManager::refreshTokenChanged()
+    \brief Emitted when the refreshToken changes.
+*/
+QString TokenManager::refreshToken() const {
+    Q_D(const TokenManager);
+    
+    return d->refreshToken;
+}
+
+void TokenManager::setRefreshToken(const QString &token) {
+    Q_D(TokenManager);
+    
+    if (token != d->refreshToken) {
+        d->refreshToken = token;
+        d->failed = false;
+        d->scheduleRefresh();
+        emit refreshTokenChanged(token);
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::TokenManager::setRefreshToken" << token;
+#endif
+}
+
+/*!
+    \property QDateTime TokenManager::expiryTime
+    \brief The time at which the access token expires.
+    
+    The default value is an invalid QDateTime, meaning that the access token is only refreshed once a request
+    has been refused.
+    
+    \sa setExpiresIn(), refreshMargin
+*/
+
+/*!
+    \fn void TokenManager::expiryTimeChanged()
+    \brief Emitted when the expiryTime changes.
+*/
+QDateTime TokenManager::expiryTime() const {
+    Q_D(const TokenManager);
+    
+    return d->expiryTime;
+}
+
+void TokenManager::setExpiryTime(const QDateTime &time) {
+    Q_D(TokenManager);
+    
+    const QDateTime utc = time.toUTC();
+    
+    if (utc != d->expiryTime) {
+        d->expiryTime = utc;
+        d->scheduleRefresh();
+        emit expiryTimeChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::TokenManager::setExpiryTime" << utc;
+#endif
+}
+
+/*!
+    \brief Sets the expiryTime to \a secs seconds from now.
+    
+    This is the expires_in value of the response that issued the access token.
+*/
+void TokenManager::setExpiresIn(int secs) {
+    setExpiryTime(QDateTime::currentDateTimeUtc().addSecs(secs));
+}
+
+/*!
+    \property int TokenManager::refreshMargin
+    \brief The number of seconds before the expiryTime at which the access token is refreshed.
+    
+    The default value is 60.
+*/
+
+/*!
+    \fn void TokenManager::refreshMarginChanged()
+    \brief Emitted when the refreshMargin changes.
+*/
+int TokenManager::refreshMargin() const {
+    Q_D(const TokenManager);
+    
+    return d->refreshMargin;
+}
+
+void TokenManager::setRefreshMargin(int secs) {
+    Q_D(TokenManager);
+    
+    secs = qMax(0, secs);
+    
+    if (secs != d->refreshMargin) {
+        d->refreshMargin = secs;
+        d->scheduleRefresh();
+        emit refreshMarginChanged();
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::TokenManager::setRefreshMargin" << secs;
+#endif
+}
+
+/*!
+    \property bool TokenManager::refreshing
+    \brief Whether a refresh of the access token is in flight.
+*/
+
+/*!
+    \fn void TokenManager::refreshingChanged()
+    \brief Emitted when refreshing changes.
+*/
+bool TokenManager::isRefreshing() const {
+    Q_D(const TokenManager);
+    
+    return d->reply != 0;
+}
+
+/*!
+    \brief Returns the QNetworkAccessManager instance used when refreshing the access token.
+    
+    If no QNetworkAccessManager has been set, one is created and owned by the token manager.
+*/
+QNetworkAccessManager* TokenManager::networkAccessManager() {
+    Q_D(TokenManager);
+    
+    if (!d->manager) {
+        d->ownNetworkAccessManager = true;
+        d->manager = new QNetworkAccessManager(this);
+    }
+    
+    return d->manager;
+}
+
+/*!
+    \brief Sets the QNetworkAccessManager instance to be used when refreshing the access token.
+    
+    TokenManager does not take ownership of \a manager.
+*/
+void TokenManager::setNetworkAccessManager(QNetworkAccessManager *manager) {
+    Q_D(TokenManager);
+    
+    if ((d->manager) && (d->ownNetworkAccessManager)) {
+        delete d->manager;
+    }
+    
+    d->ownNetworkAccessManager = false;
+    d->manager = manager;
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::TokenManager::setNetworkAccessManager" << manager;
+#endif
+}
+
+/*!
+    \brief Refreshes the access token.
+    
+    Nothing is done if a refresh is already in flight, or there is no refresh token.
+    
+    \sa refreshed(), refreshFailed()
+*/
+
+/*!
+    \fn void TokenManager::refreshed()
+    \brief Emitted when the access token has been refreshed.
+*/
+
+/*!
+    \fn void TokenManager::refreshFailed(const QString &errorString)
+    \brief Emitted when the access token could not be refreshed.
+*/
+void TokenManager::refresh() {
+    Q_D(TokenManager);
+    
+    if ((d->reply) || (d->refreshToken.isEmpty())) {
+        return;
+    }
+#ifdef QDAILYMOTION_DEBUG
+    qDebug() << "QDailymotion::TokenManager::refresh";
+#endif
+    QNetworkRequest request(TOKEN_URL);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
+    const QString body("client_id=" + d->clientId + "&client_secret=" + d->clientSecret + "&refresh_token=" +
+                       d->refreshToken + "&grant_type=" + GRANT_TYPE_REFRESH);
+    
+    d->timer.stop();
+    d->reply = networkAccessManager()->post(request, body.toUtf8());
+    connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onRefreshFinished()));
+    emit refreshingChanged();
+}
+
+// Returns true if request must wait for a refresh before it is sent. The request is then told when the refresh
+// has finished, in its _q_onTokenRefreshed() slot.
+bool TokenManager::waitFor(Request *request) {
+    Q_D(TokenManager);
+    
+    if (!d->reply) {
+        if ((!d->isExpired()) || (d->refreshToken.isEmpty()) || (d->failed)) {
+            return false;
+        }
+        
+        refresh();
+    }
+    
+    d->waiting.append(request);
+    return true;
+}
+
+// Refreshes the access token for request, which has been refused with token. The request is told when a newer
+// access token is available, in its _q_onTokenRefreshed() slot.
+void TokenManager::refreshFor(Request *request, const QString &token) {
+    Q_D(TokenManager);
+    
+    if (!d->reply) {
+        // Another request has already refreshed the access token since this one was sent
+        if ((!d->accessToken.isEmpty()) && (token != d->accessToken)) {
+            QMetaObject::invokeMethod(request, "_q_onTokenRefreshed", Qt::QueuedConnection,
+                                      Q_ARG(int, Request::NoError), Q_ARG(QString, QString()));
+            return;
+        }
+        
+        if (d->refreshToken.isEmpty()) {
+            QMetaObject::invokeMethod(request, "_q_onTokenRefreshed", Qt::QueuedConnection,
+                                      Q_ARG(int, Request::AuthenticationRequiredError),
+                                      Q_ARG(QString, Request::tr("Unable to refresh access token")));
+            return;
+        }
+    }
+    
+    d->waiting.append(request);
+    refresh();
+}
+
+// Removes request from the requests that are waiting for a refresh
+void TokenManager::remove(Request *request) {
+    Q_D(TokenManager);
+    
+    for (int i = d->waiting.size() - 1; i >= 0; i--) {
+        if ((!d->waiting.at(i)) || (d->waiting.at(i) == request)) {
+            d->waiting.removeAt(i);
+        }
+    }
+}
+
+}
+
+#include "moc_tokenmanager.cpp"
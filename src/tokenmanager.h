@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QDAILYMOTION_TOKENMANAGER_H
+#define QDAILYMOTION_TOKENMANAGER_H
+
+#include "qdailymotion_global.h"
+#include <QObject>
+#include <QDateTime>
+
+class QNetworkAccessManager;
+
+namespace QDailymotion {
+
+class Request;
+class TokenManagerPrivate;
+
+class QDAILYMOTIONSHARED_EXPORT TokenManager : public QObject
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(QString clientId READ clientId WRITE setClientId NOTIFY clientIdChanged)
+    Q_PROPERTY(QString clientSecret READ clientSecret WRITE setClientSecret NOTIFY clientSecretChanged)
+    Q_PROPERTY(QString accessToken READ accessToken WRITE setAccessToken NOTIFY accessTokenChanged)
+    Q_PROPERTY(QString refreshToken READ refreshToken WRITE setRefreshToken NOTIFY refreshTokenChanged)
+    Q_PROPERTY(QDateTime expiryTime READ expiryTime WRITE setExpiryTime NOTIFY expiryTimeChanged)
+    Q_PROPERTY(int refreshMargin READ refreshMargin WRITE setRefreshMargin NOTIFY refreshMarginChanged)
+    Q_PROPERTY(bool refreshing READ isRefreshing NOTIFY refreshingChanged)
+    
+public:
+    explicit TokenManager(QObject *parent = 0);
+    ~TokenManager();
+    
+    QString clientId() const;
+    void setClientId(const QString &id);
+    
+    QString clientSecret() const;
+    void setClientSecret(const QString &secret);
+    
+    QString accessToken() const;
+    void setAccessToken(const QString &token);
+    
+    QString refreshToken() const;
+    void setRefreshToken(const QString &token);
+    
+    QDateTime expiryTime() const;
+    void setExpiryTime(const QDateTime &time);
+    void setExpiresIn(int secs);
+    
+    int refreshMargin() const;
+    void setRefreshMargin(int secs);
+    
+    bool isRefreshing() const;
+    
+    QNetworkAccessManager* networkAccessManager();
+    void setNetworkAccessManager(QNetworkAccessManager *manager);
+    
+public Q_SLOTS:
+    void refresh();
+    
+Q_SIGNALS:
+    void clientIdChanged();
+    void clientSecretChanged();
+    void accessTokenChanged(const QString &token);
+    void refreshTokenChanged(const QString &token);
+    void expiryTimeChanged();
+    void refreshMarginChanged();
+    void refreshingChanged();
+    void refreshed();
+    void refreshFailed(const QString &errorString);
+    
+protected:
+    QScopedPointer<TokenManagerPrivate> d_ptr;
+    
+    Q_DECLARE_PRIVATE(TokenManager)
+    
+    Q_PRIVATE_SLOT(d_func(), void _q_onRefreshFinished())
+    
+private:
+    bool waitFor(Request *request);
+    void refreshFor(Request *request, const QString &token);
+    void remove(Request *request);
+    
+    friend class RequestPrivate;
+    
+    Q_DISABLE_COPY(TokenManager)
+};
+
+}
+
+#endif // QDAILYMOTION_TOKENMANAGER_H
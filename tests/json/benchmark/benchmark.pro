@@ -0,0 +1,15 @@
+TEMPLATE = app
+TARGET = json-benchmark
+INSTALLS += target
+
+QT += testlib
+QT -= gui
+
+INCLUDEPATH += ../../../src
+LIBS += -L../../../lib -lqdailymotion
+RESOURCES += corpus.qrc
+SOURCES += main.cpp
+
+unix {
+    target.path = /opt/qdailymotion/bin
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "json.h"
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QtTest>
+#if defined(Q_OS_LINUX) && defined(__GLIBC__)
+#define COUNT_ALLOCATIONS
+
+// Count every heap allocation in the process, including those made by Qt
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+// Allocations are counted atomically, since they can be made in any thread
+static QAtomicInt allocations;
+
+static int allocationCount() {
+#if QT_VERSION >= 0x050000
+    return allocations.loadAcquire();
+#else
+    return allocations;
+#endif
+}
+
+extern "C" void *malloc(size_t size) __THROW {
+    allocations.fetchAndAddRelaxed(1);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) __THROW {
+    allocations.fetchAndAddRelaxed(1);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) __THROW {
+    allocations.fetchAndAddRelaxed(1);
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+static const int MIN_MEASURE_MSECS = 250;
+
+// Synthetic documents shaped like API responses, and like the config blob of an embed page as used by StreamsRequest
+static const char* CORPUS[] = { "get", "list", "nested", "escapes", "config" };
+
+class JsonBenchmark : public QObject
+{
+    Q_OBJECT
+    
+private:
+    static QByteArray document(const QString &name) {
+        QFile file(QString(":/corpus/%1.json").arg(name));
+        file.open(QIODevice::ReadOnly);
+        return file.readAll();
+    }
+    
+    // Repeat an operation on one document, and report its throughput and allocations
+    template <typename Operation>
+    static void measure(const char *name, const QString &corpus, int size, Operation operation) {
+        int runs = 0;
+        QElapsedTimer timer;
+        timer.start();
+#ifdef COUNT_ALLOCATIONS
+        const int before = allocationCount();
+#endif
+        do {
+            operation();
+            runs++;
+        } while (timer.elapsed() < MIN_MEASURE_MSECS);
+        
+        const double seconds = double(timer.nsecsElapsed()) / 1000000000;
+        const double mbps = double(size) * runs / (1024 * 1024) / seconds;
+#ifdef COUNT_ALLOCATIONS
+        const qint64 perDocument = qint64(allocationCount() - before) / runs;
+#else
+        const qint64 perDocument = -1;
+#endif
+        qDebug("%-10s %-8s %8d bytes %10.1f MB/s %8lld allocations/document", name, qPrintable(corpus), size,
+               mbps, perDocument);
+    }
+    
+    struct Parse
+    {
+        Parse(const QByteArray &j) : json(j) {}
+        
+        void operator()() const {
+            bool ok;
+            QtJson::Json::parse(json, ok);
+        }
+        
+        const QByteArray &json;
+    };
+    
+    struct Serialize
+    {
+        Serialize(const QVariant &v) : value(v) {}
+        
+        void operator()() const {
+            QtJson::Json::serialize(value);
+        }
+        
+        const QVariant &value;
+    };
+    
+    struct FromBinary
+    {
+        FromBinary(const QByteArray &b) : binary(b) {}
+        
+        void operator()() const {
+            bool ok;
+            QtJson::Json::fromBinary(binary, ok);
+        }
+        
+        const QByteArray &binary;
+    };
+    
+private Q_SLOTS:
+    // Documents are parsed serially, so that the allocations of worker threads are not counted against each parse
+    void initTestCase() {
+        QtJson::Json::setParallelThreshold(0);
+    }
+    
+    void parse_data() {
+        QTest::addColumn<QString>("corpus");
+        
+        for (uint i = 0; i < sizeof(CORPUS) / sizeof(CORPUS[0]); i++) {
+            QTest::newRow(CORPUS[i]) << QString(CORPUS[i]);
+        }
+    }
+    
+    void parse() {
+        QFETCH(QString, corpus);
+        const QByteArray json = document(corpus);
+        QVERIFY(!json.isEmpty());
+        
+        bool ok;
+        QtJson::Json::parse(json, ok);
+        QVERIFY(ok);
+        
+        QBENCHMARK {
+            QtJson::Json::parse(json, ok);
+        }
+        
+        measure("parse", corpus, json.size(), Parse(json));
+    }
+    
+    void serialize_data() {
+        parse_data();
+    }
+    
+    void serialize() {
+        QFETCH(QString, corpus);
+        const QVariant value = QtJson::Json::parse(document(corpus));
+        QVERIFY(value.isValid());
+        
+        const QByteArray json = QtJson::Json::serialize(value);
+        QVERIFY(!json.isEmpty());
+        
+        QBENCHMARK {
+            QtJson::Json::serialize(value);
+        }
+        
+        measure("serialize", corpus, json.size(), Serialize(value));
+    }
+    
+    void fromBinary_data() {
+        parse_data();
+    }
+    
+    void fromBinary() {
+        QFETCH(QString, corpus);
+        const QByteArray binary = QtJson::Json::toBinary(QtJson::Json::parse(document(corpus)));
+        QVERIFY(!binary.isEmpty());
+        
+        bool ok;
+        QtJson::Json::fromBinary(binary, ok);
+        QVERIFY(ok);
+        
+        QBENCHMARK {
+            QtJson::Json::fromBinary(binary, ok);
+        }
+        
+        measure("fromBinary", corpus, binary.size(), FromBinary(binary));
+    }
+};
+
+QTEST_APPLESS_MAIN(JsonBenchmark)
+#include "main.moc"
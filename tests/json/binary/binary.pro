@@ -0,0 +1,14 @@
+TEMPLATE = app
+TARGET = json-binary
+INSTALLS += target
+
+QT += testlib
+QT -= gui
+
+INCLUDEPATH += ../../../src
+LIBS += -L../../../lib -lqdailymotion
+SOURCES += main.cpp
+
+unix {
+    target.path = /opt/qdailymotion/bin
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "json.h"
+#include <QDateTime>
+#include <QSize>
+#include <QUrl>
+#include <QtTest>
+
+// Documents as returned by the API, exercising every type the parser produces
+static const char* DOCUMENTS[] = {
+    "null",
+    "[]",
+    "{}",
+    "\"\"",
+    "[true, false, null, 0, -1, 1.5, -2.5e-3, 1e300, 18446744073709551615, -9223372036854775808]",
+    "{\"id\": \"x2abc\", \"title\": \"Caf\\u00e9 \\ud83d\\ude00 \\\"quoted\\\"\\n\", \"duration\": 214, \"explicit\": false}",
+    "{\"page\": 1, \"limit\": 2, \"has_more\": true, \"list\": [{\"id\": \"a\", \"tags\": [\"one\", \"two\"]}, "
+        "{\"id\": \"b\", \"tags\": [], \"owner\": {\"id\": \"u1\", \"screenname\": \"\\u0000\\t\"}}]}",
+    "[[[[[[[[[[{\"a\": [{\"a\": [{\"a\": 1}]}]}]]]]]]]]]]"
+};
+
+class JsonBinaryTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void roundTrip_data() {
+        QTest::addColumn<QVariant>("value");
+
+        QVariantList list;
+        list << 1 << "two" << 3.5 << QVariant() << QVariantList();
+
+        QVariantMap map;
+        map["id"] = "x2abc";
+        map["views"] = qlonglong(-7);
+        map["list"] = list;
+        map["empty"] = QVariantMap();
+
+        QTest::newRow("null") << QVariant();
+        QTest::newRow("true") << QVariant(true);
+        QTest::newRow("false") << QVariant(false);
+        QTest::newRow("int") << QVariant(42);
+        QTest::newRow("negative int") << QVariant(-42);
+        QTest::newRow("uint") << QVariant(uint(4000000000u));
+        QTest::newRow("long long") << QVariant(Q_INT64_C(-9223372036854775807) - 1);
+        QTest::newRow("unsigned long long") << QVariant(Q_UINT64_C(18446744073709551615));
+        QTest::newRow("double") << QVariant(3.14159);
+        QTest::newRow("integral double") << QVariant(2.0);
+        QTest::newRow("string") << QVariant(QString("Dailymotion"));
+        QTest::newRow("empty string") << QVariant(QString(""));
+        QTest::newRow("escapes") << QVariant(QString("\"\\/\b\f\n\r\t") + QChar(0x01));
+        QTest::newRow("unicode") << QVariant(QString::fromUtf8("caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80"));
+        QTest::newRow("byte array") << QVariant(QByteArray("bytes"));
+        QTest::newRow("string list") << QVariant(QStringList() << "a" << "" << "c");
+        QTest::newRow("list") << QVariant(list);
+        QTest::newRow("empty list") << QVariant(QVariantList());
+        QTest::newRow("map") << QVariant(map);
+        QTest::newRow("empty map") << QVariant(QVariantMap());
+        QTest::newRow("date") << QVariant(QDate(2015, 6, 1));
+        QTest::newRow("date time") << QVariant(QDateTime(QDate(2015, 6, 1), QTime(12, 30)));
+        QTest::newRow("url") << QVariant(QUrl("https://api.dailymotion.com/videos"));
+    }
+
+    // Decoding gives the same value as parsing the serialized JSON
+    void roundTrip() {
+        QFETCH(QVariant, value);
+        bool ok;
+        const QByteArray json = QtJson::Json::serialize(value, ok);
+        QVERIFY(ok);
+
+        const QByteArray binary = QtJson::Json::toBinary(value, ok);
+        QVERIFY(ok);
+
+        const QVariant decoded = QtJson::Json::fromBinary(binary, ok);
+        QVERIFY(ok);
+
+        const QVariant parsed = QtJson::Json::parse(json, ok);
+        QVERIFY(ok);
+        QCOMPARE(decoded.userType(), parsed.userType());
+        QCOMPARE(QtJson::Json::serialize(decoded), json);
+
+        // Doubles keep their full precision
+        if (value.type() == QVariant::Double) {
+            QCOMPARE(decoded.toDouble(), value.toDouble());
+        }
+        else {
+            QCOMPARE(decoded, parsed);
+        }
+    }
+
+    void documents_data() {
+        QTest::addColumn<QByteArray>("json");
+
+        for (uint i = 0; i < sizeof(DOCUMENTS) / sizeof(DOCUMENTS[0]); i++) {
+            QTest::newRow(QByteArray::number(i).constData()) << QByteArray(DOCUMENTS[i]);
+        }
+    }
+
+    // Parsed documents are decoded exactly, and serialize to the same JSON
+    void documents() {
+        QFETCH(QByteArray, json);
+        bool ok;
+        const QVariant parsed = QtJson::Json::parse(json, ok);
+        QVERIFY(ok);
+
+        const QVariant decoded = QtJson::Json::fromBinary(QtJson::Json::toBinary(parsed), ok);
+        QVERIFY(ok);
+        QCOMPARE(decoded, parsed);
+        QCOMPARE(QtJson::Json::serialize(decoded), QtJson::Json::serialize(parsed));
+    }
+
+    void unsupported() {
+        bool ok;
+        QtJson::Json::serialize(QVariant(QSize(1, 2)), ok);
+        QVERIFY(!ok);
+
+        QVERIFY(QtJson::Json::toBinary(QVariant(QSize(1, 2)), ok).isEmpty());
+        QVERIFY(!ok);
+    }
+
+    void header() {
+        bool ok;
+        QtJson::Json::fromBinary(QByteArray(), ok);
+        QVERIFY(!ok);
+
+        QtJson::Json::fromBinary("null", ok);
+        QVERIFY(!ok);
+
+        QByteArray binary = QtJson::Json::toBinary(QVariant(true));
+        QtJson::Json::fromBinary(binary, ok);
+        QVERIFY(ok);
+
+        // Another version of the format
+        binary[3] = binary.at(3) + 1;
+        QtJson::Json::fromBinary(binary, ok);
+        QVERIFY(!ok);
+    }
+
+    // Truncated and extended data is rejected
+    void corrupt() {
+        bool ok;
+        const QByteArray binary = QtJson::Json::toBinary(QtJson::Json::parse(QByteArray(DOCUMENTS[6])));
+
+        for (int i = 0; i < binary.size(); i++) {
+            QtJson::Json::fromBinary(binary.left(i), ok);
+            QVERIFY(!ok);
+        }
+
+        QtJson::Json::fromBinary(binary + '\0', ok);
+        QVERIFY(!ok);
+    }
+};
+
+QTEST_APPLESS_MAIN(JsonBinaryTest)
+#include "main.moc"
@@ -0,0 +1,6 @@
+TEMPLATE = subdirs
+SUBDIRS += \
+    benchmark \
+    binary \
+    keypool \
+    scan
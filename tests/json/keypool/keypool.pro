@@ -0,0 +1,13 @@
+TEMPLATE = app
+TARGET = json-keypool
+INSTALLS += target
+
+QT -= gui
+
+INCLUDEPATH += ../../../src
+LIBS += -L../../../lib -lqdailymotion
+SOURCES += main.cpp
+
+unix {
+    target.path = /opt/qdailymotion/bin
+}
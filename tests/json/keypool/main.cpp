@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "json.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QStringList>
+#include <QDebug>
+#if defined(Q_OS_LINUX) && defined(__GLIBC__)
+#include <malloc.h>
+#define HAVE_MALLINFO
+#endif
+
+static const int ROWS = 10000;
+
+// A response to a list request, with the default fields of the video resource
+static QByteArray response(int rows) {
+    QByteArray json("{\"page\":1,\"limit\":100,\"explicit\":false,\"total\":");
+    json.append(QByteArray::number(rows));
+    json.append(",\"has_more\":false,\"list\":[");
+
+    for (int i = 0; i < rows; i++) {
+        if (i > 0) {
+            json.append(',');
+        }
+
+        json.append("{\"id\":\"x");
+        json.append(QByteArray::number(i, 36));
+        json.append("\",\"title\":\"Video ");
+        json.append(QByteArray::number(i));
+        json.append("\",\"channel\":\"news\",\"owner\":\"x");
+        json.append(QByteArray::number(i % 97, 36));
+        json.append("\",\"duration\":");
+        json.append(QByteArray::number(i % 3600));
+        json.append(",\"views_total\":");
+        json.append(QByteArray::number(i * 31));
+        json.append(",\"thumbnail_url\":\"http://s1.dmcdn.net/x");
+        json.append(QByteArray::number(i, 36));
+        json.append(".jpg\",\"created_time\":1420070400}");
+    }
+
+    json.append("]}");
+    return json;
+}
+
+static qint64 heapUsed() {
+#ifdef HAVE_MALLINFO
+    return mallinfo().uordblks;
+#else
+    return -1;
+#endif
+}
+
+// Count the separately allocated keys in the rows of the result
+static int uniqueKeys(const QVariant &result) {
+    QSet<const QChar*> keys;
+
+    foreach (const QVariant &row, result.toMap().value("list").toList()) {
+        const QVariantMap map = row.toMap();
+
+        for (QVariantMap::const_iterator iterator = map.constBegin(); iterator != map.constEnd(); ++iterator) {
+            keys.insert(iterator.key().constData());
+        }
+    }
+
+    return keys.size();
+}
+
+static void run(const char *name, QtJson::KeyPool *pool, const QByteArray &json) {
+    const qint64 before = heapUsed();
+    QElapsedTimer timer;
+    timer.start();
+
+    QtJson::Parser parser;
+    parser.setKeyPool(pool);
+    parser.addData(json);
+    parser.finish();
+    const QVariant result = parser.result();
+    const qint64 elapsed = timer.elapsed();
+    const qint64 after = heapUsed();
+
+    qDebug() << name << "unique keys:" << uniqueKeys(result) << "heap:" << (after - before) / 1024 << "KiB"
+             << "time:" << elapsed << "ms";
+}
+
+int main(int, char **) {
+    const QByteArray json = response(ROWS);
+    qDebug() << "Parsing" << ROWS << "rows," << json.size() / 1024 << "KiB";
+
+    // A pool with no capacity decodes every key separately
+    QtJson::KeyPool none(0);
+    run("Without pool", &none, json);
+
+    QtJson::KeyPool pool;
+    run("With pool", &pool, json);
+    run("With shared pool", &pool, json);
+
+#ifndef HAVE_MALLINFO
+    qDebug() << "Heap usage is not available on this platform";
+#endif
+    return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "jsonscan_p.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QDebug>
+#include <cstdlib>
+
+using namespace QtJson::Scan;
+
+typedef Kernel Kernels::*KernelMember;
+
+static const int SAMPLE_SIZE = 1024 * 1024;
+static const int MIN_BENCHMARK_MSECS = 500;
+
+// Random data drawn from alphabet, where each character is equally likely
+static QByteArray sample(const char *alphabet, int size) {
+    const int length = qstrlen(alphabet);
+    QByteArray data(size, ' ');
+
+    for (int i = 0; i < size; i++) {
+        data[i] = alphabet[qrand() % length];
+    }
+
+    return data;
+}
+
+// Check that kernel returns the same index as the scalar kernel from every starting point
+static bool verify(const Kernels &kernels, KernelMember member, const QByteArray &data) {
+    const Kernel scalar = scalarKernels().*member;
+    const Kernel kernel = kernels.*member;
+
+    for (int size = 0; size <= 200; size++) {
+        for (int index = 0; index <= size; index++) {
+            if (kernel(data.constData(), index, size) != scalar(data.constData(), index, size)) {
+                qWarning() << kernels.name << "differs from scalar at index" << index << "size" << size;
+                return false;
+            }
+        }
+    }
+
+    for (int index = 0; index < data.size(); index++) {
+        if (kernel(data.constData(), index, data.size()) != scalar(data.constData(), index, data.size())) {
+            qWarning() << kernels.name << "differs from scalar at index" << index;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Scan the data repeatedly, restarting after each match, and return the throughput in MB/s
+static double benchmark(Kernel kernel, const QByteArray &data) {
+    const char *bytes = data.constData();
+    const int size = data.size();
+    qint64 total = 0;
+    int matches = 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    do {
+        int index = 0;
+
+        while (index < size) {
+            index = kernel(bytes, index, size) + 1;
+            matches++;
+        }
+
+        total += size;
+    } while (timer.elapsed() < MIN_BENCHMARK_MSECS);
+
+    Q_UNUSED(matches);
+    return double(total) / (1024 * 1024) / (double(timer.elapsed()) / 1000);
+}
+
+static bool run(const char *name, KernelMember member, const QByteArray &data, const QList<const Kernels*> &sets) {
+    bool ok = true;
+
+    foreach (const Kernels *kernels, sets) {
+        if (!verify(*kernels, member, data.left(64 * 1024))) {
+            ok = false;
+            continue;
+        }
+
+        qDebug() << name << kernels->name << benchmark(kernels->*member, data) << "MB/s";
+    }
+
+    return ok;
+}
+
+int main(int, char **) {
+    qsrand(1);
+
+    QList<const Kernels*> sets;
+    sets << &scalarKernels();
+#ifdef QTJSON_HAVE_SSE2
+    sets << &sse2Kernels();
+#endif
+#ifdef QTJSON_HAVE_AVX2
+    if (hasAvx2()) {
+        sets << &avx2Kernels();
+    }
+#endif
+    qDebug() << "Selected kernels:" << kernels().name;
+
+    // String contents, with an occasional quote or escape
+    QByteArray strings = sample("abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789:/._-", SAMPLE_SIZE);
+
+    for (int i = 0; i < strings.size(); i += 48 + qrand() % 64) {
+        strings[i] = (qrand() % 4) ? '"' : '\\';
+    }
+
+    // Indentation, with an occasional value
+    QByteArray whitespace = sample("    \t\r\n", SAMPLE_SIZE);
+
+    for (int i = 0; i < whitespace.size(); i += 16 + qrand() % 32) {
+        whitespace[i] = '0';
+    }
+
+    // Skipped values, as in a projected parse
+    const QByteArray structure = sample("0123456789.-eEtruefalsn:abcdefghij{}[]\",    ", SAMPLE_SIZE);
+
+    bool ok = true;
+    ok &= run("findQuoteOrBackslash", &Kernels::findQuoteOrBackslash, strings, sets);
+    ok &= run("skipWhitespace", &Kernels::skipWhitespace, whitespace, sets);
+    ok &= run("findStructural", &Kernels::findStructural, structure, sets);
+
+    return ok ? 0 : 1;
+}
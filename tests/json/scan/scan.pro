@@ -0,0 +1,14 @@
+TEMPLATE = app
+TARGET = json-scan
+INSTALLS += target
+
+QT -= gui
+
+INCLUDEPATH += ../../../src
+SOURCES += \
+    main.cpp \
+    ../../../src/jsonscan.cpp
+
+unix {
+    target.path = /opt/qdailymotion/bin
+}
@@ -0,0 +1,14 @@
+TEMPLATE = app
+TARGET = resources-batch
+INSTALLS += target
+
+QT += network testlib
+QT -= gui
+
+INCLUDEPATH += ../../../src
+LIBS += -L../../../lib -lqdailymotion
+SOURCES += main.cpp
+
+unix {
+    target.path = /opt/qdailymotion/bin
+}
@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resourcesrequest.h"
+#include "session.h"
+#include "json.h"
+#include <QEventLoop>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QtTest>
+
+// Stands in for the Data API, answering each request with a canned response
+class StandInServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    StandInServer() :
+        QTcpServer(),
+        statusCode(200),
+        requests(0)
+    {
+        connect(this, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+        listen(QHostAddress::LocalHost);
+    }
+
+    QString url() const {
+        return QString("http://127.0.0.1:%1").arg(serverPort());
+    }
+
+    int statusCode;
+    QByteArray response;
+
+    int requests;
+    QByteArray method;
+    QByteArray path;
+    QByteArray contentType;
+    QByteArray authorization;
+    QByteArray body;
+
+private Q_SLOTS:
+    void onNewConnection() {
+        while (QTcpSocket *socket = nextPendingConnection()) {
+            connect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+            connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+        }
+    }
+
+    void onReadyRead() {
+        QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+        QByteArray &buffer = buffers[socket];
+        buffer.append(socket->readAll());
+
+        const int end = buffer.indexOf("\r\n\r\n");
+
+        if (end < 0) {
+            return;
+        }
+
+        const QList<QByteArray> lines = buffer.left(end).split('\n');
+        int length = 0;
+        contentType.clear();
+        authorization.clear();
+
+        for (int i = 1; i < lines.size(); i++) {
+            const QByteArray line = lines.at(i).trimmed();
+            const int colon = line.indexOf(':');
+            const QByteArray name = line.left(colon).toLower();
+            const QByteArray value = line.mid(colon + 1).trimmed();
+
+            if (name == "content-length") {
+                length = value.toInt();
+            }
+            else if (name == "content-type") {
+                contentType = value;
+            }
+            else if (name == "authorization") {
+                authorization = value;
+            }
+        }
+
+        if (buffer.size() < end + 4 + length) {
+            return;
+        }
+
+        const QList<QByteArray> request = lines.first().split(' ');
+        method = request.value(0);
+        path = request.value(1);
+        body = buffer.mid(end + 4, length);
+        buffers.remove(socket);
+        requests++;
+
+        socket->write("HTTP/1.1 " + QByteArray::number(statusCode) + " Stand-in\r\n"
+                      "Content-Type: application/json\r\n"
+                      "Content-Length: " + QByteArray::number(response.size()) + "\r\n"
+                      "Connection: close\r\n\r\n" + response);
+        socket->disconnectFromHost();
+    }
+
+private:
+    QHash<QTcpSocket*, QByteArray> buffers;
+};
+
+static bool waitForFinished(QDailymotion::Request *request) {
+    QEventLoop loop;
+    QTimer::singleShot(5000, &loop, SLOT(quit()));
+    QObject::connect(request, SIGNAL(finished()), &loop, SLOT(quit()));
+    loop.exec();
+    return request->status() != QDailymotion::Request::Loading;
+}
+
+static QVariantMap call(const QString &path, const QVariantMap &filters = QVariantMap(),
+                        const QStringList &fields = QStringList(), const QString &method = QString()) {
+    QVariantMap map;
+    map["path"] = path;
+
+    if (!filters.isEmpty()) {
+        map["filters"] = filters;
+    }
+
+    if (!fields.isEmpty()) {
+        map["fields"] = fields;
+    }
+
+    if (!method.isEmpty()) {
+        map["method"] = method;
+    }
+
+    return map;
+}
+
+class ResourcesBatchTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init() {
+        server.statusCode = 200;
+        server.response.clear();
+        server.requests = 0;
+        session.setApiUrl(server.url());
+        session.setAccessToken("TOKEN");
+        session.setRefreshToken(QString());
+    }
+
+    // The calls are sent as one POST request to the root of the API
+    void requestBody() {
+        QVariantMap filters;
+        filters["limit"] = 5;
+        filters["sort"] = "recent";
+
+        QVariantMap playlist;
+        playlist["name"] = "My playlist";
+
+        QVariantList calls;
+        calls << call("/user/u1", QVariantMap(), QStringList() << "id" << "screenname")
+              << call("user/u1/videos", filters)
+              << call("/me/playlists", playlist, QStringList(), "post");
+
+        server.response = "[]";
+        QDailymotion::ResourcesRequest request;
+        request.setSession(&session);
+        request.batch(calls);
+        QVERIFY(waitForFinished(&request));
+        QCOMPARE(server.requests, 1);
+        QCOMPARE(server.method, QByteArray("POST"));
+        QCOMPARE(server.path, QByteArray("/"));
+        QCOMPARE(server.contentType, QByteArray("application/json"));
+        QCOMPARE(server.authorization, QByteArray("Bearer TOKEN"));
+
+        bool ok;
+        const QVariantList body = QtJson::Json::parse(server.body, ok).toList();
+        QVERIFY(ok);
+        QCOMPARE(body.size(), 3);
+
+        const QVariantMap user = body.at(0).toMap();
+        QCOMPARE(user.value("call").toString(), QString("GET /user/u1"));
+        QCOMPARE(user.value("args").toMap().value("fields").toStringList(), QStringList() << "id" << "screenname");
+
+        const QVariantMap videos = body.at(1).toMap();
+        QCOMPARE(videos.value("call").toString(), QString("GET /user/u1/videos"));
+        QCOMPARE(videos.value("args").toMap().value("limit").toInt(), 5);
+        QCOMPARE(videos.value("args").toMap().value("sort").toString(), QString("recent"));
+
+        const QVariantMap insert = body.at(2).toMap();
+        QCOMPARE(insert.value("call").toString(), QString("POST /me/playlists"));
+        QCOMPARE(insert.value("args").toMap().value("name").toString(), QString("My playlist"));
+    }
+
+    // The combined response is split into the result or error of each call
+    void responses() {
+        server.response = "[{\"result\": {\"id\": \"u1\", \"screenname\": \"User\"}}, "
+                          "{\"error\": {\"code\": 404, \"message\": \"Not found\", \"type\": \"not_found\"}}, "
+                          "{\"result\": {\"list\": [{\"id\": \"x1\"}], \"has_more\": false}}, "
+                          "{\"error\": {\"code\": 403, \"message\": \"Forbidden\", \"type\": \"access_forbidden\"}}]";
+
+        QDailymotion::ResourcesRequest request;
+        request.setSession(&session);
+        request.batch(QVariantList() << call("/user/u1") << call("/video/missing") << call("/user/u1/videos")
+                                     << call("/video/private"));
+        QVERIFY(waitForFinished(&request));
+        QCOMPARE(request.status(), QDailymotion::Request::Ready);
+
+        QCOMPARE(request.batchError(0), QDailymotion::Request::NoError);
+        QVERIFY(request.batchErrorString(0).isEmpty());
+        QCOMPARE(request.batchResult(0).toMap().value("screenname").toString(), QString("User"));
+
+        QCOMPARE(request.batchError(1), QDailymotion::Request::ContentNotFoundError);
+        QCOMPARE(request.batchErrorString(1), QString("Not found"));
+        QVERIFY(request.batchResult(1).isNull());
+
+        QCOMPARE(request.batchError(2), QDailymotion::Request::NoError);
+        QCOMPARE(request.batchResult(2).toMap().value("list").toList().size(), 1);
+
+        QCOMPARE(request.batchError(3), QDailymotion::Request::ContentAccessDenied);
+
+        // There is no response for a call that was not made
+        QCOMPARE(request.batchError(4), QDailymotion::Request::ParseError);
+    }
+
+    // Each call fails with the error of the batch request
+    void failure() {
+        server.statusCode = 500;
+        server.response = "{\"error\": {\"code\": 500, \"message\": \"Internal error\"}}";
+
+        QDailymotion::ResourcesRequest request;
+        request.setSession(&session);
+        request.batch(QVariantList() << call("/user/u1") << call("/video/x1"));
+        QVERIFY(waitForFinished(&request));
+        QCOMPARE(request.status(), QDailymotion::Request::Failed);
+        QCOMPARE(request.batchError(0), request.error());
+        QCOMPARE(request.batchError(1), request.error());
+        QCOMPARE(request.batchErrorString(1), request.errorString());
+        QVERIFY(request.batchResult(0).isNull());
+    }
+
+private:
+    StandInServer server;
+    QDailymotion::Session session;
+};
+
+QTEST_MAIN(ResourcesBatchTest)
+#include "main.moc"
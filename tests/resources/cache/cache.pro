@@ -0,0 +1,11 @@
+TEMPLATE = app
+TARGET = resources-cache
+INSTALLS += target
+
+INCLUDEPATH += ../../../src
+LIBS += -L../../../lib -lqdailymotion
+SOURCES += main.cpp
+
+unix {
+    target.path = /opt/qdailymotion/bin
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resourcesmodel.h"
+#include "responsecache.h"
+#include "resultcache.h"
+#include "json.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QEventLoop>
+#include <QStringList>
+#include <QSettings>
+#include <QDebug>
+
+// Lists path with a new model, and returns the number of rows once the model has finished loading
+static int listRows(const QString &path) {
+    QSettings settings;
+
+    QDailymotion::ResourcesModel model;
+    model.setClientId(settings.value("Authentication/clientId").toString());
+    model.setClientSecret(settings.value("Authentication/clientSecret").toString());
+    model.setAccessToken(settings.value("Authentication/accessToken").toString());
+    model.setRefreshToken(settings.value("Authentication/refreshToken").toString());
+
+    QEventLoop loop;
+    QObject::connect(&model, SIGNAL(statusChanged(QDailymotion::ResourcesRequest::Status)), &loop, SLOT(quit()));
+    model.list(path);
+
+    while (model.status() == QDailymotion::ResourcesRequest::Loading) {
+        loop.exec();
+    }
+
+    if (model.status() != QDailymotion::ResourcesRequest::Ready) {
+        qWarning() << "Request failed:" << model.errorString();
+        return -1;
+    }
+
+    return model.rowCount();
+}
+
+// Waits for request to finish, and returns true if it has succeeded
+static bool finish(QDailymotion::ResourcesRequest *request) {
+    QEventLoop loop;
+    QObject::connect(request, SIGNAL(finished()), &loop, SLOT(quit()));
+
+    while (request->status() == QDailymotion::ResourcesRequest::Loading) {
+        loop.exec();
+    }
+
+    if (request->status() != QDailymotion::ResourcesRequest::Ready) {
+        qWarning() << "Request failed:" << request->errorString();
+        return false;
+    }
+
+    return true;
+}
+
+static void setCredentials(QDailymotion::ResourcesRequest *request) {
+    QSettings settings;
+    request->setClientId(settings.value("Authentication/clientId").toString());
+    request->setClientSecret(settings.value("Authentication/clientSecret").toString());
+    request->setAccessToken(settings.value("Authentication/accessToken").toString());
+    request->setRefreshToken(settings.value("Authentication/refreshToken").toString());
+}
+
+// Gets resourcePath with fields into an empty ResponseCache, updates it, and returns true if the cached 
+// response has been removed
+static bool checkUpdateEvictsResponse(const QString &resourcePath, const QVariantMap &resource) {
+    QDailymotion::ResponseCache cache;
+    cache.setDirectory(QDir::tempPath() + "/qdailymotion-cache-test");
+    cache.clear();
+
+    QDailymotion::ResourcesRequest request;
+    setCredentials(&request);
+    request.setResponseCache(&cache);
+    request.get(resourcePath, QVariantMap(), QStringList() << "id" << resource.keys());
+
+    if (!finish(&request)) {
+        return false;
+    }
+
+    if (!cache.size()) {
+        qWarning() << "SKIP: The response to" << resourcePath << "cannot be cached";
+        return true;
+    }
+
+    request.update(resourcePath, resource);
+
+    if (!finish(&request)) {
+        return false;
+    }
+
+    qDebug() << "Response cache size after update:" << cache.size();
+    return cache.size() == 0;
+}
+
+// Gets resourcePath into both caches, updates it in a batch, and returns true if the cached result and response 
+// have been removed
+static bool checkBatchInvalidates(const QString &resourcePath, const QVariantMap &resource) {
+    QDailymotion::ResponseCache cache;
+    cache.setDirectory(QDir::tempPath() + "/qdailymotion-cache-test");
+    cache.clear();
+
+    QDailymotion::ResourcesRequest request;
+    setCredentials(&request);
+    request.setResponseCache(&cache);
+    request.get(resourcePath);
+
+    if (!finish(&request)) {
+        return false;
+    }
+
+    const bool responseCached = cache.size() > 0;
+    QVariantMap call;
+    call["method"] = "POST";
+    call["path"] = resourcePath;
+    call["filters"] = resource;
+    request.batch(QVariantList() << call);
+
+    if (!finish(&request)) {
+        return false;
+    }
+
+    if (request.batchError(0) != QDailymotion::ResourcesRequest::NoError) {
+        qWarning() << "Batched update failed:" << request.batchErrorString(0);
+        return false;
+    }
+
+    qDebug() << "Response cache size after batch:" << cache.size();
+
+    if ((responseCached) && (cache.size())) {
+        return false;
+    }
+
+    // The resource is requested again, rather than served from the result cache
+    const int hits = QDailymotion::ResultCache::hits();
+    request.get(resourcePath);
+
+    if (!finish(&request)) {
+        return false;
+    }
+
+    return QDailymotion::ResultCache::hits() == hits;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setOrganizationName("QDailymotion");
+    app.setApplicationName("QDailymotion");
+
+    QStringList args = app.arguments();
+
+    if (args.size() < 2) {
+        qWarning() << "Usage: resources-cache LISTPATH [RESOURCEPATH RESOURCE]";
+        return 0;
+    }
+
+    QDailymotion::ResultCache::setCacheLimit(1024);
+
+    // The first list is made over the network, and the second is served from the result cache
+    const int rows = listRows(args.at(1));
+    const int hits = QDailymotion::ResultCache::hits();
+    const int cachedRows = listRows(args.at(1));
+
+    qDebug() << "Rows:" << rows << "Rows from cache:" << cachedRows << "Cache hits:"
+             << QDailymotion::ResultCache::hits() - hits;
+
+    if ((rows <= 0) || (cachedRows != rows) || (QDailymotion::ResultCache::hits() == hits)) {
+        qWarning() << "FAIL: The list served from the cache does not fill the model";
+        return 1;
+    }
+
+    // The writes are only checked when a resource that can be changed is given
+    if (args.size() >= 4) {
+        const QVariantMap resource = QtJson::Json::parse(args.at(3)).toMap();
+
+        if (!checkUpdateEvictsResponse(args.at(2), resource)) {
+            qWarning() << "FAIL: A response requested with fields is kept after an update of its resource";
+            return 1;
+        }
+
+        if (!checkBatchInvalidates(args.at(2), resource)) {
+            qWarning() << "FAIL: A cached result or response is kept after a batched update of its resource";
+            return 1;
+        }
+    }
+
+    qDebug() << "PASS";
+    return 0;
+}
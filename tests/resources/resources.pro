@@ -1,5 +1,7 @@
 TEMPLATE = subdirs
 SUBDIRS += \
+    batch \
+    cache \
     del \
     insert \
     list \
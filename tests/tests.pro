@@ -1,5 +1,6 @@
 TEMPLATE = subdirs
 SUBDIRS += \
     authentication \
+    json \
     resources \
     streams